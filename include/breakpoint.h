@@ -0,0 +1,54 @@
+#ifndef __BREAKPOINT_H__
+#define __BREAKPOINT_H__
+
+#include <common.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <mem.h>
+#include <processor.h>
+#include <cond.h>
+
+#define BP_MAX_CONDS 16
+
+/* a breakpoint taken only if cond holds */
+struct bp_cond_t {
+    uint16_t addr;
+    struct cond_t cond;
+};
+
+/*
+ * one bit per address, 8 KiB; an address with conditions breaks when
+ * one of them holds, they are evaluated only once its bit is hit
+ */
+struct breakpoints_t {
+    uint64_t bits[MEM_SIZE/64];
+    int count;
+
+    struct bp_cond_t conds[BP_MAX_CONDS];
+    int n_conds;
+};
+
+void bp_init(struct breakpoints_t* bp);
+void bp_set(struct breakpoints_t* bp, uint16_t addr);
+void bp_clear(struct breakpoints_t* bp, uint16_t addr);
+bool bp_toggle(struct breakpoints_t* bp, uint16_t addr);
+int bp_set_cond(struct breakpoints_t* bp, uint16_t addr, struct cond_t* cond);
+bool bp_check(struct breakpoints_t* bp, struct processor_t* cpu, struct mem* mem);
+
+int bp_parse(
+        const char* spec, 
+        uint16_t* addr, 
+        struct cond_t* cond, 
+        bool* has_cond, 
+        char* err, 
+        size_t n
+);
+
+/*---------------------------------------------------*/
+/* brief: true if execution stops before the instruction at addr */
+/*---------------------------------------*/
+static inline bool bp_test(struct breakpoints_t* bp, uint16_t addr) {
+    return bp->bits[addr>>6]>>(addr&63) & 1;
+}
+
+#endif
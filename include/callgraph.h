@@ -0,0 +1,76 @@
+#ifndef __CALLGRAPH_H__
+#define __CALLGRAPH_H__
+
+#include <common.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <symbols.h>
+
+#define CG_MAX_DEPTH 256
+
+/* a call path: the routine at addr called through the parent path */
+struct cg_node_t {
+    uint16_t addr;
+    int32_t parent;
+    int32_t child;
+    int32_t sibling;
+
+    uint64_t calls;
+    /* cycles spent in the routine itself on this path */
+    uint64_t self;
+};
+
+/* the stack pointer right after the return address was pushed */
+struct cg_frame_t {
+    int32_t node;
+    uint8_t sp;
+};
+
+/*
+ * shadow call stack: frames are popped when the stack pointer moves
+ * above their return address, not on rts, so a return address
+ * dropped with pla or reused as a jump by pha/pha/rts never leaves
+ * the shadow stack out of step with the real one
+ */
+struct callgraph_t {
+    struct cg_node_t* nodes;
+    size_t n_nodes;
+    size_t cap;
+
+    struct cg_frame_t stack[CG_MAX_DEPTH];
+    int depth;
+
+    /* calls not tracked because the shadow stack was full */
+    unsigned long overflow;
+};
+
+int cg_init(struct callgraph_t* cg, uint16_t entry);
+void cg_dispose(struct callgraph_t* cg);
+
+void cg_call(struct callgraph_t* cg, uint16_t target, uint8_t sp);
+
+int cg_write_folded(struct callgraph_t* cg, FILE* fp, struct symbols_t* syms);
+void cg_report(
+        struct callgraph_t* cg, 
+        FILE* fp, 
+        struct symbols_t* syms, 
+        int lines
+);
+
+/*---------------------------------------------------*/
+/* brief: charge cycles to the running routine */
+/*---------------------------------------*/
+static inline void cg_account(struct callgraph_t* cg, uint64_t cycles) {
+    cg->nodes[cg->stack[cg->depth-1].node].self += cycles;
+}
+
+/*---------------------------------------------------*/
+/* brief: drop the frames whose return address is gone */
+/*---------------------------------------*/
+static inline void cg_unwind(struct callgraph_t* cg, uint8_t sp) {
+    while(cg->depth>1 && (int8_t)(sp-cg->stack[cg->depth-1].sp)>=2) {
+        cg->depth--;
+    }
+}
+
+#endif
@@ -1,14 +1,8 @@
 #ifndef __COMMON_H__
 #define __COMMON_H__
 
-#define RET_ON_ERR(rc) if(rc<0) return rc
-
-typedef unsigned char uint8_t;
-typedef unsigned short uint16_t;
-typedef unsigned int uint32_t;
+#include <stdint.h>
 
-typedef signed char int8_t;
-typedef signed short int16_t;
-typedef signed int int32_t;
+#define RET_ON_ERR(rc) if(rc<0) return rc
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,72 @@
+#ifndef __COND_H__
+#define __COND_H__
+
+#include <common.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <mem.h>
+#include <processor.h>
+
+#define COND_MAX_CODE 96
+#define COND_MAX_STACK 16
+#define COND_MAX_TEXT 64
+
+enum cond_op_e {
+    COND_END,
+    COND_PUSH,      /* u16 operand */
+    COND_REG,       /* u8 register */
+    COND_CYCLES,
+    COND_LOAD,      /* mem[top] */
+    COND_NOT,
+    COND_NEG,
+    COND_INV,
+    COND_ADD,
+    COND_SUB,
+    COND_AND,
+    COND_OR,
+    COND_XOR,
+    COND_EQ,
+    COND_NE,
+    COND_LT,
+    COND_LE,
+    COND_GT,
+    COND_GE,
+    COND_LAND,
+    COND_LOR,
+};
+
+enum cond_reg_e {
+    COND_REG_A,
+    COND_REG_X,
+    COND_REG_Y,
+    COND_REG_SP,
+    COND_REG_PC,
+    COND_REG_P,
+    COND_REG_C,
+    COND_REG_Z,
+    COND_REG_I,
+    COND_REG_D,
+    COND_REG_B,
+    COND_REG_V,
+    COND_REG_N,
+};
+
+/*
+ * expression over registers, flags, memory and the cycle counter,
+ * compiled once to postfix bytecode, e.g. "A>=$0f && mem[$00]!=0"
+ */
+struct cond_t {
+    uint8_t code[COND_MAX_CODE];
+    int len;
+
+    /* from a top level "PC==addr" term, the address it can hit at */
+    bool has_pc;
+    uint16_t pc;
+
+    char text[COND_MAX_TEXT];
+};
+
+int cond_compile(struct cond_t* c, const char* text, char* err, size_t n);
+int64_t cond_eval(const struct cond_t* c, struct processor_t* cpu, struct mem* mem);
+
+#endif
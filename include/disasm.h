@@ -0,0 +1,14 @@
+#ifndef __DISASM_H__
+#define __DISASM_H__
+
+#include <common.h>
+#include <stddef.h>
+#include <mem.h>
+
+/* longest text written by disasm, terminator included */
+#define DISASM_MAX_TEXT 20
+
+int disasm(const uint8_t* ins, char* buf, size_t n);
+int disasm_mem(struct mem* mem, uint16_t addr, char* buf, size_t n);
+
+#endif
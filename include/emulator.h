@@ -4,6 +4,8 @@
 #include <mem.h>
 #include <processor.h>
 #include <ncurses.h>
+#include <breakpoint.h>
+#include <lcd.h>
 
 #define EMU_SHOW_COLOR 1
 #define EMU_DISPLAY_COLOR 2
@@ -17,6 +19,12 @@
 
 #define EMU_DATA_ROW_CELLS 8
 
+/* instructions run by continue between two looks at the keyboard */
+#define EMU_RUN_BATCH 100000
+
+/* saved and loaded by the v and l keys when no other name is given */
+#define EMU_STATE_FILE "emu.state"
+
 extern const char EMU_LED_CHAR[];
 
 struct emu_section_t {
@@ -34,6 +42,14 @@ struct emulator_t {
     uint16_t inst_p;
     uint16_t mem_p;
     bool show_io;
+
+    /* marked in the code section, NULL for none */
+    struct breakpoints_t* bp;
+
+    /* shown in the i/o section, redrawn when its version moves */
+    struct lcd_t* lcd;
+    unsigned long lcd_version;
+    bool lcd_drawn;
 };
 
 
@@ -70,7 +86,16 @@ void emu_dump_registers(
 );
 void emu_display_io(
         struct processor_t *cpu, struct mem *mem, struct emu_section_t* io);
+void emu_display_lcd(struct emulator_t* emu);
 void emu_refresh(
         struct emulator_t* emu, struct processor_t *cpu, struct mem* mem);
 
+int emu_prompt(
+        struct emulator_t* emu, 
+        const char* msg, 
+        char* buf, 
+        int n
+);
+void emu_status(struct emulator_t* emu, const char* msg);
+
 #endif
@@ -0,0 +1,66 @@
+#ifndef __FUZZ_H__
+#define __FUZZ_H__
+
+#include <common.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <machine.h>
+#include <input.h>
+
+#define FUZZ_MAP_SIZE       65536
+#define FUZZ_MAX_CORPUS     4096
+#define FUZZ_MAX_EVENTS     64
+#define FUZZ_DEFAULT_RUNS   10000
+
+/* cycles the program may go without touching $4000-$7fff */
+#define FUZZ_WATCHDOG       1000000
+
+/* how a run ended, all but FUZZ_OK are saved */
+enum fuzz_result_e {
+    FUZZ_OK,
+    FUZZ_OPCODE,    /* an opcode the core does not execute */
+    FUZZ_STACK,     /* the stack pointer wrapped */
+    FUZZ_WILD,      /* code fetched below the rom */
+    FUZZ_HANG,      /* the watchdog ran out */
+    FUZZ_RESULTS,
+};
+
+extern const char* FUZZ_RESULT_NAMES[];
+
+/*
+ * coverage guided search of input schedules, one machine restarted
+ * between the runs, schedules reaching new edges are kept to mutate
+ */
+struct fuzz_t {
+    struct machine_t m;
+    unsigned long steps;
+    const char* dir;
+
+    /* hit counts of the run, and the count buckets any run reached */
+    uint8_t* bits;
+    uint8_t* virgin;
+    size_t edges;
+
+    bool supported[256];
+
+    struct input_log_t corpus[FUZZ_MAX_CORPUS];
+    size_t n_corpus;
+
+    /* cycles of the longest run, events are placed before it */
+    uint64_t horizon;
+    uint64_t rng;
+
+    /* where each kind of fault was already saved */
+    uint64_t seen[FUZZ_RESULTS][MEM_SIZE/64];
+    uint16_t fault_pc;
+
+    unsigned long runs;
+    unsigned long found[FUZZ_RESULTS];
+};
+
+int fuzz_init(struct fuzz_t* f, char* rom, const char* dir, unsigned long steps);
+void fuzz_dispose(struct fuzz_t* f);
+enum fuzz_result_e fuzz_run(struct fuzz_t* f, struct input_log_t* log);
+int fuzz_campaign(struct fuzz_t* f, unsigned long runs);
+
+#endif
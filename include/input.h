@@ -0,0 +1,49 @@
+#ifndef __INPUT_H__
+#define __INPUT_H__
+
+#include <common.h>
+#include <stddef.h>
+
+enum input_device_e {
+    INPUT_BUTTON,
+    INPUT_PTA,      /* the pins of PTA set as inputs by DDRA */
+    INPUT_PTB,      /* the same on PTB, but for the button bit */
+    INPUT_DEVICES,
+};
+
+extern const char* INPUT_DEVICE_NAMES[];
+
+/* first bytes of a compact log, see input_log_save */
+#define INPUT_MAGIC "E65I"
+
+/* an external input, applied between the instructions at cycle */
+struct input_event_t {
+    uint64_t cycle;
+    uint8_t device;
+    uint8_t value;
+};
+
+/* events in cycle order */
+struct input_log_t {
+    struct input_event_t* events;
+    size_t n_events;
+    size_t cap;
+};
+
+void input_log_init(struct input_log_t* log);
+void input_log_dispose(struct input_log_t* log);
+void input_log_clear(struct input_log_t* log);
+
+int input_log_append(
+        struct input_log_t* log, 
+        uint64_t cycle, 
+        uint8_t device, 
+        uint8_t value
+);
+void input_log_truncate(struct input_log_t* log, size_t n_events);
+size_t input_log_find(struct input_log_t* log, uint64_t cycle);
+
+int input_log_save(struct input_log_t* log, const char* filename);
+int input_log_load(struct input_log_t* log, const char* filename);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef __JOURNAL_H__
+#define __JOURNAL_H__
+
+#include <common.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <mem.h>
+#include <processor.h>
+
+#define JOURNAL_DEFAULT_BUDGET (1<<20)
+#define JOURNAL_MIN_BUDGET 256
+
+/* 
+ * ring buffer of variable size entries, one per instruction:
+ * [len][struct processor_t][addr old]...[len]
+ * the leading length lets the oldest entry be dropped, the trailing
+ * one lets the newest entry be undone
+ */
+struct journal_t {
+    uint8_t* buf;
+    size_t size;
+
+    size_t tail;
+    size_t used;
+
+    size_t entry;
+    uint16_t entry_len;
+    bool recording;
+
+    unsigned long entries;
+};
+
+int journal_init(struct journal_t* j, size_t budget);
+void journal_dispose(struct journal_t* j);
+void journal_clear(struct journal_t* j);
+
+void journal_attach(struct journal_t* j, struct mem* mem);
+void journal_detach(struct journal_t* j, struct mem* mem);
+
+void journal_begin(struct journal_t* j, struct processor_t* cpu);
+void journal_end(struct journal_t* j);
+
+int journal_undo(struct journal_t* j, struct processor_t* cpu, struct mem* mem);
+
+#endif
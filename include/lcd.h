@@ -0,0 +1,82 @@
+#ifndef __LCD_H__
+#define __LCD_H__
+
+#include <common.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define LCD_DDRAM_SIZE  0x80
+#define LCD_CGRAM_SIZE  0x40
+#define LCD_COLS        16
+#define LCD_LINE_LEN    40
+
+/* busy time of the instructions at 1 MHz, a cycle a microsecond */
+#define LCD_BUSY_CYCLES 37
+#define LCD_HOME_CYCLES 1520
+
+/* bytes written by lcd_save_state */
+#define LCD_STATE_SIZE  (LCD_DDRAM_SIZE+LCD_CGRAM_SIZE+14)
+
+/* the control lines on PTB */
+#define LCD_RS  (1<<5)
+#define LCD_RW  (1<<6)
+#define LCD_E   (1<<7)
+
+/*
+ * HD44780 controller on an 8 bit bus, run only on the edges of E:
+ * a write is latched when E falls, a read is put on the bus when E
+ * rises and held until it falls
+ */
+struct lcd_t {
+    uint8_t ddram[LCD_DDRAM_SIZE];
+    uint8_t cgram[LCD_CGRAM_SIZE];
+
+    /* address counter, in cgram after a set cgram address */
+    uint8_t ac;
+    bool cgram_mode;
+
+    /* entry mode, display control and function set */
+    bool increment;
+    bool shift;
+    bool display;
+    bool cursor;
+    bool blink;
+    bool eight_bit;
+    bool two_lines;
+    bool font5x10;
+
+    /* first ddram column shown, 0 to 2*LCD_LINE_LEN-1, taken modulo */
+    /* LCD_LINE_LEN with two lines */
+    uint8_t offset;
+
+    /* in 4 bit mode, the high nibble came and the low one is next */
+    bool low_nibble;
+    uint8_t high;
+
+    uint64_t busy_until;
+
+    /* the level of E and what a read drives on the bus while it is high */
+    bool e;
+    bool driving;
+    uint8_t out;
+
+    /* transfers, and changes of what is shown, for the renderer */
+    unsigned long edges;
+    unsigned long version;
+    unsigned long ignored;
+};
+
+void lcd_init(struct lcd_t* lcd);
+void lcd_edge(
+        struct lcd_t* lcd,
+        uint64_t cycle,
+        uint8_t ctrl,
+        uint8_t data
+);
+void lcd_line(struct lcd_t* lcd, int row, char* text);
+int lcd_cursor(struct lcd_t* lcd, int row);
+
+void lcd_save_state(struct lcd_t* lcd, uint8_t* p);
+void lcd_load_state(struct lcd_t* lcd, const uint8_t* p);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef __LOCKSTEP_H__
+#define __LOCKSTEP_H__
+
+#include <common.h>
+#include <stdbool.h>
+#include <mem.h>
+#include <processor.h>
+#include <machine.h>
+
+#define LS_MAX_LANES 16
+
+/* one byte / one short per lane: 16 and 32 bytes, an SSE and an AVX2 reg */
+typedef uint8_t ls_v8_t __attribute__((vector_size(LS_MAX_LANES)));
+typedef uint16_t ls_v16_t __attribute__((vector_size(LS_MAX_LANES*2)));
+
+struct lockstep_t {
+    int lanes;
+
+    /* struct-of-arrays register file, lane i is slot i */
+    ls_v8_t A;
+    ls_v8_t X;
+    ls_v8_t Y;
+    ls_v8_t SP;
+    ls_v16_t PC;
+
+    ls_v8_t neg, over, brk, dec, ids, zero, carry;
+
+    /* 0xff for lanes still running, 0x00 for stopped or unused lanes */
+    ls_v8_t active;
+
+    /* cycles of every opcode, looked up once */
+    uint8_t op_cycles[256];
+
+    /* a board per lane: memory, pins, display and via, and the rest of */
+    /* the cpu, its registers are only up to date in the file above */
+    struct machine_t* m;
+
+    /* lane-instructions executed by the vector and the scalar path */
+    unsigned long vector_inst;
+    unsigned long scalar_inst;
+};
+
+int ls_init(struct lockstep_t* ls, int lanes, char* filename);
+void ls_dispose(struct lockstep_t* ls);
+
+void ls_get_cpu(struct lockstep_t* ls, int lane, struct processor_t* cpu);
+void ls_set_cpu(struct lockstep_t* ls, int lane, struct processor_t* cpu);
+
+int ls_step(struct lockstep_t* ls);
+int ls_bench(char* filename, int lanes, unsigned long steps);
+
+#endif
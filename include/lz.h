@@ -0,0 +1,26 @@
+#ifndef __LZ_H__
+#define __LZ_H__
+
+#include <common.h>
+#include <stddef.h>
+
+/*
+ * byte oriented lz77: each sequence is a token (literal length in the
+ * high nibble, match length-LZ_MIN_MATCH in the low one, 15 continues
+ * in 255 steps), the literals, a 16 bit little endian offset and the
+ * match length continuation; the last sequence has literals only
+ */
+#define LZ_MIN_MATCH 4
+#define LZ_HASH_BITS 14
+
+size_t lz_bound(size_t n);
+size_t lz_compress(const uint8_t* src, size_t n, uint8_t* dst);
+int lz_decompress(
+        const uint8_t* src, 
+        size_t n, 
+        uint8_t* dst, 
+        size_t cap, 
+        size_t* out
+);
+
+#endif
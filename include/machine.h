@@ -0,0 +1,101 @@
+#ifndef __MACHINE_H__
+#define __MACHINE_H__
+
+#include <common.h>
+#include <mem.h>
+#include <processor.h>
+#include <input.h>
+#include <breakpoint.h>
+#include <watch.h>
+#include <lcd.h>
+#include <via.h>
+
+/* the pin of PTB the button pulls up */
+#define MACHINE_BTN_MASK (1<<4)
+
+/* bytes written by machine_save_devices */
+#define MACHINE_DEVICE_SIZE (LCD_STATE_SIZE+VIA_STATE_SIZE)
+
+/* why a run returned */
+enum machine_stop_e {
+    MACHINE_STOP_STEPS,
+    MACHINE_STOP_BREAKPOINT,
+    MACHINE_STOP_WATCHPOINT,
+    MACHINE_STOP_HALTED,
+    MACHINE_STOP_CYCLES,
+};
+
+extern const char* MACHINE_STOP_NAMES[];
+
+struct script_t;
+
+/* the board: cpu, memory and the devices wired to the ports */
+struct machine_t {
+    struct processor_t cpu;
+    struct mem mem;
+
+    /* the memory as loaded, machine_restart brings the dirty pages back */
+    struct mem pristine;
+
+    /* inputs fed by machine_step at their cycles, see machine_replay */
+    struct input_log_t* replay;
+    size_t replay_next;
+    uint64_t next_input;
+
+    /* rules fed along with the replay, see sc_attach */
+    struct script_t* script;
+
+    /* told of every input machine_input applies, as trace_input */
+    void (*input_hook)(void* ctx, uint8_t device, uint8_t value);
+    void* input_ctx;
+
+    /* the display on PTA, its control lines on PTB */
+    struct lcd_t lcd;
+
+    /* timers on the irq line, at MEM_VIA */
+    struct via_t via;
+
+    /* the last step took the interrupt instead of running an instruction */
+    bool interrupted;
+};
+
+/* 
+ * told of every step machine_run takes, any callback may be NULL; inputs 
+ * due are fed before 'before' so the step it sees is the one that runs, 
+ * and a step that took the interrupt goes to 'interrupt' not 'after'
+ */
+struct machine_observer_t {
+    void (*before)(void* ctx, struct machine_t* m);
+    void (*after)(void* ctx, struct machine_t* m);
+    void (*interrupt)(void* ctx, struct machine_t* m);
+    void* ctx;
+};
+
+int machine_init(struct machine_t* m, char* filename);
+void machine_dispose(struct machine_t* m);
+void machine_reset(struct machine_t* m);
+size_t machine_restart(struct machine_t* m);
+
+int machine_step(struct machine_t* m);
+enum machine_stop_e machine_run(
+        struct machine_t* m, 
+        unsigned long steps, 
+        struct breakpoints_t* bp, 
+        struct watchpoints_t* wp, 
+        struct machine_observer_t* obs, 
+        unsigned long* executed
+);
+enum machine_stop_e machine_run_to(
+        struct machine_t* m, 
+        uint64_t cycle, 
+        struct breakpoints_t* bp, 
+        unsigned long* executed
+);
+void machine_input(struct machine_t* m, uint8_t device, uint8_t value);
+void machine_replay(struct machine_t* m, struct input_log_t* log);
+void machine_feed(struct machine_t* m);
+
+void machine_save_devices(struct machine_t* m, uint8_t* p);
+void machine_load_devices(struct machine_t* m, const uint8_t* p);
+
+#endif
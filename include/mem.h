@@ -1,11 +1,15 @@
 #ifndef __MEM_H__
-#define __MEM_H__ 
+#define __MEM_H__
 
 #include <common.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 #define MEM_CODE_ADDR   0x8000
-#define MEM_SIZE        0xffff+1
+#define MEM_SIZE        (0xffff+1)
+
+#define MEM_PAGE_SIZE   0x100
+#define MEM_PAGES       (MEM_SIZE/MEM_PAGE_SIZE)
 
 #define MEM_IRQ 0xfffe
 #define MEM_RES 0xfffc
@@ -17,16 +21,111 @@
 #define MEM_DDRA 0x4002
 #define MEM_DDRB 0x4003
 
+// the 16 registers of the via, repeated through its page
+#define MEM_VIA  0x6000
+
+/* a page is shared between memories and snapshots until written */
+struct mem_page_t {
+    int refs;
+    bool pooled;
+    uint8_t data[MEM_PAGE_SIZE];
+};
+
+#define MEM_MAX_HOOKS 4
+
+/* observes a store of val over old, see mem_write_slow for when */
+typedef void (*mem_write_hook)(void* ctx, uint16_t addr, uint8_t old, uint8_t val);
+
+struct mem_hook_t {
+    mem_write_hook write;
+    void* ctx;
+};
+
+/* computes what a read of addr returns, from the byte stored there */
+typedef uint8_t (*mem_read_hook)(void* ctx, uint16_t addr, uint8_t stored);
+
 struct mem {
-    uint8_t data[MEM_SIZE];
+    struct mem_page_t* pages[MEM_PAGES];
+
+    /* page data writable in place, NULL sends the store to mem_write_slow */
+    uint8_t* wpage[MEM_PAGES];
+
+    struct mem_hook_t hooks[MEM_MAX_HOOKS];
+    int n_hooks;
+
+    /* pages stored to, or replaced, since mem_baseline */
+    uint64_t dirty[MEM_PAGES/64];
+
+    /* stores to a watched page alone take the slow path to the watch */
+    bool watched[MEM_PAGES];
+    struct mem_hook_t watch;
+
+    /* reads of a device page are answered by the read hook, the pins, */
+    /* and its stores all take the slow path to the write hook */
+    bool device[MEM_PAGES];
+    mem_read_hook read;
+    mem_write_hook write;
+    void* device_ctx;
+
     int last_selected;
 };
 
 void mem_init(struct mem* m);
+void mem_dispose(struct mem* m);
 int mem_load(struct mem* m, char* filename);
+
+void mem_share(struct mem* dst, struct mem* src);
+void mem_clone(struct mem* dst, struct mem* src);
+void mem_baseline(struct mem* m, struct mem* base);
+size_t mem_revert(struct mem* m, struct mem* base);
+uint8_t* mem_page_own(struct mem* m, int page);
+void mem_page_replace(struct mem* m, int page, struct mem_page_t* with);
+void mem_write_slow(struct mem* m, uint16_t dst, uint8_t val);
+
+int mem_add_hook(struct mem* m, mem_write_hook write, void* ctx);
+void mem_remove_hook(struct mem* m, mem_write_hook write, void* ctx);
+void mem_set_watch(struct mem* m, mem_write_hook write, void* ctx);
+void mem_watch_page(struct mem* m, int page, bool on);
+void mem_set_device(
+        struct mem* m,
+        int page,
+        mem_read_hook read,
+        mem_write_hook write,
+        void* ctx
+);
+
 uint16_t mem_get_data_short(struct mem* m, uint16_t src);
-uint8_t mem_get_data_byte(struct mem* m, uint16_t src);
 
-int mem_set_btn(struct mem* m, bool pressed);
+/*---------------------------------------------------*/
+/* brief: return the 8 bit data at src */
+/*---------------------------------------*/
+static inline uint8_t mem_get_data_byte(struct mem* m, uint16_t src) {
+    uint8_t val = m->pages[src>>8]->data[src&0xff];
+
+    if(m->device[src>>8])
+        val = m->read(m->device_ctx, src, val);
+
+    return val;
+}
+
+/*---------------------------------------------------*/
+/* brief: return the code byte at src, as stored */
+/* code is not run from the i/o page, so fetches skip the devices */
+/*---------------------------------------*/
+static inline uint8_t mem_fetch_byte(struct mem* m, uint16_t src) {
+    return m->pages[src>>8]->data[src&0xff];
+}
+
+/*---------------------------------------------------*/
+/* brief: store 8 bit data at dst */
+/*---------------------------------------*/
+static inline void mem_set_data_byte(struct mem* m, uint16_t dst, uint8_t val) {
+    uint8_t* page = m->wpage[dst>>8];
+
+    if(page!=NULL)
+        page[dst&0xff] = val;
+    else
+        mem_write_slow(m, dst, val);
+}
 
 #endif
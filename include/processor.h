@@ -253,27 +253,44 @@ struct processor_t  {
     bool neg_st, over_st, brk_st, dec_st, ids_st, zero_st, carry_st;
 
     bool button_pressed;
+    /* levels driven from outside on the input pins of PTA and PTB */
+    uint8_t pins[2];
+
+    uint64_t cycles;
+
+    /* 64K hit counts of the PC pairs of jumps and branches, or NULL */
+    uint8_t* coverage;
 };
 
+/* bytes of the registers, flags and cycles saved by cpu_save_state */
+#define CPU_STATE_SIZE 18
+
 typedef void (*op_func)(struct processor_t*, struct mem*);
 
 struct cpu_op_handler_t {
     enum opcode_e op;
     op_func operation;
+    uint8_t cycles;
 };
 
 void cpu_init(struct processor_t *cpu);
 void cpu_load_res_addr(struct processor_t* cpu, struct mem* mem);
 void cpu_print_debug(struct processor_t *cpu);
+void cpu_save_state(struct processor_t* cpu, uint8_t* p);
+void cpu_load_state(struct processor_t* cpu, const uint8_t* p);
 
 uint8_t cpu_fetch(struct processor_t *cpu, struct mem* m);
 uint8_t cpu_get_operand_byte(struct processor_t *cpu, struct mem* m);
 uint16_t cpu_get_operand_short(struct processor_t *cpu, struct mem* m);
 
 int cpu_step(struct processor_t *cpu, struct mem* mem, enum opcode_e op);
+void cpu_interrupt(struct processor_t *cpu, struct mem* mem, uint16_t vector);
 
 int cpu_op_get_n_bytes(enum opcode_e op);
+int cpu_op_get_cycles(enum opcode_e op);
 enum processor_op_type_e cpu_get_op_type(enum opcode_e op);
 const char* cpu_get_op_name(enum opcode_e op);
+bool cpu_op_reads_ea(enum opcode_e op);
+bool cpu_op_supported(enum opcode_e op);
 
 #endif
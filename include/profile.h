@@ -0,0 +1,43 @@
+#ifndef __PROFILE_H__
+#define __PROFILE_H__
+
+#include <common.h>
+#include <stdio.h>
+#include <mem.h>
+#include <symbols.h>
+
+#define PROFILE_DEFAULT_LINES 20
+
+/* flat counters indexed by the PC of the instruction */
+struct profile_t {
+    uint64_t count[MEM_SIZE];
+    uint64_t cycles[MEM_SIZE];
+};
+
+struct profile_t* profile_new(void);
+void profile_free(struct profile_t* p);
+
+void profile_report(
+        FILE* fp, 
+        struct profile_t* p, 
+        struct mem* mem, 
+        struct symbols_t* syms, 
+        int lines
+);
+
+/*---------------------------------------------------*/
+/* brief: account one instruction at pc taking cycles */
+/*---------------------------------------*/
+static inline void profile_add(struct profile_t* p, uint16_t pc, uint64_t cycles) {
+    p->count[pc]++;
+    p->cycles[pc] += cycles;
+}
+
+/*---------------------------------------------------*/
+/* brief: account the cycles of an interrupt entry to the handler at pc */
+/*---------------------------------------*/
+static inline void profile_add_entry(struct profile_t* p, uint16_t pc, uint64_t cycles) {
+    p->cycles[pc] += cycles;
+}
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef __SAVESTATE_H__
+#define __SAVESTATE_H__
+
+#include <common.h>
+#include <machine.h>
+
+/*
+ * the whole board in one file, every field at a fixed offset:
+ *   "E65M" u16 version u16 offset of the memory u32 its size u32 0
+ *   CPU_STATE_SIZE bytes of cpu_save_state, with the button and the pins
+ *   MACHINE_DEVICE_SIZE bytes of machine_save_devices, the display and the via
+ *   the 64K of memory page after page, the port registers among it
+ * a file is read by the builds of its version only, whatever the compiler
+ */
+#define SV_MAGIC        "E65M"
+#define SV_VERSION      5
+
+#define SV_HEADER_SIZE  16
+#define SV_STATE_SIZE   (SV_HEADER_SIZE+CPU_STATE_SIZE+MACHINE_DEVICE_SIZE)
+#define SV_FILE_SIZE    (SV_STATE_SIZE+MEM_SIZE)
+
+int sv_save(struct machine_t* m, const char* filename);
+int sv_load(struct machine_t* m, const char* filename);
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef __SCRIPT_H__
+#define __SCRIPT_H__
+
+#include <common.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <cond.h>
+#include <input.h>
+
+#define SC_MAX_RULES    32
+#define SC_NEVER        UINT64_MAX
+
+struct machine_t;
+
+/*
+ * one line of a script, an input and when to apply it:
+ *   press at 1000 for 500 every 20000 times 4
+ *   ptb $80 at 0
+ *   press for 200 after 50 when mem[$4001]&$0f==$05
+ */
+struct sc_rule_t {
+    uint8_t device;
+    uint8_t value;
+
+    /* cycles from a press to its release, 0 for none */
+    uint64_t hold;
+    /* cycles between two presses of an at rule, 0 for once */
+    uint64_t every;
+    /* times the rule fires at most, 0 for no limit */
+    unsigned long times;
+
+    /* a when rule fires delay cycles after its condition turns true */
+    bool when;
+    struct cond_t cond;
+    uint64_t delay;
+    bool was_true;
+
+    uint64_t fire_at;
+    uint64_t release_at;
+    unsigned long fired;
+};
+
+/*
+ * the rules compiled once, then fed to the machine as cycle-stamped
+ * inputs by machine_feed at the cycles they are due, the conditions
+ * of the when rules that can still fire after every instruction
+ */
+struct script_t {
+    struct sc_rule_t rules[SC_MAX_RULES];
+    int n_rules;
+
+    /* every input applied, in order, to record as an input log */
+    struct input_log_t applied;
+};
+
+int sc_load(struct script_t* s, const char* filename, char* err, size_t n);
+void sc_dispose(struct script_t* s);
+void sc_attach(struct script_t* s, struct machine_t* m);
+uint64_t sc_feed(struct script_t* s, struct machine_t* m);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef __SHADOW_H__
+#define __SHADOW_H__
+
+#include <common.h>
+#include <stdbool.h>
+#include <mem.h>
+
+/* pages a single instruction can fault on before it ends */
+#define SHADOW_MAX_PENDING 8
+
+/* a protected page written by the instruction running */
+struct shadow_fault_t {
+    int page;
+    uint16_t addr;
+    uint8_t old[MEM_PAGE_SIZE];
+};
+
+/*
+ * linux only: watched pages live alone on a read-only host page, so
+ * stores to them fault while every other store stays a plain move;
+ * the fault handler unprotects the page and lets the instruction end,
+ * shadow_collect protects it again
+ */
+struct shadow_t {
+    struct mem* mem;
+
+    /* the host mapping of each protected page, NULL if not protected */
+    uint8_t* maps[MEM_PAGES];
+    size_t host_page;
+
+    /* the pages with a mapping, checked after each instruction */
+    int protected[MEM_PAGES];
+    int n_protected;
+
+    struct shadow_fault_t faults[SHADOW_MAX_PENDING];
+    int n_faults;
+};
+
+int shadow_init(struct shadow_t* s, struct mem* mem);
+void shadow_dispose(struct shadow_t* s);
+
+int shadow_protect(struct shadow_t* s, int page, bool on);
+int shadow_collect(struct shadow_t* s);
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef __SNAPSHOT_H__
+#define __SNAPSHOT_H__
+
+#include <mem.h>
+#include <processor.h>
+#include <machine.h>
+
+/* machine state sharing its memory pages copy-on-write */
+struct snapshot_t {
+    struct processor_t cpu;
+    struct mem mem;
+    struct lcd_t lcd;
+    struct via_t via;
+};
+
+void snapshot_take(struct snapshot_t* snap, struct machine_t* m);
+void snapshot_restore(struct snapshot_t* snap, struct machine_t* m);
+void snapshot_dispose(struct snapshot_t* snap);
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef __SNAPSTORE_H__
+#define __SNAPSTORE_H__
+
+#include <common.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <mem.h>
+#include <processor.h>
+#include <machine.h>
+
+/*
+ * directory of snapshots sharing their pages:
+ *   pages.pack  every distinct 256 byte page once, appended
+ *   <name>.snap "E65S" u16 version u16 0, CPU_STATE_SIZE bytes of
+ *               cpu_save_state, MACHINE_DEVICE_SIZE of machine_save_devices,
+ *               then the fnv-1a hash of each page, u64 le
+ * the hash to page index is rebuilt from the pack when it is opened
+ */
+#define SS_MAGIC        "E65S"
+#define SS_VERSION      5
+#define SS_PACK         "pages.pack"
+#define SS_MAX_NAME     4096
+
+#define SS_HEADER_SIZE  (8+CPU_STATE_SIZE+MACHINE_DEVICE_SIZE)
+#define SS_MANIFEST_SIZE (SS_HEADER_SIZE+8*MEM_PAGES)
+
+struct snapstore_t {
+    char dir[SS_MAX_NAME];
+    int pack;
+    uint32_t n_pages;
+
+    /* open addressing, page index+1 by hash, 0 for a free slot */
+    uint64_t* hashes;
+    uint32_t* slots;
+    size_t cap;
+};
+
+int ss_open(struct snapstore_t* st, const char* dir);
+void ss_close(struct snapstore_t* st);
+
+int ss_put(
+        struct snapstore_t* st,
+        const char* name,
+        struct machine_t* m,
+        int* added
+);
+int ss_get(
+        struct snapstore_t* st,
+        const char* name,
+        struct machine_t* m
+);
+
+#endif
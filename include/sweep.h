@@ -0,0 +1,56 @@
+#ifndef __SWEEP_H__
+#define __SWEEP_H__
+
+#include <common.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <machine.h>
+#include <breakpoint.h>
+#include <trace.h>
+
+#define SWEEP_MAX_WORKERS   64
+#define SWEEP_MAX_LIMITS    16
+#define SWEEP_DEFAULT_CYCLES 1000000
+
+/* one scenario at one cycle limit, written only by the worker running it */
+struct sweep_result_t {
+    const char* scenario;
+    uint64_t limit;
+
+    /* "cycle limit", a MACHINE_STOP_NAMES entry or "bad input" */
+    const char* stop;
+    unsigned long steps;
+    uint64_t cycles;
+    struct trace_regs_t regs;
+    uint64_t digest;
+};
+
+/*
+ * every input schedule of a directory against every cycle limit, on
+ * workers each owning a machine, the jobs are handed out by one counter
+ */
+struct sweep_t {
+    char* rom;
+    struct breakpoints_t* bp;
+
+    char** scenarios;
+    size_t n_scenarios;
+
+    uint64_t limits[SWEEP_MAX_LIMITS];
+    int n_limits;
+
+    /* in memory shared with the forked processes of sweep_explore */
+    struct sweep_result_t* results;
+    bool shared;
+    size_t n_jobs;
+    size_t next;
+};
+
+int sweep_init(struct sweep_t* s, char* rom, char* dir, struct breakpoints_t* bp);
+void sweep_dispose(struct sweep_t* s);
+int sweep_parse_limits(struct sweep_t* s, const char* list);
+int sweep_run(struct sweep_t* s, int workers);
+int sweep_explore(struct sweep_t* s, struct machine_t* m, int workers);
+int sweep_report(struct sweep_t* s, const char* filename);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef __SYMBOLS_H__
+#define __SYMBOLS_H__
+
+#include <common.h>
+#include <stddef.h>
+
+#define SYM_MAX_NAME 48
+
+struct symbol_t {
+    uint16_t addr;
+    char name[SYM_MAX_NAME];
+};
+
+/* sorted by address */
+struct symbols_t {
+    struct symbol_t* syms;
+    size_t n;
+};
+
+void sym_init(struct symbols_t* s);
+void sym_dispose(struct symbols_t* s);
+int sym_load(struct symbols_t* s, const char* filename);
+int sym_parse_addr(const char* tok, uint16_t* addr);
+
+struct symbol_t* sym_find(struct symbols_t* s, uint16_t addr);
+const char* sym_format(struct symbols_t* s, uint16_t addr, char* buf, size_t n);
+
+#endif
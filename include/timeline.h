@@ -0,0 +1,48 @@
+#ifndef __TIMELINE_H__
+#define __TIMELINE_H__
+
+#include <common.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <mem.h>
+#include <processor.h>
+#include <symbols.h>
+#include <callgraph.h>
+
+/* stdio buffer of the output, events are streamed through it */
+#define TL_BUFFER_SIZE (1<<20)
+
+/*
+ * chrome trace-event json of a run, for chrome://tracing or perfetto:
+ * a slice per subroutine call and an instant event per store to the
+ * ports, one cycle is shown as one microsecond as on a 1 MHz part
+ */
+struct timeline_t {
+    FILE* fp;
+    char* buf;
+
+    /* slices opened and closed as frames enter and leave it */
+    struct callgraph_t cg;
+    struct symbols_t* syms;
+
+    uint64_t cycle;
+    uint8_t op;
+    bool first;
+
+    unsigned long long events;
+};
+
+int tl_open(
+        struct timeline_t* tl, 
+        char* filename, 
+        struct processor_t* cpu, 
+        struct mem* mem, 
+        struct symbols_t* syms
+);
+int tl_close(struct timeline_t* tl, struct processor_t* cpu, struct mem* mem);
+
+void tl_begin(struct timeline_t* tl, struct processor_t* cpu, struct mem* mem);
+void tl_end(struct timeline_t* tl, struct processor_t* cpu, struct mem* mem);
+void tl_interrupt(struct timeline_t* tl, struct processor_t* cpu, struct mem* mem);
+
+#endif
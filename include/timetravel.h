@@ -0,0 +1,55 @@
+#ifndef __TIMETRAVEL_H__
+#define __TIMETRAVEL_H__
+
+#include <common.h>
+#include <stddef.h>
+#include <machine.h>
+#include <snapshot.h>
+#include <input.h>
+
+#define TT_DEFAULT_INTERVAL 100000
+
+/*
+ * keyframes are taken right after the step that reaches them, the
+ * inputs stamped with the same cycle are applied after the keyframe
+ */
+struct timetravel_t {
+    uint64_t interval;
+
+    struct snapshot_t* keys;
+    size_t n_keys;
+    size_t cap;
+
+    struct input_log_t input;
+    /* first recorded input not applied yet */
+    size_t cursor;
+};
+
+int tt_init(struct timetravel_t* tt, uint64_t interval);
+void tt_dispose(struct timetravel_t* tt);
+int tt_start(struct timetravel_t* tt, struct machine_t* m);
+
+int tt_step(struct timetravel_t* tt, struct machine_t* m);
+enum machine_stop_e tt_run(
+        struct timetravel_t* tt, 
+        struct machine_t* m, 
+        unsigned long steps, 
+        struct breakpoints_t* bp, 
+        struct watchpoints_t* wp, 
+        unsigned long* executed
+);
+void tt_input(
+        struct timetravel_t* tt, 
+        struct machine_t* m, 
+        uint8_t device, 
+        uint8_t value
+);
+int tt_replay(
+        struct timetravel_t* tt, 
+        struct machine_t* m, 
+        struct input_log_t* log
+);
+int tt_seek(struct timetravel_t* tt, struct machine_t* m, uint64_t cycle);
+void tt_sync(struct timetravel_t* tt, struct machine_t* m);
+
+#endif
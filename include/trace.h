@@ -0,0 +1,168 @@
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <common.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <mem.h>
+#include <processor.h>
+
+/*
+ * file: header, lz compressed memory image at the start, then blocks
+ *
+ * header: "E65T" u16 version u16 reserved u32 image_len
+ * block:  u32 raw_len u32 comp_len u32 n_records u64 index u64 cycle
+ *         u64 hash A X Y SP P u16 PC, then comp_len bytes
+ *
+ * index, cycle and registers are the state before the first record,
+ * records are delta encoded against it so every block decodes alone;
+ * hash is fnv-1a of the raw bytes. all values are little endian
+ *
+ * record: u8 cycles taken, 255 is followed by an u32, 0 marks what
+ * happened between two instructions and is followed by the writes, then
+ * the inputs applied: u8 n, n * (u8 device, u8 value), 254 marks the
+ * entry of an interrupt and is followed by a record of op 0, the brk
+ * the 65C02 forces in
+ *         u8 op, u8 flags, then the changed registers in flag order,
+ *         the new PC if it did not fall through, the effective address
+ *         writes: u8 n, n * (u16 addr, u8 val)
+ */
+#define TRACE_MAGIC "E65T"
+#define TRACE_VERSION 3
+
+#define TRACE_HEADER_SIZE 12
+#define TRACE_BLOCK_HEADER_SIZE 43
+
+#define TRACE_BLOCK_RECORDS 16384
+#define TRACE_BLOCK_SIZE 0x40000
+#define TRACE_MAX_WRITES 255
+#define TRACE_MAX_INPUTS 255
+#define TRACE_MAX_RECORD (18+TRACE_MAX_WRITES*3+TRACE_MAX_INPUTS*2)
+
+enum trace_flag_e {
+    TRACE_A =   1<<0,
+    TRACE_X =   1<<1,
+    TRACE_Y =   1<<2,
+    TRACE_SP =  1<<3,
+    TRACE_P =   1<<4,
+    TRACE_PC =  1<<5,
+    TRACE_EA =  1<<6,
+    TRACE_W =   1<<7,
+};
+
+/* the registers as seen by the trace, P packed like php pushes it */
+struct trace_regs_t {
+    uint8_t A, X, Y, SP, P;
+    uint16_t PC;
+};
+
+struct trace_write_t {
+    uint16_t addr;
+    uint8_t val;
+};
+
+/* an input event, applied with machine_input */
+struct trace_input_t {
+    uint8_t device;
+    uint8_t value;
+};
+
+struct trace_record_t {
+    /* between two instructions, only writes and inputs are meaningful */
+    bool external;
+    /* the entry of an interrupt, pc is the instruction it came before */
+    bool interrupt;
+
+    uint64_t index;
+    /* cycle count after the instruction */
+    uint64_t cycle;
+
+    uint16_t pc;
+    uint8_t op;
+    uint8_t flags;
+    /* registers after the instruction */
+    struct trace_regs_t regs;
+    /* memory operand address, -1 for none */
+    int ea;
+
+    int n_writes;
+    struct trace_write_t writes[TRACE_MAX_WRITES];
+
+    int n_inputs;
+    struct trace_input_t inputs[TRACE_MAX_INPUTS];
+};
+
+struct trace_block_t {
+    uint32_t raw_len;
+    uint32_t comp_len;
+    uint32_t n_records;
+    uint64_t index;
+    uint64_t cycle;
+    uint64_t hash;
+    struct trace_regs_t regs;
+};
+
+/* a block being filled by the emulator or written by the worker */
+struct trace_buf_t {
+    struct trace_block_t block;
+    uint8_t* raw;
+};
+
+struct trace_t {
+    FILE* fp;
+
+    struct trace_buf_t bufs[2];
+    int cur;
+
+    /* state after the last record */
+    struct trace_regs_t regs;
+    uint64_t index;
+    uint64_t cycle;
+
+    uint16_t pc;
+    uint8_t op;
+
+    int n_writes;
+    struct trace_write_t writes[TRACE_MAX_WRITES];
+
+    /* inputs applied since the last instruction */
+    int n_inputs;
+    struct trace_input_t inputs[TRACE_MAX_INPUTS];
+
+    /* background writer, owns queued until it sets it back to NULL */
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    struct trace_buf_t* queued;
+    bool done;
+    int error;
+
+    uint8_t* comp;
+    uint64_t file_bytes;
+};
+
+int trace_open(
+        struct trace_t* t, 
+        char* filename, 
+        struct processor_t* cpu, 
+        struct mem* mem
+);
+int trace_close(struct trace_t* t, struct mem* mem);
+
+void trace_begin(struct trace_t* t, struct processor_t* cpu, struct mem* mem);
+void trace_end(struct trace_t* t, struct processor_t* cpu, struct mem* mem);
+void trace_interrupt(struct trace_t* t, struct processor_t* cpu, struct mem* mem);
+void trace_input(void* ctx, uint8_t device, uint8_t value);
+
+uint8_t trace_pack_status(struct processor_t* cpu);
+void trace_get_regs(struct processor_t* cpu, struct trace_regs_t* regs);
+uint64_t trace_hash(const uint8_t* data, size_t n);
+
+int trace_parse_header(const uint8_t* p, size_t n, uint32_t* image_len);
+int trace_parse_block(const uint8_t* p, size_t n, struct trace_block_t* block);
+void trace_record_init(struct trace_record_t* rec, struct trace_block_t* block);
+size_t trace_decode(const uint8_t* p, size_t n, struct trace_record_t* rec);
+
+#endif
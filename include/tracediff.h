@@ -0,0 +1,42 @@
+#ifndef __TRACEDIFF_H__
+#define __TRACEDIFF_H__
+
+#include <common.h>
+#include <stddef.h>
+#include <trace.h>
+#include <tracefile.h>
+#include <machine.h>
+
+#define TD_DEFAULT_CONTEXT 8
+#define TD_MAX_CONTEXT 256
+
+/* results, in the spirit of diff(1) */
+enum td_result_e {
+    TD_SAME = 0,
+    TD_DIFFERENT = 1,
+    TD_ERROR = 2,
+};
+
+/* the last records both runs agreed on */
+struct td_context_t {
+    struct trace_record_t* recs;
+    int size;
+    int n;
+    int head;
+};
+
+int td_compare(
+        struct trace_record_t* a, 
+        struct trace_record_t* b, 
+        char* what, 
+        size_t n
+);
+int td_diff_files(struct tracefile_t* a, struct tracefile_t* b, int context);
+int td_diff_live(
+        struct tracefile_t* golden, 
+        struct machine_t* m, 
+        unsigned long steps, 
+        int context
+);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef __TRACEFILE_H__
+#define __TRACEFILE_H__
+
+#include <common.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <trace.h>
+
+struct tf_block_t {
+    struct trace_block_t hdr;
+    /* file offset of the compressed bytes */
+    size_t offset;
+};
+
+/* a trace file mapped in memory, blocks are expanded on demand */
+struct tracefile_t {
+    const uint8_t* map;
+    size_t size;
+
+    uint32_t image_len;
+
+    struct tf_block_t* blocks;
+    size_t n_blocks;
+
+    /* the last expanded block */
+    uint8_t* raw;
+    long raw_block;
+};
+
+/* walks the records of a trace across blocks */
+struct tf_cursor_t {
+    struct tracefile_t* tf;
+    size_t block;
+    uint32_t left;
+    size_t pos;
+    struct trace_record_t rec;
+};
+
+int tf_open(struct tracefile_t* tf, const char* filename);
+int tf_scan(struct tracefile_t* tf);
+void tf_close(struct tracefile_t* tf);
+
+int tf_load_image(struct tracefile_t* tf, uint8_t* image);
+const uint8_t* tf_expand(struct tracefile_t* tf, size_t block);
+size_t tf_find_cycle(struct tracefile_t* tf, uint64_t cycle);
+
+void tf_cursor_init(struct tf_cursor_t* c, struct tracefile_t* tf, size_t block);
+int tf_next(struct tf_cursor_t* c);
+
+void tf_print_record(FILE* fp, struct trace_record_t* rec, const uint8_t* image);
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef __VIA_H__
+#define __VIA_H__
+
+#include <common.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define VIA_NEVER       UINT64_MAX
+
+/* registers, the page of the via repeats them every 16 bytes */
+#define VIA_ORB         0x0
+#define VIA_ORA         0x1
+#define VIA_DDRB        0x2
+#define VIA_DDRA        0x3
+#define VIA_T1CL        0x4
+#define VIA_T1CH        0x5
+#define VIA_T1LL        0x6
+#define VIA_T1LH        0x7
+#define VIA_T2CL        0x8
+#define VIA_T2CH        0x9
+#define VIA_SR          0xa
+#define VIA_ACR         0xb
+#define VIA_PCR         0xc
+#define VIA_IFR         0xd
+#define VIA_IER         0xe
+#define VIA_ORA_NH      0xf
+
+/* the interrupt flags */
+#define VIA_IRQ_CA2     (1<<0)
+#define VIA_IRQ_CA1     (1<<1)
+#define VIA_IRQ_SR      (1<<2)
+#define VIA_IRQ_CB2     (1<<3)
+#define VIA_IRQ_CB1     (1<<4)
+#define VIA_IRQ_T2      (1<<5)
+#define VIA_IRQ_T1      (1<<6)
+#define VIA_IRQ_ANY     (1<<7)
+
+/* bytes written by via_save_state */
+#define VIA_STATE_SIZE  73
+
+/*
+ * 65C22 versatile interface adapter. The timers and the shift register
+ * are not counted down instruction by instruction: a load keeps the
+ * cycle and the value it started from, reads compute the count at the
+ * cycle they happen, and the cycle the next flag rises is worked out
+ * once and kept in due for via_update. Nothing is wired to the ports,
+ * the handshake lines nor PB6, their inputs read high.
+ */
+struct via_t {
+    uint8_t orb;
+    uint8_t ora;
+    uint8_t ddrb;
+    uint8_t ddra;
+    uint8_t acr;
+    uint8_t pcr;
+    uint8_t ifr;
+    uint8_t ier;
+
+    /* timer 1 held t1_count at t1_start, then counts down and reloads */
+    uint16_t t1_latch;
+    uint16_t t1_count;
+    uint64_t t1_start;
+    uint64_t t1_due;
+
+    /* timer 2 held t2_count at t2_start, it interrupts once a load */
+    uint8_t t2_latch;
+    uint16_t t2_count;
+    uint64_t t2_start;
+    uint64_t t2_due;
+    /* loaded and not yet reached 0, whether counting time or pulses */
+    bool t2_armed;
+
+    /* the shift register held sr at sr_start, a bit every sr_period */
+    uint8_t sr;
+    uint64_t sr_start;
+    uint64_t sr_period;
+    uint64_t sr_due;
+
+    /* earliest of the cycles above, and the level of the irq line */
+    uint64_t due;
+    bool irq;
+
+    /* accesses and flags raised, for the time travel */
+    unsigned long changes;
+};
+
+void via_init(struct via_t* via);
+void via_update(struct via_t* via, uint64_t now);
+
+uint8_t via_peek(struct via_t* via, uint64_t now, uint8_t reg);
+void via_read(struct via_t* via, uint64_t now, uint8_t reg);
+void via_write(struct via_t* via, uint64_t now, uint8_t reg, uint8_t val);
+
+void via_save_state(struct via_t* via, uint8_t* p);
+void via_load_state(struct via_t* via, const uint8_t* p);
+
+#endif
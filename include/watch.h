@@ -0,0 +1,93 @@
+#ifndef __WATCH_H__
+#define __WATCH_H__
+
+#include <common.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <mem.h>
+#include <processor.h>
+#include <cond.h>
+#include <shadow.h>
+
+#define WATCH_READ   (1<<0)
+#define WATCH_WRITE  (1<<1)
+/* a store changing the value */
+#define WATCH_CHANGE (1<<2)
+
+#define WATCH_MAX 16
+
+struct watch_t {
+    uint16_t lo;
+    uint16_t hi;
+    uint8_t kind;
+
+    /* checked at the access, with the instruction half done */
+    bool has_cond;
+    struct cond_t cond;
+};
+
+/* the first access of an instruction hitting a watchpoint */
+struct watch_hit_t {
+    uint8_t kind;
+    uint16_t addr;
+    uint8_t old;
+    uint8_t val;
+
+    uint16_t pc;
+    uint8_t op;
+    uint64_t cycle;
+};
+
+/*
+ * stores reach the watchpoints through the watch hook of the pages
+ * they cover, or fault on them with a shadow, other pages keep the
+ * fast path; reads are matched on the effective address of the
+ * instruction, once it ran
+ */
+struct watchpoints_t {
+    struct watch_t w[WATCH_MAX];
+    int n;
+
+    /* kinds of the watchpoints covering each page */
+    uint8_t pages[MEM_PAGES];
+
+    /* if set, stores are caught by page protection instead of the hook */
+    struct shadow_t* shadow;
+
+    /* instruction running, filled by watch_begin */
+    struct processor_t* cpu;
+    struct mem* mem;
+    uint16_t pc;
+    uint8_t op;
+    uint64_t cycle;
+
+    bool hit;
+    struct watch_hit_t last;
+};
+
+void watch_init(struct watchpoints_t* wp);
+void watch_attach(struct watchpoints_t* wp, struct mem* mem);
+void watch_detach(struct watchpoints_t* wp, struct mem* mem);
+
+int watch_parse(const char* spec, struct watch_t* w, char* err, size_t n);
+int watch_add(struct watchpoints_t* wp, struct mem* mem, struct watch_t* w);
+int watch_remove(struct watchpoints_t* wp, struct mem* mem, struct watch_t* w);
+
+bool watch_end(struct watchpoints_t* wp, struct processor_t* cpu, struct mem* mem);
+int watch_format(struct watch_hit_t* hit, struct mem* mem, char* buf, size_t n);
+
+/*---------------------------------------------------*/
+/* brief: note the instruction about to run */
+/*---------------------------------------*/
+static inline void watch_begin(
+    struct watchpoints_t* wp, struct processor_t* cpu, struct mem* mem) 
+{
+    wp->cpu = cpu;
+    wp->mem = mem;
+    wp->pc = cpu->PC;
+    wp->op = mem_fetch_byte(mem, cpu->PC);
+    wp->cycle = cpu->cycles;
+    wp->hit = false;
+}
+
+#endif
@@ -0,0 +1,146 @@
+#include <breakpoint.h>
+#include <stdio.h>
+#include <string.h>
+#include <symbols.h>
+
+static void bp_clear_conds(struct breakpoints_t* bp, uint16_t addr) {
+    for(int i=0; i<bp->n_conds; ) {
+        if(bp->conds[i].addr==addr)
+            bp->conds[i] = bp->conds[--bp->n_conds];
+        else
+            i++;
+    }
+}
+
+/*---------------------------------------------------*/
+/* brief: init with no breakpoint */
+/*---------------------------------------*/
+void bp_init(struct breakpoints_t* bp) {
+    memset(bp, 0, sizeof(*bp));
+}
+
+/*---------------------------------------------------*/
+/* brief: stop before the instruction at addr, whatever the state */
+/*---------------------------------------*/
+void bp_set(struct breakpoints_t* bp, uint16_t addr) {
+    bp_clear_conds(bp, addr);
+
+    if(!bp_test(bp, addr)) {
+        bp->bits[addr>>6] |= 1ull<<(addr&63);
+        bp->count++;
+    }
+}
+
+/*---------------------------------------------------*/
+/* brief: remove the breakpoint at addr, if any */
+/*---------------------------------------*/
+void bp_clear(struct breakpoints_t* bp, uint16_t addr) {
+    bp_clear_conds(bp, addr);
+
+    if(bp_test(bp, addr)) {
+        bp->bits[addr>>6] &= ~(1ull<<(addr&63));
+        bp->count--;
+    }
+}
+
+/*---------------------------------------------------*/
+/* brief: flip the breakpoint at addr, return true if now set */
+/*---------------------------------------*/
+bool bp_toggle(struct breakpoints_t* bp, uint16_t addr) {
+    if(bp_test(bp, addr)) {
+        bp_clear(bp, addr);
+        return false;
+    }
+
+    bp_set(bp, addr);
+    return true;
+}
+
+/*---------------------------------------------------*/
+/* brief: stop before the instruction at addr when cond holds */
+/*---------------------------------------*/
+int bp_set_cond(struct breakpoints_t* bp, uint16_t addr, struct cond_t* cond) {
+    bool conditional = false;
+    for(int i=0; i<bp->n_conds; i++) {
+        conditional |= bp->conds[i].addr==addr;
+    }
+
+    // an unconditional breakpoint already stops there
+    if(bp_test(bp, addr) && !conditional)
+        return 0;
+
+    if(bp->n_conds==BP_MAX_CONDS)
+        return 1;
+
+    bp->conds[bp->n_conds].addr = addr;
+    bp->conds[bp->n_conds].cond = *cond;
+    bp->n_conds++;
+
+    if(!bp_test(bp, addr)) {
+        bp->bits[addr>>6] |= 1ull<<(addr&63);
+        bp->count++;
+    }
+
+    return 0;
+}
+
+/*---------------------------------------------------*/
+/* brief: true if the breakpoint hit at PC has to stop the run */
+/*---------------------------------------*/
+bool bp_check(struct breakpoints_t* bp, struct processor_t* cpu, struct mem* mem) {
+    bool conditional = false;
+
+    for(int i=0; i<bp->n_conds; i++) {
+        if(bp->conds[i].addr!=cpu->PC)
+            continue;
+
+        if(cond_eval(&bp->conds[i].cond, cpu, mem))
+            return true;
+        conditional = true;
+    }
+
+    return !conditional;
+}
+
+/*---------------------------------------------------*/
+/* brief: parse "addr", "addr if cond" or a cond with a PC==addr term */
+/*---------------------------------------*/
+int bp_parse(
+    const char* spec, uint16_t* addr, 
+    struct cond_t* cond, bool* has_cond, char* err, size_t n) 
+{
+    char buf[COND_MAX_TEXT];
+    snprintf(buf, sizeof(buf), "%s", spec);
+
+    *has_cond = false;
+
+    char* sep = strstr(buf, " if ");
+    if(sep!=NULL)
+        *sep = '\0';
+
+    if(sym_parse_addr(buf, addr)==0) {
+        if(sep==NULL)
+            return 0;
+
+        *has_cond = true;
+        return cond_compile(cond, sep+4, err, n);
+    }
+
+    if(sep!=NULL) {
+        snprintf(err, n, "bad address %s", buf);
+        return 1;
+    }
+
+    if(cond_compile(cond, spec, err, n)!=0)
+        return 1;
+
+    if(!cond->has_pc) {
+        snprintf(err, n, "a condition needs an address or a PC==addr term");
+        return 1;
+    }
+
+    *addr = cond->pc;
+    *has_cond = true;
+
+    return 0;
+}
@@ -0,0 +1,171 @@
+#include <callgraph.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int32_t cg_new_node(struct callgraph_t* cg, uint16_t addr, int32_t parent) {
+    if(cg->n_nodes==cg->cap) {
+        size_t cap = cg->cap ? cg->cap*2 : 256;
+        struct cg_node_t* nodes = realloc(cg->nodes, cap*sizeof(*nodes));
+
+        if(nodes==NULL)
+            return -1;
+
+        cg->nodes = nodes;
+        cg->cap = cap;
+    }
+
+    struct cg_node_t* node = &cg->nodes[cg->n_nodes];
+    memset(node, 0, sizeof(*node));
+    node->addr = addr;
+    node->parent = parent;
+    node->child = -1;
+    node->sibling = -1;
+
+    if(parent>=0) {
+        node->sibling = cg->nodes[parent].child;
+        cg->nodes[parent].child = cg->n_nodes;
+    }
+
+    return cg->n_nodes++;
+}
+
+/*---------------------------------------------------*/
+/* brief: init the graph with the routine running at entry */
+/*---------------------------------------*/
+int cg_init(struct callgraph_t* cg, uint16_t entry) {
+    memset(cg, 0, sizeof(*cg));
+
+    if(cg_new_node(cg, entry, -1)<0)
+        return 1;
+
+    cg->stack[0].node = 0;
+    cg->depth = 1;
+
+    return 0;
+}
+
+/*---------------------------------------------------*/
+/* brief: release the call paths */
+/*---------------------------------------*/
+void cg_dispose(struct callgraph_t* cg) {
+    free(cg->nodes);
+    memset(cg, 0, sizeof(*cg));
+}
+
+/*---------------------------------------------------*/
+/* brief: enter target, sp as left by the call */
+/*---------------------------------------*/
+void cg_call(struct callgraph_t* cg, uint16_t target, uint8_t sp) {
+    if(cg->depth==CG_MAX_DEPTH) {
+        cg->overflow++;
+        return;
+    }
+
+    int32_t parent = cg->stack[cg->depth-1].node;
+    int32_t node = cg->nodes[parent].child;
+
+    while(node>=0 && cg->nodes[node].addr!=target) {
+        node = cg->nodes[node].sibling;
+    }
+
+    if(node<0 && (node = cg_new_node(cg, target, parent))<0) {
+        cg->overflow++;
+        return;
+    }
+
+    cg->nodes[node].calls++;
+    cg->stack[cg->depth].node = node;
+    cg->stack[cg->depth].sp = sp;
+    cg->depth++;
+}
+
+/*---------------------------------------------------*/
+/* brief: write the path of node as root;...;node */
+/*---------------------------------------*/
+static void cg_print_path(
+    struct callgraph_t* cg, FILE* fp, struct symbols_t* syms, int32_t node) 
+{
+    int32_t path[CG_MAX_DEPTH];
+    int n = 0;
+
+    for(; node>=0 && n<CG_MAX_DEPTH; node = cg->nodes[node].parent) {
+        path[n++] = node;
+    }
+
+    for(int i=n-1; i>=0; i--) {
+        char name[SYM_MAX_NAME+8];
+        sym_format(syms, cg->nodes[path[i]].addr, name, sizeof(name));
+        fprintf(fp, "%s%s", name, i ? ";" : "");
+    }
+}
+
+/*---------------------------------------------------*/
+/* brief: one "path cycles" line per path, for flame graph scripts */
+/*---------------------------------------*/
+int cg_write_folded(struct callgraph_t* cg, FILE* fp, struct symbols_t* syms) {
+    for(size_t i=0; i<cg->n_nodes; i++) {
+        if(cg->nodes[i].self==0)
+            continue;
+
+        cg_print_path(cg, fp, syms, i);
+        fprintf(fp, " %llu\n", (unsigned long long)cg->nodes[i].self);
+    }
+
+    return ferror(fp);
+}
+
+struct cg_line_t {
+    int32_t node;
+    uint64_t incl;
+};
+
+static int cg_compare(const void* a, const void* b) {
+    uint64_t ia = ((const struct cg_line_t*)a)->incl;
+    uint64_t ib = ((const struct cg_line_t*)b)->incl;
+
+    return ia<ib ? 1 : ia>ib ? -1 : 0;
+}
+
+/*---------------------------------------------------*/
+/* brief: print the call paths sorted by inclusive cycles */
+/*---------------------------------------*/
+void cg_report(
+    struct callgraph_t* cg, FILE* fp, struct symbols_t* syms, int lines) 
+{
+    struct cg_line_t* order = malloc(cg->n_nodes*sizeof(*order));
+    if(order==NULL)
+        return;
+
+    for(size_t i=0; i<cg->n_nodes; i++) {
+        order[i].node = i;
+        order[i].incl = cg->nodes[i].self;
+    }
+
+    // children are created after their parent
+    for(size_t i=cg->n_nodes-1; i>0; i--) {
+        order[cg->nodes[i].parent].incl += order[i].incl;
+    }
+
+    uint64_t total = order[0].incl;
+    qsort(order, cg->n_nodes, sizeof(*order), cg_compare);
+
+    fprintf(fp, "%14s %7s %14s %10s  %s\n", 
+        "inclusive", "%", "exclusive", "calls", "path");
+
+    for(size_t i=0; i<cg->n_nodes && (lines<=0 || i<(size_t)lines); i++) {
+        struct cg_node_t* node = &cg->nodes[order[i].node];
+
+        fprintf(fp, "%14llu %6.2f%% %14llu %10llu  ",
+            (unsigned long long)order[i].incl, 
+            total ? 100.0*order[i].incl/total : 0,
+            (unsigned long long)node->self, (unsigned long long)node->calls);
+        cg_print_path(cg, fp, syms, order[i].node);
+        fprintf(fp, "\n");
+    }
+
+    if(cg->overflow>0)
+        fprintf(fp, "%lu calls beyond depth %d not tracked\n", 
+            cg->overflow, CG_MAX_DEPTH);
+
+    free(order);
+}
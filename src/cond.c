@@ -0,0 +1,384 @@
+#include <cond.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <trace.h>
+
+struct cond_parser_t {
+    const char* p;
+    struct cond_t* c;
+    /* values on the stack when the code so far runs */
+    int stack;
+
+    char* err;
+    size_t n;
+    bool failed;
+};
+
+static const struct {
+    const char* name;
+    enum cond_reg_e reg;
+} cond_regs[] = {
+    {"A", COND_REG_A}, {"X", COND_REG_X}, {"Y", COND_REG_Y},
+    {"SP", COND_REG_SP}, {"PC", COND_REG_PC}, {"P", COND_REG_P},
+    {"C", COND_REG_C}, {"Z", COND_REG_Z}, {"I", COND_REG_I},
+    {"D", COND_REG_D}, {"B", COND_REG_B}, {"V", COND_REG_V},
+    {"N", COND_REG_N},
+};
+
+static void cond_error(struct cond_parser_t* p, const char* msg) {
+    if(!p->failed)
+        snprintf(p->err, p->n, "%s at \"%.10s\"", msg, p->p);
+    p->failed = true;
+}
+
+static void cond_emit(struct cond_parser_t* p, uint8_t byte) {
+    if(p->c->len==COND_MAX_CODE-1) {
+        cond_error(p, "condition too long");
+        return;
+    }
+    p->c->code[p->c->len++] = byte;
+}
+
+/* emit an operation, tracking the depth the evaluation will reach */
+static void cond_emit_op(struct cond_parser_t* p, enum cond_op_e op) {
+    switch(op) {
+        case COND_PUSH:
+        case COND_REG:
+        case COND_CYCLES:
+            if(++p->stack>COND_MAX_STACK)
+                cond_error(p, "condition too deep");
+            break;
+        case COND_END:
+        case COND_LOAD:
+        case COND_NOT:
+        case COND_NEG:
+        case COND_INV:
+            break;
+        default:
+            p->stack--;
+            break;
+    }
+
+    cond_emit(p, op);
+}
+
+static void cond_skip(struct cond_parser_t* p) {
+    while(isspace((unsigned char)*p->p)) {
+        p->p++;
+    }
+}
+
+/* consume tok unless it is the start of a longer operator in not */
+static bool cond_accept(struct cond_parser_t* p, const char* tok, const char* not) {
+    cond_skip(p);
+
+    if(strncmp(p->p, tok, strlen(tok))!=0)
+        return false;
+    if(not!=NULL && strncmp(p->p, not, strlen(not))==0)
+        return false;
+
+    p->p += strlen(tok);
+    return true;
+}
+
+static void cond_parse_or(struct cond_parser_t* p, bool top);
+
+static void cond_parse_number(struct cond_parser_t* p) {
+    const char* s = p->p;
+    int base = 10;
+
+    if(*s=='$') {
+        base = 16;
+        s++;
+    } else if(s[0]=='0' && (s[1]=='x' || s[1]=='X')) {
+        base = 16;
+        s += 2;
+    } else if(*s=='%') {
+        base = 2;
+        s++;
+    }
+
+    char* end;
+    unsigned long val = strtoul(s, &end, base);
+
+    if(end==s || val>0xffff) {
+        cond_error(p, "bad number");
+        return;
+    }
+    p->p = end;
+
+    cond_emit_op(p, COND_PUSH);
+    cond_emit(p, val & 0xff);
+    cond_emit(p, val>>8);
+}
+
+static void cond_parse_primary(struct cond_parser_t* p) {
+    cond_skip(p);
+
+    if(cond_accept(p, "(", NULL)) {
+        cond_parse_or(p, false);
+        if(!cond_accept(p, ")", NULL))
+            cond_error(p, "missing )");
+        return;
+    }
+
+    if(cond_accept(p, "[", NULL)) {
+        cond_parse_or(p, false);
+        if(!cond_accept(p, "]", NULL))
+            cond_error(p, "missing ]");
+        cond_emit_op(p, COND_LOAD);
+        return;
+    }
+
+    if(isdigit((unsigned char)*p->p) || *p->p=='$' || *p->p=='%') {
+        cond_parse_number(p);
+        return;
+    }
+
+    const char* s = p->p;
+    while(isalnum((unsigned char)*p->p) || *p->p=='_') {
+        p->p++;
+    }
+    size_t len = p->p-s;
+
+    if(len==3 && strncasecmp(s, "mem", 3)==0) {
+        if(!cond_accept(p, "[", NULL)) {
+            cond_error(p, "missing [");
+            return;
+        }
+        cond_parse_or(p, false);
+        if(!cond_accept(p, "]", NULL))
+            cond_error(p, "missing ]");
+        cond_emit_op(p, COND_LOAD);
+        return;
+    }
+
+    if(len==6 && strncasecmp(s, "cycles", 6)==0) {
+        cond_emit_op(p, COND_CYCLES);
+        return;
+    }
+
+    for(int i=0; i<sizeof(cond_regs)/sizeof(cond_regs[0]); i++) {
+        if(strlen(cond_regs[i].name)==len
+            && strncasecmp(s, cond_regs[i].name, len)==0)
+        {
+            cond_emit_op(p, COND_REG);
+            cond_emit(p, cond_regs[i].reg);
+            return;
+        }
+    }
+
+    p->p = s;
+    cond_error(p, len ? "unknown name" : "expected a value");
+}
+
+static void cond_parse_unary(struct cond_parser_t* p) {
+    if(cond_accept(p, "!", "!=")) {
+        cond_parse_unary(p);
+        cond_emit_op(p, COND_NOT);
+    } else if(cond_accept(p, "-", NULL)) {
+        cond_parse_unary(p);
+        cond_emit_op(p, COND_NEG);
+    } else if(cond_accept(p, "~", NULL)) {
+        cond_parse_unary(p);
+        cond_emit_op(p, COND_INV);
+    } else {
+        cond_parse_primary(p);
+    }
+}
+
+/* the levels of binary operators, loosest first after && */
+static const struct {
+    const char* tok;
+    const char* not;
+    enum cond_op_e op;
+    int level;
+} cond_binary[] = {
+    {"|", "||", COND_OR, 0},
+    {"^", NULL, COND_XOR, 1},
+    {"&", "&&", COND_AND, 2},
+    {"==", NULL, COND_EQ, 3},
+    {"!=", NULL, COND_NE, 3},
+    {"<=", NULL, COND_LE, 4},
+    {">=", NULL, COND_GE, 4},
+    {"<", NULL, COND_LT, 4},
+    {">", NULL, COND_GT, 4},
+    {"+", NULL, COND_ADD, 5},
+    {"-", NULL, COND_SUB, 5},
+};
+
+#define COND_LEVELS 6
+
+static void cond_parse_binary(struct cond_parser_t* p, int level) {
+    if(level==COND_LEVELS) {
+        cond_parse_unary(p);
+        return;
+    }
+
+    cond_parse_binary(p, level+1);
+
+    for(bool more=true; more && !p->failed; ) {
+        more = false;
+
+        for(int i=0; i<sizeof(cond_binary)/sizeof(cond_binary[0]); i++) {
+            if(cond_binary[i].level==level
+                && cond_accept(p, cond_binary[i].tok, cond_binary[i].not))
+            {
+                cond_parse_binary(p, level+1);
+                cond_emit_op(p, cond_binary[i].op);
+                more = true;
+                break;
+            }
+        }
+    }
+}
+
+/* true if code from start is PC==k or k==PC */
+static bool cond_match_pc(struct cond_t* c, int start, uint16_t* pc) {
+    static const uint8_t reg[] = {COND_REG, COND_REG_PC};
+    uint8_t* code = c->code+start;
+
+    if(c->len-start!=6 || code[5]!=COND_EQ)
+        return false;
+
+    if(memcmp(code, reg, 2)==0 && code[2]==COND_PUSH) {
+        *pc = code[3] | code[4]<<8;
+        return true;
+    }
+    if(code[0]==COND_PUSH && memcmp(code+3, reg, 2)==0) {
+        *pc = code[1] | code[2]<<8;
+        return true;
+    }
+
+    return false;
+}
+
+static void cond_parse_and(struct cond_parser_t* p, bool top) {
+    bool first = true;
+
+    do {
+        int start = p->c->len;
+        uint16_t pc;
+
+        cond_parse_binary(p, 0);
+
+        if(top && !p->c->has_pc && cond_match_pc(p->c, start, &pc)) {
+            p->c->has_pc = true;
+            p->c->pc = pc;
+        }
+
+        if(!first)
+            cond_emit_op(p, COND_LAND);
+        first = false;
+    } while(!p->failed && cond_accept(p, "&&", NULL));
+}
+
+static void cond_parse_or(struct cond_parser_t* p, bool top) {
+    cond_parse_and(p, top);
+
+    while(!p->failed && cond_accept(p, "||", NULL)) {
+        cond_parse_and(p, false);
+        cond_emit_op(p, COND_LOR);
+
+        // any alternative can hit elsewhere
+        if(top)
+            p->c->has_pc = false;
+    }
+}
+
+/*---------------------------------------------------*/
+/* brief: compile text, on error describe it in err */
+/*---------------------------------------*/
+int cond_compile(struct cond_t* c, const char* text, char* err, size_t n) {
+    struct cond_parser_t p = { text, c, 0, err, n, false };
+
+    memset(c, 0, sizeof(*c));
+    snprintf(c->text, sizeof(c->text), "%s", text);
+
+    cond_parse_or(&p, true);
+
+    cond_skip(&p);
+    if(!p.failed && *p.p!='\0')
+        cond_error(&p, "unexpected text");
+
+    cond_emit_op(&p, COND_END);
+
+    return p.failed;
+}
+
+/*---------------------------------------------------*/
+/* brief: evaluate against the machine, non zero means true */
+/*---------------------------------------*/
+int64_t cond_eval(const struct cond_t* c, struct processor_t* cpu, struct mem* mem) {
+    int64_t stack[COND_MAX_STACK];
+    int sp = 0;
+    const uint8_t* ip = c->code;
+
+    while(true) {
+        switch(*ip++) {
+            case COND_END:
+                return sp>0 ? stack[sp-1] : 0;
+            case COND_PUSH:
+                stack[sp++] = ip[0] | ip[1]<<8;
+                ip += 2;
+                break;
+            case COND_REG:
+                switch(*ip++) {
+                    case COND_REG_A:  stack[sp++] = cpu->A; break;
+                    case COND_REG_X:  stack[sp++] = cpu->X; break;
+                    case COND_REG_Y:  stack[sp++] = cpu->Y; break;
+                    case COND_REG_SP: stack[sp++] = cpu->SP; break;
+                    case COND_REG_PC: stack[sp++] = cpu->PC; break;
+                    case COND_REG_P:  stack[sp++] = trace_pack_status(cpu); break;
+                    case COND_REG_C:  stack[sp++] = cpu->carry; break;
+                    case COND_REG_Z:  stack[sp++] = cpu->zero; break;
+                    case COND_REG_I:  stack[sp++] = cpu->ids; break;
+                    case COND_REG_D:  stack[sp++] = cpu->dec; break;
+                    case COND_REG_B:  stack[sp++] = cpu->brk; break;
+                    case COND_REG_V:  stack[sp++] = cpu->over; break;
+                    case COND_REG_N:  stack[sp++] = cpu->neg; break;
+                }
+                break;
+            case COND_CYCLES:
+                stack[sp++] = cpu->cycles;
+                break;
+            case COND_LOAD:
+                stack[sp-1] = mem_get_data_byte(mem, stack[sp-1]);
+                break;
+            case COND_NOT:
+                stack[sp-1] = !stack[sp-1];
+                break;
+            case COND_NEG:
+                stack[sp-1] = -stack[sp-1];
+                break;
+            case COND_INV:
+                stack[sp-1] = ~stack[sp-1];
+                break;
+            default:
+                sp--;
+                int64_t a = stack[sp-1];
+                int64_t b = stack[sp];
+
+                switch(ip[-1]) {
+                    case COND_ADD:  a = a+b; break;
+                    case COND_SUB:  a = a-b; break;
+                    case COND_AND:  a = a&b; break;
+                    case COND_OR:   a = a|b; break;
+                    case COND_XOR:  a = a^b; break;
+                    case COND_EQ:   a = a==b; break;
+                    case COND_NE:   a = a!=b; break;
+                    case COND_LT:   a = a<b; break;
+                    case COND_LE:   a = a<=b; break;
+                    case COND_GT:   a = a>b; break;
+                    case COND_GE:   a = a>=b; break;
+                    case COND_LAND: a = a && b; break;
+                    case COND_LOR:  a = a || b; break;
+                }
+                stack[sp-1] = a;
+                break;
+        }
+    }
+}
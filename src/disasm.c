@@ -0,0 +1,55 @@
+#include <disasm.h>
+#include <processor.h>
+#include <stdio.h>
+
+/*---------------------------------------------------*/
+/* brief: format the instruction in ins (opcode and operands) */
+/* return the number of operand bytes */
+/*---------------------------------------*/
+int disasm(const uint8_t* ins, char* buf, size_t n) {
+    int bytes = cpu_op_get_n_bytes(ins[0]);
+    const char* name = cpu_get_op_name(ins[0]);
+
+    if(name==NULL)
+        name = "?";
+
+    enum processor_op_type_e op_t = cpu_get_op_type(ins[0]);
+
+    const char* prefix = "";
+    if(op_t == OP_IMM) {
+        prefix = "#";
+    } else if(op_t == OP_X_IND){ 
+        prefix = "X,";
+    }
+
+    char oper[8] = "";
+    if(bytes==1) {
+        snprintf(oper, sizeof(oper), "$%02x", ins[1]);
+    } else if(bytes==2) {
+        snprintf(oper, sizeof(oper), "$%02x%02x ", ins[2], ins[1]);
+    }
+
+    const char* suffix = "";
+    if(op_t == OP_ABS_X || op_t == OP_ZPG_X) {
+        suffix = ",X";
+    } else if(op_t == OP_ABS_Y || op_t == OP_ZPG_Y || op_t == OP_IND_Y) {
+        suffix = ",Y";
+    }
+
+    snprintf(buf, n, "%s %s%s%s", name, prefix, oper, suffix);
+
+    return bytes;
+}
+
+/*---------------------------------------------------*/
+/* brief: format the instruction at addr */
+/*---------------------------------------*/
+int disasm_mem(struct mem* mem, uint16_t addr, char* buf, size_t n) {
+    uint8_t ins[3];
+
+    for(int i=0; i<3; i++) {
+        ins[i] = mem_get_data_byte(mem, addr+i);
+    }
+
+    return disasm(ins, buf, n);
+}
@@ -2,12 +2,13 @@
 #include <common.h>
 #include <string.h>
 #include <log.h>
+#include <disasm.h>
 
 const char EMU_LED_CHAR[] = {'0', '*'};
 
 static void dump_oper(
     struct processor_t *cpu, struct mem* mem, uint16_t addr, 
-    int bytes, int line, WINDOW* win) 
+    int bytes, int line, bool brk, WINDOW* win) 
 {
     
     if(cpu->PC==addr)
@@ -18,39 +19,22 @@ static void dump_oper(
         waddch(win, ' ');
     }
 
-    mvwprintw(win, line, 0, "%04x %02x ", addr, mem->data[addr]);
+    if(brk)
+        wattron(win, COLOR_PAIR(EMU_LED_COLOR));
+    mvwprintw(win, line, 0, "%04x", addr);
+    if(brk)
+        wattroff(win, COLOR_PAIR(EMU_LED_COLOR));
+
+    wprintw(win, " %02x ", mem_get_data_byte(mem, addr));
     
     for(int i=1; i<=bytes; i++) {
-        wprintw(win, "%02x ", mem->data[addr+i]);
+        wprintw(win, "%02x ", mem_get_data_byte(mem, addr+i));
     }
 
-    const char* name = cpu_get_op_name(mem->data[addr]);
-
-    if(name==NULL)
-        name = "?";
-
-    mvwprintw(win, line, 17, "%s ", name);
-    
-    enum processor_op_type_e op_t = cpu_get_op_type(mem->data[addr]);
-
-    if(op_t == OP_IMM) {
-        wprintw(win, "#");
-    } else if(op_t == OP_X_IND){ 
-        wprintw(win, "X,");
-    }
-    
-    
-    if(bytes==1) {
-        wprintw(win, "$%02x", mem->data[addr+1]);
-    } else if(bytes==2) {
-        wprintw(win, "$%02x%02x ", mem->data[addr+2], mem->data[addr+1]);
-    }
+    char text[DISASM_MAX_TEXT];
+    disasm_mem(mem, addr, text, sizeof(text));
 
-    if(op_t == OP_ABS_X || op_t == OP_ZPG_X) {
-        wprintw(win, ",X");
-    } else if(op_t == OP_ABS_Y || op_t == OP_ZPG_Y || op_t == OP_IND_Y) {
-        wprintw(win, ",Y");
-    }
+    mvwprintw(win, line, 17, "%s", text);
 
     if(cpu->PC==addr)
         wattroff(win, COLOR_PAIR(EMU_SHOW_COLOR));
@@ -62,7 +46,7 @@ static uint16_t get_addr_next_op(int ops, uint16_t addr, struct mem* mem) {
 
     int bytes = 0;
     for(int i=0; i<ops; i++) {
-        int op_bytes = cpu_op_get_n_bytes(mem->data[addr+i+bytes]);
+        int op_bytes = cpu_op_get_n_bytes(mem_get_data_byte(mem, addr+i+bytes));
 
         bytes += op_bytes+1;
     }
@@ -74,7 +58,7 @@ int emu_init(struct emulator_t* emu, struct mem* mem) {
 
     bzero(emu, sizeof(*emu));
 
-    emu->inst_p = mem->data[MEM_RES] | mem->data[MEM_RES+1]<<8;
+    emu->inst_p = mem_get_data_short(mem, MEM_RES);
 
     initscr();
 
@@ -140,6 +124,7 @@ void emu_display(
     emu_dump_program(cpu, mem, emu);
     emu_dump_data(mem, emu);
     emu_display_io(cpu, mem, &emu->io);
+    emu_display_lcd(emu);
 }
 
 int emu_section_init(
@@ -175,9 +160,16 @@ void emu_display_commands(
     wclear(commands->inner);
 
     mvwprintw(commands->inner, 0, 1, "s - step");
-    mvwprintw(commands->inner, 1, 1, "r - reset");
-    mvwprintw(commands->inner, 2, 1, "b - toggle button");
-    mvwprintw(commands->inner, 3, 1, "q - quit");
+    mvwprintw(commands->inner, 1, 1, "u - back");
+    mvwprintw(commands->inner, 2, 1, "b - button");
+    mvwprintw(commands->inner, 3, 1, "r - reset");
+    mvwprintw(commands->inner, 0, 13, "t - cycle");
+    mvwprintw(commands->inner, 1, 13, "p - break");
+    mvwprintw(commands->inner, 2, 13, "w - watch");
+    mvwprintw(commands->inner, 0, 26, "c - continue");
+    mvwprintw(commands->inner, 1, 26, "q - quit");
+    mvwprintw(commands->inner, 2, 26, "v - save");
+    mvwprintw(commands->inner, 3, 26, "l - load");
     wrefresh(commands->inner);
 }
 
@@ -196,10 +188,12 @@ void emu_dump_program(
 
     int bytes = 0;
     for(int i=0; i<EMU_PROGRAM_LINES-2; i++) {
-        int op_bytes = cpu_op_get_n_bytes(mem->data[emu->inst_p+i+bytes]);
+        int op_bytes = cpu_op_get_n_bytes(mem_get_data_byte(mem, emu->inst_p+i+bytes));
         
-        dump_oper(
-            cpu, mem, emu->inst_p+bytes+i, op_bytes, i, emu->program.inner);
+        uint16_t addr = emu->inst_p+bytes+i;
+        bool brk = emu->bp!=NULL && bp_test(emu->bp, addr);
+
+        dump_oper(cpu, mem, addr, op_bytes, i, brk, emu->program.inner);
 
         bytes += op_bytes;
     }
@@ -223,7 +217,7 @@ void emu_dump_data(struct mem* mem, struct emulator_t* emu) {
             if(cur_addr == mem->last_selected) 
                 wattron(emu->data.inner, COLOR_PAIR(EMU_SHOW_COLOR));
 
-            wprintw(emu->data.inner, "%02x ", mem->data[emu->mem_p+i*EMU_DATA_ROW_CELLS+j]);
+            wprintw(emu->data.inner, "%02x ", mem_get_data_byte(mem, emu->mem_p+i*EMU_DATA_ROW_CELLS+j));
             
             if(cur_addr == mem->last_selected) 
                 wattroff(emu->data.inner, COLOR_PAIR(EMU_SHOW_COLOR));
@@ -307,25 +301,24 @@ void emu_dump_registers(
         cpu->neg, cpu->over, 0, cpu->brk, cpu->dec, 
         cpu->ids, cpu->zero, cpu->carry
     );
+
+    int bottom = getmaxy(registers->border)-1;
+    mvwhline(registers->border, bottom, 1, 0, getmaxx(registers->border)-2);
+    mvwprintw(registers->border, bottom, 2, 
+        "[Cycle %llu]", (unsigned long long)cpu->cycles);
     
+    wrefresh(registers->border);
     wrefresh(registers->inner);
 }
 
 char emu_led_char(struct mem* mem, uint8_t mask) {
     return EMU_LED_CHAR[
-        (mem->data[MEM_DDRB] & mask) && (mem->data[MEM_PTB] & mask)
+        (mem_get_data_byte(mem, MEM_DDRB) & mask) && (mem_get_data_byte(mem, MEM_PTB) & mask)
     ];
 }
 
 void emu_display_io(
         struct processor_t *cpu, struct mem *mem, struct emu_section_t* io) {
-    
-    wattron(io->inner, COLOR_PAIR(EMU_DISPLAY_COLOR));
-
-    mvwprintw(io->inner, 0, 1, "                ");
-    mvwprintw(io->inner, 1, 1, "                ");
-
-    wattroff(io->inner, COLOR_PAIR(EMU_DISPLAY_COLOR));
 
     wattron(io->inner, COLOR_PAIR(EMU_LED_COLOR));
     mvwprintw(io->inner, 0, 25, "%c", emu_led_char(mem, 1<<3));
@@ -339,6 +332,42 @@ void emu_display_io(
     wrefresh(io->inner);
 }
 
+/*---------------------------------------------------*/
+/* brief: draw the two rows of the display, only when they changed */
+/* the cursor is underlined, the blinking block shown reversed */
+/*---------------------------------------*/
+void emu_display_lcd(struct emulator_t* emu) {
+    WINDOW* win = emu->io.inner;
+    struct lcd_t* lcd = emu->lcd;
+    char text[LCD_COLS+1];
+
+    if(emu->lcd_drawn && (lcd==NULL || lcd->version==emu->lcd_version))
+        return;
+
+    for(int row=0; row<2; row++) {
+        int col = lcd!=NULL ? lcd_cursor(lcd, row) : -1;
+
+        if(lcd!=NULL)
+            lcd_line(lcd, row, text);
+        else
+            snprintf(text, sizeof(text), "%*s", LCD_COLS, "");
+
+        wattron(win, COLOR_PAIR(EMU_DISPLAY_COLOR));
+        mvwprintw(win, row, 1, "%s", text);
+        wattroff(win, COLOR_PAIR(EMU_DISPLAY_COLOR));
+
+        if(col>=0) {
+            attr_t attr = (lcd->cursor ? A_UNDERLINE : 0) | (lcd->blink ? A_REVERSE : 0);
+            mvwchgat(win, row, 1+col, 1, attr, EMU_DISPLAY_COLOR, NULL);
+        }
+    }
+
+    emu->lcd_version = lcd!=NULL ? lcd->version : 0;
+    emu->lcd_drawn = true;
+
+    wrefresh(win);
+}
+
 void emu_refresh_section(struct emu_section_t* sec, const char* name) {
     wclear(sec->border);
     box(sec->border, 0, 0);
@@ -356,8 +385,45 @@ void emu_refresh(
     emu_refresh_section(&emu->commands, "Commands");
     emu_refresh_section(&emu->registers, "Registers");
     emu_refresh_section(&emu->io, "I/O");
+    emu->lcd_drawn = false;
     
     emu_display(emu, cpu, mem);
     emu_display_commands(&emu->commands, emu->show_io);
 }
 
+
+/*---------------------------------------------------*/
+/* brief: read a line from the user in the commands section */
+/*---------------------------------------*/
+int emu_prompt(
+    struct emulator_t* emu, const char* msg, char* buf, int n) 
+{
+    WINDOW* win = emu->commands.inner;
+
+    wclear(win);
+    mvwprintw(win, 0, 1, "%s", msg);
+
+    echo();
+    curs_set(1);
+    int rc = wgetnstr(win, buf, n-1);
+    noecho();
+    curs_set(0);
+
+    emu_display_commands(&emu->commands, emu->show_io);
+
+    return rc==OK && buf[0]!='\0' ? 0 : 1;
+}
+
+/*---------------------------------------------------*/
+/* brief: show why the last run stopped under the commands */
+/*---------------------------------------*/
+void emu_status(struct emulator_t* emu, const char* msg) {
+    WINDOW* win = emu->commands.border;
+    int bottom = getmaxy(win)-1;
+
+    mvwhline(win, bottom, 1, 0, getmaxx(win)-2);
+    if(msg!=NULL && msg[0]!='\0')
+        mvwprintw(win, bottom, 2, "[%.*s]", getmaxx(win)-5, msg);
+
+    wrefresh(win);
+}
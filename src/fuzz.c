@@ -0,0 +1,313 @@
+#include <fuzz.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+const char* FUZZ_RESULT_NAMES[] = {"ok", "opcode", "stack", "wild", "hang"};
+
+static double fuzz_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec/1e9;
+}
+
+/* xorshift64*, the campaigns repeat from the same seed */
+static uint64_t fuzz_rand(struct fuzz_t* f) {
+    f->rng ^= f->rng>>12;
+    f->rng ^= f->rng<<25;
+    f->rng ^= f->rng>>27;
+    return f->rng*0x2545f4914f6cdd1dull;
+}
+
+static uint64_t fuzz_below(struct fuzz_t* f, uint64_t n) {
+    return n ? fuzz_rand(f)%n : 0;
+}
+
+/*---------------------------------------------------*/
+/* brief: load the rom and start the corpus with no input at all */
+/*---------------------------------------*/
+int fuzz_init(struct fuzz_t* f, char* rom, const char* dir, unsigned long steps) {
+    memset(f, 0, sizeof(*f));
+    f->steps = steps;
+    f->dir = dir;
+    f->rng = 0x9e3779b97f4a7c15ull;
+
+    f->bits = calloc(FUZZ_MAP_SIZE, 1);
+    f->virgin = calloc(FUZZ_MAP_SIZE, 1);
+
+    int rc = machine_init(&f->m, rom);
+
+    if(rc!=0 || f->bits==NULL || f->virgin==NULL)
+        return 1;
+
+    f->m.cpu.coverage = f->bits;
+
+    for(int op=0; op<256; op++) {
+        f->supported[op] = cpu_op_supported(op);
+    }
+
+    input_log_init(&f->corpus[0]);
+    f->n_corpus = 1;
+
+    return 0;
+}
+
+/*---------------------------------------------------*/
+/* brief: release the machine and the corpus */
+/*---------------------------------------*/
+void fuzz_dispose(struct fuzz_t* f) {
+    machine_dispose(&f->m);
+
+    for(size_t i=0; i<f->n_corpus; i++) {
+        input_log_dispose(&f->corpus[i]);
+    }
+
+    free(f->bits);
+    free(f->virgin);
+}
+
+/* a push that leaves SP above where it was, or a pull below, wrapped */
+static bool fuzz_stack_wrapped(uint8_t op, uint8_t before, uint8_t after) {
+    int8_t moved = after-before;
+
+    if(op==TXS_IMP || moved==0)
+        return false;
+
+    return moved<0 ? after>before : after<before;
+}
+
+/*---------------------------------------------------*/
+/* brief: run the schedule in log from the reset state */
+/* the edges it takes are counted in f->bits */
+/*---------------------------------------*/
+enum fuzz_result_e fuzz_run(struct fuzz_t* f, struct input_log_t* log) {
+    struct machine_t* m = &f->m;
+    uint64_t last_io = 0;
+
+    memset(f->bits, 0, FUZZ_MAP_SIZE);
+    machine_restart(m);
+    machine_replay(m, log);
+
+    f->runs++;
+
+    for(unsigned long n=0; n<f->steps && m->cpu.is_running; n++) {
+        uint16_t pc = m->cpu.PC;
+        uint8_t sp = m->cpu.SP;
+        uint8_t op = mem_fetch_byte(&m->mem, pc);
+
+        f->fault_pc = pc;
+
+        if(pc<MEM_CODE_ADDR)
+            return FUZZ_WILD;
+        if(!f->supported[op])
+            return FUZZ_OPCODE;
+
+        machine_step(m);
+
+        if(fuzz_stack_wrapped(op, sp, m->cpu.SP))
+            return FUZZ_STACK;
+
+        // the watchdog is kicked by any access to the i/o window
+        int ea = m->mem.last_selected;
+        if(ea>=MEM_PTA && ea<MEM_CODE_ADDR)
+            last_io = m->cpu.cycles;
+        else if(m->cpu.cycles-last_io>FUZZ_WATCHDOG)
+            return FUZZ_HANG;
+    }
+
+    return FUZZ_OK;
+}
+
+/* the bit of the count class, 1, 2, 3, 4-7, 8-15, 16-31, 32-127, 128+ */
+static uint8_t fuzz_bucket(uint8_t hits) {
+    if(hits<=3)
+        return hits ? 1<<(hits-1) : 0;
+    if(hits<8)
+        return 1<<3;
+    if(hits<16)
+        return 1<<4;
+    if(hits<32)
+        return 1<<5;
+    return hits<128 ? 1<<6 : 1<<7;
+}
+
+/*---------------------------------------------------*/
+/* brief: merge the run into the classes seen */
+/* return true if it reached a new edge or a new count of one */
+/*---------------------------------------*/
+static bool fuzz_merge(struct fuzz_t* f) {
+    uint64_t* words = (uint64_t*)f->bits;
+    bool fresh = false;
+
+    for(int w=0; w<FUZZ_MAP_SIZE/8; w++) {
+        if(words[w]==0)
+            continue;
+
+        for(int i=w*8; i<w*8+8; i++) {
+            uint8_t bucket = fuzz_bucket(f->bits[i]);
+
+            if(bucket & ~f->virgin[i]) {
+                if(f->virgin[i]==0)
+                    f->edges++;
+                f->virgin[i] |= bucket;
+                fresh = true;
+            }
+        }
+    }
+
+    return fresh;
+}
+
+static int fuzz_cmp_events(const void* a, const void* b) {
+    const struct input_event_t* ea = a;
+    const struct input_event_t* eb = b;
+
+    return (ea->cycle>eb->cycle)-(ea->cycle<eb->cycle);
+}
+
+static void fuzz_insert(struct fuzz_t* f, struct input_log_t* log, uint64_t cycle) {
+    uint8_t device = fuzz_below(f, 4)==0 ? 1+fuzz_below(f, 2) : INPUT_BUTTON;
+    uint8_t value = device==INPUT_BUTTON ? fuzz_below(f, 2) : fuzz_rand(f);
+
+    input_log_append(log, cycle, device, value);
+}
+
+/*---------------------------------------------------*/
+/* brief: change a copy of a corpus entry in one to four ways */
+/*---------------------------------------*/
+static void fuzz_mutate(struct fuzz_t* f, struct input_log_t* log) {
+    uint64_t horizon = f->horizon ? f->horizon : 1;
+    int rounds = 1+fuzz_below(f, 4);
+
+    for(int r=0; r<rounds; r++) {
+        size_t n = log->n_events;
+        struct input_event_t* ev = n ? &log->events[fuzz_below(f, n)] : NULL;
+        struct input_log_t* other;
+        uint64_t cut;
+
+        switch(ev==NULL ? 0 : fuzz_below(f, 7)) {
+            case 0:
+            case 1:
+                fuzz_insert(f, log, fuzz_below(f, horizon));
+                break;
+            case 2:
+                // a press and its release, the width matters to debouncing
+                cut = fuzz_below(f, horizon);
+                input_log_append(log, cut, INPUT_BUTTON, 1);
+                input_log_append(log, cut+1+fuzz_below(f, 1<<fuzz_below(f, 16)),
+                    INPUT_BUTTON, 0);
+                break;
+            case 3:
+                *ev = log->events[--log->n_events];
+                break;
+            case 4:
+                // a few cycles either way, or anywhere
+                if(fuzz_below(f, 2)) {
+                    int64_t delta = (int64_t)fuzz_below(f, 129)-64;
+                    ev->cycle = (int64_t)ev->cycle+delta<0 ? 0 : ev->cycle+delta;
+                } else {
+                    ev->cycle = fuzz_below(f, horizon);
+                }
+                break;
+            case 5:
+                ev->value = ev->device==INPUT_BUTTON
+                    ? !ev->value : ev->value ^ 1<<fuzz_below(f, 8);
+                break;
+            case 6:
+                // the tail of another entry after a cycle
+                other = &f->corpus[fuzz_below(f, f->n_corpus)];
+                cut = fuzz_below(f, horizon);
+                for(size_t i=0; i<other->n_events && log->n_events<FUZZ_MAX_EVENTS; i++) {
+                    if(other->events[i].cycle>=cut) {
+                        input_log_append(log, other->events[i].cycle,
+                            other->events[i].device, other->events[i].value);
+                    }
+                }
+                break;
+        }
+    }
+
+    qsort(log->events, log->n_events, sizeof(*log->events), fuzz_cmp_events);
+    input_log_truncate(log, FUZZ_MAX_EVENTS);
+}
+
+static void fuzz_copy(struct input_log_t* dst, struct input_log_t* src) {
+    input_log_clear(dst);
+
+    for(size_t i=0; i<src->n_events; i++) {
+        input_log_append(dst, src->events[i].cycle,
+            src->events[i].device, src->events[i].value);
+    }
+}
+
+/*---------------------------------------------------*/
+/* brief: save the schedule of a fault, once per kind and address */
+/*---------------------------------------*/
+static void fuzz_save(struct fuzz_t* f, enum fuzz_result_e res, struct input_log_t* log) {
+    uint64_t* seen = &f->seen[res][f->fault_pc>>6];
+    uint64_t bit = 1ull<<(f->fault_pc&63);
+    char path[4096];
+
+    if(*seen & bit)
+        return;
+    *seen |= bit;
+    f->found[res]++;
+
+    snprintf(path, sizeof(path), "%s/%s-%04x.txt",
+        f->dir, FUZZ_RESULT_NAMES[res], f->fault_pc);
+
+    if(input_log_save(log, path)!=0)
+        fprintf(stderr, "cannot write %s\n", path);
+    else
+        printf("run %lu: %s at $%04x, %s\n",
+            f->runs, FUZZ_RESULT_NAMES[res], f->fault_pc, path);
+}
+
+/*---------------------------------------------------*/
+/* brief: mutate, run and keep what finds new edges, runs times */
+/*---------------------------------------*/
+int fuzz_campaign(struct fuzz_t* f, unsigned long runs) {
+    struct input_log_t child;
+    input_log_init(&child);
+
+    double start = fuzz_now();
+
+    for(unsigned long r=0; r<runs; r++) {
+        // the first run measures the empty schedule
+        if(r==0)
+            input_log_clear(&child);
+        else {
+            fuzz_copy(&child, &f->corpus[fuzz_below(f, f->n_corpus)]);
+            fuzz_mutate(f, &child);
+        }
+
+        enum fuzz_result_e res = fuzz_run(f, &child);
+        bool fresh = fuzz_merge(f);
+
+        if(f->m.cpu.cycles>f->horizon)
+            f->horizon = f->m.cpu.cycles;
+
+        if(res!=FUZZ_OK)
+            fuzz_save(f, res, &child);
+        else if(fresh && r>0 && f->n_corpus<FUZZ_MAX_CORPUS) {
+            struct input_log_t* keep = &f->corpus[f->n_corpus++];
+            input_log_init(keep);
+            fuzz_copy(keep, &child);
+        }
+    }
+
+    double elapsed = fuzz_now()-start;
+
+    printf("runs........ : %lu in %.3fs, %.0f runs/s\n", runs, elapsed, runs/elapsed);
+    printf("edges....... : %zu\n", f->edges);
+    printf("corpus...... : %zu schedules\n", f->n_corpus);
+    for(int k=FUZZ_OK+1; k<FUZZ_RESULTS; k++) {
+        const char* name = FUZZ_RESULT_NAMES[k];
+        printf("%s%.*s : %lu\n", name, 12-(int)strlen(name), "............", f->found[k]);
+    }
+
+    input_log_dispose(&child);
+
+    return 0;
+}
@@ -0,0 +1,227 @@
+#include <input.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdbool.h>
+
+const char* INPUT_DEVICE_NAMES[] = {"button", "pta", "ptb"};
+
+/*---------------------------------------------------*/
+/* brief: init an empty input log */
+/*---------------------------------------*/
+void input_log_init(struct input_log_t* log) {
+    memset(log, 0, sizeof(*log));
+}
+
+/*---------------------------------------------------*/
+/* brief: release the events */
+/*---------------------------------------*/
+void input_log_dispose(struct input_log_t* log) {
+    free(log->events);
+    memset(log, 0, sizeof(*log));
+}
+
+/*---------------------------------------------------*/
+/* brief: forget every event, keeping the buffer */
+/*---------------------------------------*/
+void input_log_clear(struct input_log_t* log) {
+    log->n_events = 0;
+}
+
+/*---------------------------------------------------*/
+/* brief: append an event, cycle must not go backwards */
+/*---------------------------------------*/
+int input_log_append(
+    struct input_log_t* log, uint64_t cycle, uint8_t device, uint8_t value) 
+{
+    if(log->n_events==log->cap) {
+        size_t cap = log->cap ? log->cap*2 : 64;
+        struct input_event_t* events = 
+            realloc(log->events, cap*sizeof(*events));
+
+        if(events==NULL)
+            return 1;
+
+        log->events = events;
+        log->cap = cap;
+    }
+
+    struct input_event_t* ev = &log->events[log->n_events++];
+    ev->cycle = cycle;
+    ev->device = device;
+    ev->value = value;
+
+    return 0;
+}
+
+/*---------------------------------------------------*/
+/* brief: keep only the first n_events */
+/*---------------------------------------*/
+void input_log_truncate(struct input_log_t* log, size_t n_events) {
+    if(n_events<log->n_events)
+        log->n_events = n_events;
+}
+
+/*---------------------------------------------------*/
+/* brief: return the index of the first event at or after cycle */
+/*---------------------------------------*/
+size_t input_log_find(struct input_log_t* log, uint64_t cycle) {
+    size_t lo = 0;
+    size_t hi = log->n_events;
+
+    while(lo<hi) {
+        size_t mid = lo+(hi-lo)/2;
+        if(log->events[mid].cycle<cycle)
+            lo = mid+1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+/* a .bin file gets the compact encoding */
+static bool input_is_compact(const char* filename) {
+    size_t len = strlen(filename);
+
+    return len>4 && strcmp(filename+len-4, ".bin")==0;
+}
+
+/* the cycle as a delta from the event before, 7 bits a byte, low first */
+static void input_put_delta(FILE* fp, uint64_t delta) {
+    while(delta>=0x80) {
+        fputc((delta & 0x7f) | 0x80, fp);
+        delta >>= 7;
+    }
+    fputc(delta, fp);
+}
+
+static int input_get_delta(FILE* fp, uint64_t* delta) {
+    int c;
+
+    *delta = 0;
+    for(int shift=0; shift<64; shift+=7) {
+        if((c = fgetc(fp))==EOF)
+            return 1;
+
+        *delta |= (uint64_t)(c & 0x7f)<<shift;
+        if(!(c & 0x80))
+            return 0;
+    }
+
+    return 1;
+}
+
+/*---------------------------------------------------*/
+/* brief: write the events as "cycle device value" lines */
+/* or, if filename ends with .bin, as INPUT_MAGIC then a delta cycle, */
+/* the device and the value per event, 3 bytes for most of them */
+/*---------------------------------------*/
+int input_log_save(struct input_log_t* log, const char* filename) {
+    bool compact = input_is_compact(filename);
+    FILE* fp = fopen(filename, compact ? "wb" : "w");
+    uint64_t last = 0;
+
+    if(fp==NULL)
+        return 1;
+
+    if(compact)
+        fputs(INPUT_MAGIC, fp);
+    else
+        fprintf(fp, "# cycle device value\n");
+
+    for(size_t i=0; i<log->n_events; i++) {
+        struct input_event_t* ev = &log->events[i];
+
+        if(compact) {
+            input_put_delta(fp, ev->cycle-last);
+            fputc(ev->device, fp);
+            fputc(ev->value, fp);
+            last = ev->cycle;
+        } else {
+            fprintf(fp, "%llu %s $%02x\n", (unsigned long long)ev->cycle,
+                ev->device<INPUT_DEVICES ? INPUT_DEVICE_NAMES[ev->device] : "?", 
+                ev->value);
+        }
+    }
+
+    return fclose(fp)!=0;
+}
+
+/* the events after INPUT_MAGIC, until the end of the file */
+static int input_log_load_compact(struct input_log_t* log, FILE* fp) {
+    uint64_t cycle = log->n_events ? log->events[log->n_events-1].cycle : 0;
+    uint64_t delta;
+
+    while(input_get_delta(fp, &delta)==0) {
+        int device = fgetc(fp);
+        int value = fgetc(fp);
+
+        if(value==EOF || device>=INPUT_DEVICES 
+            || input_log_append(log, cycle += delta, device, value)!=0)
+        {
+            return 1;
+        }
+    }
+
+    return !feof(fp) || ferror(fp);
+}
+
+/*---------------------------------------------------*/
+/* brief: append the events of a file written by input_log_save */
+/* blank lines and # comments are skipped, cycles must not go backwards */
+/* a compact log is told by INPUT_MAGIC whatever its name */
+/*---------------------------------------*/
+int input_log_load(struct input_log_t* log, const char* filename) {
+    FILE* fp = fopen(filename, "rb");
+    char line[128];
+    int rc = 0;
+
+    if(fp==NULL)
+        return 1;
+
+    if(fread(line, 1, 4, fp)==4 && memcmp(line, INPUT_MAGIC, 4)==0) {
+        rc = input_log_load_compact(log, fp);
+        fclose(fp);
+        return rc;
+    }
+    rewind(fp);
+
+    while(rc==0 && fgets(line, sizeof(line), fp)!=NULL) {
+        unsigned long long cycle;
+        char name[16];
+        char value[16];
+
+        char* s = line+strspn(line, " \t");
+        if(*s=='#' || *s=='\n' || *s=='\0')
+            continue;
+
+        if(sscanf(s, "%llu %15s %15s", &cycle, name, value)!=3) {
+            rc = 1;
+            break;
+        }
+
+        int device = 0;
+        while(device<INPUT_DEVICES && strcasecmp(name, INPUT_DEVICE_NAMES[device])!=0) {
+            device++;
+        }
+
+        char* end;
+        unsigned long val = value[0]=='$' 
+            ? strtoul(value+1, &end, 16) : strtoul(value, &end, 0);
+
+        if(device==INPUT_DEVICES || *end!='\0' || val>0xff
+            || (log->n_events>0 && cycle<log->events[log->n_events-1].cycle))
+        {
+            rc = 1;
+            break;
+        }
+
+        rc = input_log_append(log, cycle, device, val);
+    }
+
+    fclose(fp);
+
+    return rc;
+}
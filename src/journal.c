@@ -0,0 +1,197 @@
+#include <journal.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define JOURNAL_CPU_SIZE sizeof(struct processor_t)
+#define JOURNAL_WRITE_SIZE 3
+
+static void journal_put(struct journal_t* j, size_t off, void* src, size_t n) {
+    uint8_t* p = src;
+    for(size_t i=0; i<n; i++) {
+        j->buf[(off+i)%j->size] = p[i];
+    }
+}
+
+static void journal_get(struct journal_t* j, size_t off, void* dst, size_t n) {
+    uint8_t* p = dst;
+    for(size_t i=0; i<n; i++) {
+        p[i] = j->buf[(off+i)%j->size];
+    }
+}
+
+static size_t journal_head(struct journal_t* j) {
+    return (j->tail+j->used)%j->size;
+}
+
+/*---------------------------------------------------*/
+/* brief: drop the oldest entries until n more bytes fit */
+/*---------------------------------------*/
+static int journal_reserve(struct journal_t* j, size_t n) {
+    while(j->used+n>j->size) {
+        if(j->entries==0)
+            return 1;
+
+        uint16_t len;
+        journal_get(j, j->tail, &len, sizeof(len));
+
+        j->tail = (j->tail+len)%j->size;
+        j->used -= len;
+        j->entries--;
+    }
+
+    return 0;
+}
+
+/*---------------------------------------------------*/
+/* brief: record the old value of every store in the current entry */
+/*---------------------------------------*/
+static void journal_on_write(void* ctx, uint16_t addr, uint8_t old, uint8_t val) {
+    struct journal_t* j = ctx;
+
+    if(!j->recording)
+        return;
+
+    if(journal_reserve(j, JOURNAL_WRITE_SIZE)!=0) {
+        // the entry alone exceeds the budget, give it up
+        j->used -= j->entry_len;
+        j->recording = false;
+        return;
+    }
+
+    uint8_t rec[JOURNAL_WRITE_SIZE] = { addr & 0xff, addr>>8, old };
+    journal_put(j, journal_head(j), rec, sizeof(rec));
+
+    j->used += sizeof(rec);
+    j->entry_len += sizeof(rec);
+}
+
+/*---------------------------------------------------*/
+/* brief: allocate a journal of budget bytes */
+/*---------------------------------------*/
+int journal_init(struct journal_t* j, size_t budget) {
+    memset(j, 0, sizeof(*j));
+
+    if(budget<JOURNAL_MIN_BUDGET)
+        budget = JOURNAL_MIN_BUDGET;
+
+    j->buf = malloc(budget);
+    if(j->buf==NULL)
+        return 1;
+
+    j->size = budget;
+
+    return 0;
+}
+
+/*---------------------------------------------------*/
+/* brief: release the journal buffer */
+/*---------------------------------------*/
+void journal_dispose(struct journal_t* j) {
+    free(j->buf);
+    j->buf = NULL;
+}
+
+/*---------------------------------------------------*/
+/* brief: forget every recorded instruction */
+/*---------------------------------------*/
+void journal_clear(struct journal_t* j) {
+    j->tail = 0;
+    j->used = 0;
+    j->entries = 0;
+    j->recording = false;
+}
+
+/*---------------------------------------------------*/
+/* brief: start observing the stores to mem */
+/*---------------------------------------*/
+void journal_attach(struct journal_t* j, struct mem* mem) {
+    mem_add_hook(mem, journal_on_write, j);
+}
+
+/*---------------------------------------------------*/
+/* brief: stop observing the stores to mem */
+/*---------------------------------------*/
+void journal_detach(struct journal_t* j, struct mem* mem) {
+    mem_remove_hook(mem, journal_on_write, j);
+}
+
+/*---------------------------------------------------*/
+/* brief: open the entry of the instruction about to run */
+/*---------------------------------------*/
+void journal_begin(struct journal_t* j, struct processor_t* cpu) {
+
+    uint16_t len = 0;
+    size_t size = sizeof(len)+JOURNAL_CPU_SIZE;
+
+    if(j->recording || journal_reserve(j, size)!=0)
+        return;
+
+    j->entry = journal_head(j);
+    journal_put(j, j->entry, &len, sizeof(len));
+    journal_put(j, j->entry+sizeof(len), cpu, JOURNAL_CPU_SIZE);
+
+    j->used += size;
+    j->entry_len = size;
+    j->recording = true;
+}
+
+/*---------------------------------------------------*/
+/* brief: close the current entry */
+/*---------------------------------------*/
+void journal_end(struct journal_t* j) {
+
+    uint16_t len = j->entry_len+sizeof(len);
+
+    if(!j->recording)
+        return;
+
+    j->recording = false;
+
+    if(journal_reserve(j, sizeof(len))!=0) {
+        j->used -= j->entry_len;
+        return;
+    }
+
+    journal_put(j, journal_head(j), &len, sizeof(len));
+    journal_put(j, j->entry, &len, sizeof(len));
+
+    j->used += sizeof(len);
+    j->entries++;
+}
+
+/*---------------------------------------------------*/
+/* brief: revert the newest instruction, 1 if there is none */
+/*---------------------------------------*/
+int journal_undo(struct journal_t* j, struct processor_t* cpu, struct mem* mem) {
+
+    if(j->entries==0 || j->recording)
+        return 1;
+
+    size_t head = journal_head(j);
+    uint16_t len;
+    journal_get(j, (head+j->size-sizeof(len))%j->size, &len, sizeof(len));
+
+    size_t start = (head+j->size-len)%j->size;
+    size_t writes = start+sizeof(len)+JOURNAL_CPU_SIZE;
+    int n = (len-2*sizeof(len)-JOURNAL_CPU_SIZE)/JOURNAL_WRITE_SIZE;
+
+    for(int i=n-1; i>=0; i--) {
+        uint8_t rec[JOURNAL_WRITE_SIZE];
+        journal_get(j, writes+i*JOURNAL_WRITE_SIZE, rec, sizeof(rec));
+        uint16_t addr = rec[0] | rec[1]<<8;
+
+        // put back as stored, devices and watches do not see the undo
+        mem_page_own(mem, addr>>8)[addr&0xff] = rec[2];
+    }
+
+    bool is_running = cpu->is_running;
+
+    journal_get(j, start+sizeof(len), cpu, JOURNAL_CPU_SIZE);
+
+    cpu->is_running = is_running;
+
+    j->used -= len;
+    j->entries--;
+
+    return 0;
+}
@@ -0,0 +1,272 @@
+#include <lcd.h>
+#include <string.h>
+
+/*---------------------------------------------------*/
+/* brief: the state after the internal reset at power on */
+/* display cleared and off, 8 bit bus, one line, cursor moving right */
+/*---------------------------------------*/
+void lcd_init(struct lcd_t* lcd) {
+    memset(lcd, 0, sizeof(*lcd));
+    memset(lcd->ddram, ' ', sizeof(lcd->ddram));
+
+    lcd->increment = true;
+    lcd->eight_bit = true;
+}
+
+/* move the address counter one place, ddram wraps line by line */
+static void lcd_advance(struct lcd_t* lcd, bool up) {
+    uint8_t ac = lcd->ac;
+
+    if(lcd->cgram_mode)
+        ac = (ac+(up ? 1 : -1)) & (LCD_CGRAM_SIZE-1);
+    else if(!lcd->two_lines)
+        ac = up ? (ac+1)%(2*LCD_LINE_LEN) : (ac+2*LCD_LINE_LEN-1)%(2*LCD_LINE_LEN);
+    else if(up)
+        ac = ac==0x27 ? 0x40 : ac==0x67 ? 0x00 : ac+1;
+    else
+        ac = ac==0x40 ? 0x27 : ac==0x00 ? 0x67 : ac-1;
+
+    lcd->ac = ac & 0x7f;
+}
+
+/* shift what is shown one column, left moves the text to the left */
+/* one line is the 80 columns of both, two lines shift 40 each */
+static void lcd_shift(struct lcd_t* lcd, bool left) {
+    int len = lcd->two_lines ? LCD_LINE_LEN : 2*LCD_LINE_LEN;
+
+    lcd->offset = (lcd->offset%len+(left ? 1 : len-1))%len;
+}
+
+/*---------------------------------------------------*/
+/* brief: execute an instruction, or store data if rs */
+/*---------------------------------------*/
+static void lcd_write(struct lcd_t* lcd, uint64_t cycle, bool rs, uint8_t d) {
+    // the controller does not listen while it is busy
+    if(cycle<lcd->busy_until) {
+        lcd->ignored++;
+        return;
+    }
+
+    lcd->busy_until = cycle+LCD_BUSY_CYCLES;
+    lcd->version++;
+
+    if(rs) {
+        if(lcd->cgram_mode)
+            lcd->cgram[lcd->ac] = d;
+        else
+            lcd->ddram[lcd->ac] = d;
+
+        lcd_advance(lcd, lcd->increment);
+        if(lcd->shift && !lcd->cgram_mode)
+            lcd_shift(lcd, lcd->increment);
+    } else if(d & 0x80) {
+        lcd->ac = d & 0x7f;
+        lcd->cgram_mode = false;
+    } else if(d & 0x40) {
+        lcd->ac = d & 0x3f;
+        lcd->cgram_mode = true;
+    } else if(d & 0x20) {
+        lcd->eight_bit = d & 0x10;
+        lcd->two_lines = d & 0x08;
+        lcd->font5x10 = d & 0x04;
+    } else if(d & 0x10) {
+        if(d & 0x08)
+            lcd_shift(lcd, !(d & 0x04));
+        else
+            lcd_advance(lcd, d & 0x04);
+    } else if(d & 0x08) {
+        lcd->display = d & 0x04;
+        lcd->cursor = d & 0x02;
+        lcd->blink = d & 0x01;
+    } else if(d & 0x04) {
+        lcd->increment = d & 0x02;
+        lcd->shift = d & 0x01;
+    } else if(d & 0x03) {
+        // clear also sets the entry mode to increment, home does not
+        if(d & 0x01) {
+            memset(lcd->ddram, ' ', sizeof(lcd->ddram));
+            lcd->increment = true;
+        }
+        lcd->ac = 0;
+        lcd->cgram_mode = false;
+        lcd->offset = 0;
+        lcd->busy_until = cycle+LCD_HOME_CYCLES;
+    }
+}
+
+/*---------------------------------------------------*/
+/* brief: the busy flag and address, or the data at the address if rs */
+/*---------------------------------------*/
+static uint8_t lcd_read(struct lcd_t* lcd, uint64_t cycle, bool rs) {
+    if(!rs)
+        return (cycle<lcd->busy_until ? 0x80 : 0) | lcd->ac;
+
+    uint8_t d = lcd->cgram_mode ? lcd->cgram[lcd->ac] : lcd->ddram[lcd->ac];
+
+    // the cursor moves on as after a write
+    lcd_advance(lcd, lcd->increment);
+    lcd->busy_until = cycle+LCD_BUSY_CYCLES;
+    lcd->version++;
+
+    return d;
+}
+
+/*---------------------------------------------------*/
+/* brief: follow the E line, ctrl and data are the levels on PTB and PTA */
+/* nothing happens unless E changed, a transfer is half a byte in 4 bit */
+/* mode, the high half first, on D7-D4 */
+/*---------------------------------------*/
+void lcd_edge(struct lcd_t* lcd, uint64_t cycle, uint8_t ctrl, uint8_t data) {
+    bool e = ctrl & LCD_E;
+    bool rs = ctrl & LCD_RS;
+
+    if(e==lcd->e)
+        return;
+
+    lcd->e = e;
+
+    // a read drives the bus from the rising edge to the falling one
+    if(!e && lcd->driving) {
+        lcd->driving = false;
+        return;
+    }
+    if(e!=((ctrl & LCD_RW)!=0))
+        return;
+
+    lcd->edges++;
+
+    // a function set switching the bus width applies to the next transfer
+    bool nibbles = !lcd->eight_bit;
+
+    if(e) {
+        lcd->driving = true;
+
+        if(!nibbles) {
+            lcd->out = lcd_read(lcd, cycle, rs);
+        } else if(!lcd->low_nibble) {
+            lcd->high = lcd_read(lcd, cycle, rs);
+            lcd->out = lcd->high & 0xf0;
+        } else {
+            lcd->out = lcd->high<<4;
+        }
+    } else {
+        if(!nibbles)
+            lcd_write(lcd, cycle, rs, data);
+        else if(!lcd->low_nibble)
+            lcd->high = data & 0xf0;
+        else
+            lcd_write(lcd, cycle, rs, lcd->high | data>>4);
+    }
+
+    if(nibbles)
+        lcd->low_nibble = !lcd->low_nibble;
+}
+
+/* what a character looks like on a terminal */
+static char lcd_glyph(uint8_t c) {
+    if(c<0x10)
+        return '#';
+    if(c==0x7e)
+        return '>';
+    if(c==0x7f)
+        return '<';
+
+    return c>=0x20 && c<0x7e ? c : ' ';
+}
+
+/*---------------------------------------------------*/
+/* brief: the LCD_COLS characters shown on row 0 or 1, into text */
+/* the user defined characters of cgram are drawn as # */
+/*---------------------------------------*/
+void lcd_line(struct lcd_t* lcd, int row, char* text) {
+    for(int i=0; i<LCD_COLS; i++) {
+        uint8_t addr = lcd->two_lines
+            ? row*0x40+(lcd->offset+i)%LCD_LINE_LEN
+            : (lcd->offset+i)%(2*LCD_LINE_LEN);
+
+        text[i] = lcd->display && (row==0 || lcd->two_lines)
+            ? lcd_glyph(lcd->ddram[addr]) : ' ';
+    }
+
+    text[LCD_COLS] = '\0';
+}
+
+/*---------------------------------------------------*/
+/* brief: the column of the cursor on row, -1 if it is not shown there */
+/*---------------------------------------*/
+int lcd_cursor(struct lcd_t* lcd, int row) {
+    if(!lcd->display || !(lcd->cursor || lcd->blink) || lcd->cgram_mode)
+        return -1;
+
+    // one line runs on from $00 to $4f, two start at $00 and $40
+    int line = lcd->two_lines && lcd->ac>=0x40;
+    int len = lcd->two_lines ? LCD_LINE_LEN : 2*LCD_LINE_LEN;
+    int pos = lcd->two_lines ? lcd->ac & 0x3f : lcd->ac;
+    int col = (pos-lcd->offset%len+len)%len;
+
+    return line==row && col<LCD_COLS ? col : -1;
+}
+
+/*---------------------------------------------------*/
+/* brief: write the state to p, LCD_STATE_SIZE bytes, little endian */
+/* ddram cgram ac flags:16 offset high out busy_until:64 */
+/*---------------------------------------*/
+void lcd_save_state(struct lcd_t* lcd, uint8_t* p) {
+    uint16_t flags = lcd->cgram_mode | lcd->increment<<1 | lcd->shift<<2
+        | lcd->display<<3 | lcd->cursor<<4 | lcd->blink<<5
+        | lcd->eight_bit<<6 | lcd->two_lines<<7 | lcd->font5x10<<8
+        | lcd->low_nibble<<9 | lcd->e<<10 | lcd->driving<<11;
+
+    memcpy(p, lcd->ddram, LCD_DDRAM_SIZE);
+    p += LCD_DDRAM_SIZE;
+    memcpy(p, lcd->cgram, LCD_CGRAM_SIZE);
+    p += LCD_CGRAM_SIZE;
+
+    p[0] = lcd->ac;
+    p[1] = flags & 0xff;
+    p[2] = flags>>8;
+    p[3] = lcd->offset;
+    p[4] = lcd->high;
+    p[5] = lcd->out;
+
+    for(int i=0; i<8; i++) {
+        p[6+i] = lcd->busy_until>>(8*i);
+    }
+}
+
+/*---------------------------------------------------*/
+/* brief: read a state written by lcd_save_state */
+/*---------------------------------------*/
+void lcd_load_state(struct lcd_t* lcd, const uint8_t* p) {
+    memcpy(lcd->ddram, p, LCD_DDRAM_SIZE);
+    p += LCD_DDRAM_SIZE;
+    memcpy(lcd->cgram, p, LCD_CGRAM_SIZE);
+    p += LCD_CGRAM_SIZE;
+
+    uint16_t flags = p[1] | p[2]<<8;
+
+    lcd->ac = p[0] & 0x7f;
+    lcd->cgram_mode = flags & 1;
+    lcd->increment = flags>>1 & 1;
+    lcd->shift = flags>>2 & 1;
+    lcd->display = flags>>3 & 1;
+    lcd->cursor = flags>>4 & 1;
+    lcd->blink = flags>>5 & 1;
+    lcd->eight_bit = flags>>6 & 1;
+    lcd->two_lines = flags>>7 & 1;
+    lcd->font5x10 = flags>>8 & 1;
+    lcd->low_nibble = flags>>9 & 1;
+    lcd->e = flags>>10 & 1;
+    lcd->driving = flags>>11 & 1;
+    lcd->offset = p[3]%(2*LCD_LINE_LEN);
+    lcd->high = p[4];
+    lcd->out = p[5];
+
+    lcd->busy_until = 0;
+    for(int i=0; i<8; i++) {
+        lcd->busy_until |= (uint64_t)p[6+i]<<(8*i);
+    }
+
+    // whatever was drawn is stale
+    lcd->version++;
+}
@@ -0,0 +1,510 @@
+#include <lockstep.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define LS_BENCH_PERIOD 4096
+
+typedef int8_t ls_m8_t __attribute__((vector_size(LS_MAX_LANES)));
+typedef int16_t ls_m16_t __attribute__((vector_size(LS_MAX_LANES*2)));
+
+/* keep the old value in the lanes outside the group */
+#define LS_BLEND(dst, val) \
+    (dst) = ((val) & group) | ((dst) & ~group)
+
+#define LS_BLEND16(dst, val) \
+    (dst) = ((val) & group16) | ((dst) & ~group16)
+
+/*---------------------------------------------------*/
+/* brief: init every lane from the same rom */
+/*---------------------------------------*/
+int ls_init(struct lockstep_t* ls, int lanes, char* filename) {
+
+    memset(ls, 0, sizeof(*ls));
+
+    if(lanes<1 || lanes>LS_MAX_LANES)
+        return 1;
+
+    // the devices keep a pointer to their board, which must not move
+    ls->m = calloc(lanes, sizeof(struct machine_t));
+    if(ls->m==NULL)
+        return 1;
+
+    for(; ls->lanes<lanes; ls->lanes++) {
+        if(machine_init(&ls->m[ls->lanes], filename)!=0) {
+            machine_dispose(&ls->m[ls->lanes]);
+            ls_dispose(ls);
+            return 1;
+        }
+    }
+
+    for(int op=0; op<256; op++) {
+        ls->op_cycles[op] = cpu_op_get_cycles(op);
+    }
+
+    for(int i=0; i<lanes; i++) {
+        ls->active[i] = 0xff;
+        ls_set_cpu(ls, i, &ls->m[i].cpu);
+    }
+
+    return 0;
+}
+
+/*---------------------------------------------------*/
+/* brief: release the boards of the lanes */
+/*---------------------------------------*/
+void ls_dispose(struct lockstep_t* ls) {
+    for(int i=0; i<ls->lanes; i++) {
+        machine_dispose(&ls->m[i]);
+    }
+    free(ls->m);
+    ls->m = NULL;
+}
+
+/* the registers of a lane from the register file into cpu */
+static void ls_load_regs(struct lockstep_t* ls, int lane, struct processor_t* cpu) {
+    cpu->is_running = ls->active[lane]!=0;
+    cpu->A = ls->A[lane];
+    cpu->X = ls->X[lane];
+    cpu->Y = ls->Y[lane];
+    cpu->SP = ls->SP[lane];
+    cpu->PC = ls->PC[lane];
+
+    cpu->neg = ls->neg[lane];
+    cpu->over = ls->over[lane];
+    cpu->brk = ls->brk[lane];
+    cpu->dec = ls->dec[lane];
+    cpu->ids = ls->ids[lane];
+    cpu->zero = ls->zero[lane];
+    cpu->carry = ls->carry[lane];
+}
+
+/* the registers of cpu into the register file */
+static void ls_store_regs(struct lockstep_t* ls, int lane, struct processor_t* cpu) {
+    ls->A[lane] = cpu->A;
+    ls->X[lane] = cpu->X;
+    ls->Y[lane] = cpu->Y;
+    ls->SP[lane] = cpu->SP;
+    ls->PC[lane] = cpu->PC;
+
+    ls->neg[lane] = cpu->neg;
+    ls->over[lane] = cpu->over;
+    ls->brk[lane] = cpu->brk;
+    ls->dec[lane] = cpu->dec;
+    ls->ids[lane] = cpu->ids;
+    ls->zero[lane] = cpu->zero;
+    ls->carry[lane] = cpu->carry;
+
+    if(!cpu->is_running)
+        ls->active[lane] = 0;
+}
+
+/*---------------------------------------------------*/
+/* brief: gather the cpu of a lane, cycles and pins included */
+/*---------------------------------------*/
+void ls_get_cpu(struct lockstep_t* ls, int lane, struct processor_t* cpu) {
+    *cpu = ls->m[lane].cpu;
+    ls_load_regs(ls, lane, cpu);
+}
+
+/*---------------------------------------------------*/
+/* brief: scatter the cpu of a lane */
+/*---------------------------------------*/
+void ls_set_cpu(struct lockstep_t* ls, int lane, struct processor_t* cpu) {
+    if(cpu!=&ls->m[lane].cpu)
+        ls->m[lane].cpu = *cpu;
+    ls_store_regs(ls, lane, cpu);
+}
+
+/* an input, the via or an interrupt is due before the next instruction */
+static bool ls_lane_due(struct machine_t* m) {
+    return m->cpu.cycles>=m->next_input || m->cpu.cycles>=m->via.due
+        || (m->via.irq && !m->cpu.ids);
+}
+
+/*---------------------------------------------------*/
+/* brief: select the pending lanes at the same instruction as leader */
+/*---------------------------------------*/
+static ls_v8_t ls_group(struct lockstep_t* ls, int leader, ls_v8_t pending) {
+
+    uint16_t pc = ls->PC[leader];
+    ls_v8_t group = (ls_v8_t)__builtin_convertvector(
+            (ls_m16_t)(ls->PC==pc), ls_m8_t) & pending;
+
+    struct mem* lead = &ls->m[leader].mem;
+    int bytes = cpu_op_get_n_bytes(mem_get_data_byte(lead, pc))+1;
+
+    for(int i=leader+1; i<ls->lanes; i++) {
+        if(!group[i])
+            continue;
+
+        // code in RAM, or a store into ROM, can differ between lanes
+        for(int b=0; b<bytes; b++) {
+            uint16_t addr = pc+b;
+            if(mem_get_data_byte(&ls->m[i].mem, addr)
+                != mem_get_data_byte(lead, addr))
+            {
+                group[i] = 0;
+                break;
+            }
+        }
+    }
+
+    return group;
+}
+
+static void ls_set_nz(struct lockstep_t* ls, ls_v8_t group, ls_v8_t val) {
+    LS_BLEND(ls->zero, (ls_v8_t)(val==0) & 1);
+    LS_BLEND(ls->neg, val>>7);
+}
+
+/*---------------------------------------------------*/
+/* brief: execute the shared instruction on every lane at once */
+/*---------------------------------------*/
+static int ls_step_vector(struct lockstep_t* ls, int leader, ls_v8_t group) {
+
+    struct mem* lead = &ls->m[leader].mem;
+    uint16_t pc = ls->PC[leader];
+    enum opcode_e op = mem_fetch_byte(lead, pc);
+    int bytes = cpu_op_get_n_bytes(op);
+
+    ls_v8_t none = {0};
+    ls_v8_t one = none + 1;
+    ls_v8_t oper = none + mem_fetch_byte(lead, pc+1);
+    uint16_t address = mem_fetch_byte(lead, pc+1) | mem_fetch_byte(lead, pc+2)<<8;
+
+    ls_v16_t group16 = (ls_v16_t)__builtin_convertvector(
+            (ls_m8_t)group, ls_m16_t);
+
+    ls_v16_t next = ls->PC + (uint16_t)(bytes+1);
+    ls_v8_t tmp;
+    ls_v8_t taken = none;
+
+    switch(op) {
+        case LDA_IMM:
+            LS_BLEND(ls->A, oper);
+            ls_set_nz(ls, group, ls->A);
+            break;
+        case LDX_IMM:
+            LS_BLEND(ls->X, oper);
+            ls_set_nz(ls, group, ls->X);
+            break;
+        case LDY_IMM:
+            LS_BLEND(ls->Y, oper);
+            ls_set_nz(ls, group, ls->Y);
+            break;
+
+        case AND_IMM:
+            LS_BLEND(ls->A, ls->A & oper);
+            ls_set_nz(ls, group, ls->A);
+            break;
+        case EOR_IMM:
+            LS_BLEND(ls->A, ls->A ^ oper);
+            ls_set_nz(ls, group, ls->A);
+            break;
+        case ORA_IMM:
+            LS_BLEND(ls->A, ls->A | oper);
+            ls_set_nz(ls, group, ls->A);
+            break;
+
+        case ADC_IMM:
+            tmp = ls->A;
+            LS_BLEND(ls->A, ls->A + oper + ls->carry);
+            LS_BLEND(ls->carry, (ls_v8_t)(ls->A<tmp) & 1);
+            ls_set_nz(ls, group, ls->A);
+            break;
+        case SBC_IMM:
+            tmp = ls->A;
+            LS_BLEND(ls->A, ls->A - oper - ls->carry);
+            LS_BLEND(ls->carry, (ls_v8_t)(ls->A<tmp) & 1);
+            ls_set_nz(ls, group, ls->A);
+            break;
+
+        case CMP_IMM:
+            LS_BLEND(ls->carry, (ls_v8_t)(ls->A>=oper) & 1);
+            ls_set_nz(ls, group, ls->A - oper);
+            break;
+        case CPX_IMM:
+            LS_BLEND(ls->carry, (ls_v8_t)(ls->X>=oper) & 1);
+            ls_set_nz(ls, group, ls->X - oper);
+            break;
+        case CPY_IMM:
+            LS_BLEND(ls->carry, (ls_v8_t)(ls->Y>=oper) & 1);
+            ls_set_nz(ls, group, ls->Y - oper);
+            break;
+
+        case INX_IMP:
+            LS_BLEND(ls->X, ls->X + 1);
+            ls_set_nz(ls, group, ls->X);
+            break;
+        case INY_IMP:
+            LS_BLEND(ls->Y, ls->Y + 1);
+            ls_set_nz(ls, group, ls->Y);
+            break;
+        case DEX_IMP:
+            LS_BLEND(ls->X, ls->X - 1);
+            ls_set_nz(ls, group, ls->X);
+            break;
+        case DEY_IMP:
+            LS_BLEND(ls->Y, ls->Y - 1);
+            ls_set_nz(ls, group, ls->Y);
+            break;
+
+        case TAX_IMP:
+            LS_BLEND(ls->X, ls->A);
+            ls_set_nz(ls, group, ls->X);
+            break;
+        case TAY_IMP:
+            LS_BLEND(ls->Y, ls->A);
+            ls_set_nz(ls, group, ls->Y);
+            break;
+        case TXA_IMP:
+            LS_BLEND(ls->A, ls->X);
+            ls_set_nz(ls, group, ls->A);
+            break;
+        case TYA_IMP:
+            LS_BLEND(ls->A, ls->Y);
+            ls_set_nz(ls, group, ls->A);
+            break;
+        case TSX_IMP:
+            LS_BLEND(ls->X, ls->SP);
+            ls_set_nz(ls, group, ls->X);
+            break;
+        case TXS_IMP:
+            LS_BLEND(ls->SP, ls->X);
+            break;
+
+        case CLC_IMP: LS_BLEND(ls->carry, none); break;
+        case SEC_IMP: LS_BLEND(ls->carry, one); break;
+        case CLD_IMP: LS_BLEND(ls->dec, none); break;
+        case SED_IMP: LS_BLEND(ls->dec, one); break;
+        case CLI_IMP: LS_BLEND(ls->ids, none); break;
+        case SEI_IMP: LS_BLEND(ls->ids, one); break;
+        case CLV_IMP: LS_BLEND(ls->over, none); break;
+
+        case NOP:
+            break;
+
+        case BCC_REL: taken = (ls_v8_t)(ls->carry==0); break;
+        case BCS_REL: taken = (ls_v8_t)(ls->carry!=0); break;
+        case BNE_REL: taken = (ls_v8_t)(ls->zero==0); break;
+        case BEQ_REL: taken = (ls_v8_t)(ls->zero!=0); break;
+        case BPL_REL: taken = (ls_v8_t)(ls->neg==0); break;
+        case BMI_REL: taken = (ls_v8_t)(ls->neg!=0); break;
+        case BVC_REL: taken = (ls_v8_t)(ls->over==0); break;
+        case BVS_REL: taken = (ls_v8_t)(ls->over!=0); break;
+
+        case JMP_ABS:
+            next = (ls_v16_t){0} + address;
+            break;
+
+        // same address in every lane, decoded once
+        case LDA_ZPG:
+        case LDA_ABS:
+            if(op==LDA_ZPG)
+                address &= 0xff;
+            // a read of the ports or the via is left to machine_step
+            if(lead->device[address>>8])
+                return -1;
+            for(int i=leader; i<ls->lanes; i++) {
+                if(group[i])
+                    ls->A[i] = mem_get_data_byte(&ls->m[i].mem, address);
+            }
+            ls_set_nz(ls, group, ls->A);
+            break;
+        case STA_ZPG:
+        case STA_ABS:
+            if(op==STA_ZPG)
+                address &= 0xff;
+            for(int i=leader; i<ls->lanes; i++) {
+                if(group[i])
+                    mem_set_data_byte(&ls->m[i].mem, address, ls->A[i]);
+            }
+            break;
+
+        default:
+            return -1;
+    }
+
+    if(cpu_get_op_type(op)==OP_REL) {
+        ls_v16_t offset = (ls_v16_t)__builtin_convertvector(
+                (ls_m8_t)(taken & oper), ls_m16_t);
+        next += offset;
+    }
+
+    LS_BLEND16(ls->PC, next);
+
+    // taken branches cost one more cycle, two across a page, as in cpu_step
+    uint16_t fall = pc+bytes+1;
+    for(int i=leader; i<ls->lanes; i++) {
+        if(!group[i])
+            continue;
+
+        uint64_t* cycles = &ls->m[i].cpu.cycles;
+
+        *cycles += ls->op_cycles[op];
+        if(ls->PC[i]!=fall && cpu_get_op_type(op)==OP_REL)
+            *cycles += (ls->PC[i]>>8)==(fall>>8) ? 1 : 2;
+    }
+
+    return 0;
+}
+
+/*---------------------------------------------------*/
+/* brief: step a single lane on its board, inputs and interrupts included */
+/*---------------------------------------*/
+static void ls_step_scalar(struct lockstep_t* ls, int lane) {
+    struct machine_t* m = &ls->m[lane];
+
+    ls_load_regs(ls, lane, &m->cpu);
+    machine_step(m);
+    ls_store_regs(ls, lane, &m->cpu);
+}
+
+/*---------------------------------------------------*/
+/* brief: step every lane once, vectorized across lanes that agree */
+/*---------------------------------------*/
+int ls_step(struct lockstep_t* ls) {
+
+    ls_v8_t pending = ls->active;
+    ls_v8_t quiet = {0};
+    int running = 0;
+
+    for(int i=0; i<ls->lanes; i++) {
+        quiet[i] = ls_lane_due(&ls->m[i]) ? 0 : 0xff;
+    }
+
+    for(int leader=0; leader<ls->lanes; leader++) {
+        if(!pending[leader])
+            continue;
+
+        // a lane with something due before its instruction steps alone
+        ls_v8_t alone = {0};
+        alone[leader] = 0xff;
+
+        ls_v8_t group = ls_group(ls, leader, quiet[leader] ? pending & quiet : alone);
+        pending &= ~group;
+
+        int size = 0;
+        for(int i=leader; i<ls->lanes; i++) {
+            size += group[i]!=0;
+        }
+
+        running += size;
+
+        if(size>1 && ls_step_vector(ls, leader, group)==0) {
+            ls->vector_inst += size;
+            continue;
+        }
+
+        for(int i=leader; i<ls->lanes; i++) {
+            if(group[i])
+                ls_step_scalar(ls, i);
+        }
+        ls->scalar_inst += size;
+    }
+
+    if(running==0)
+        return 1;
+
+    return 0;
+}
+
+static double ls_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec/1e9;
+}
+
+/* lane i toggles its button every LS_BENCH_PERIOD*(i+1) steps */
+static bool ls_bench_btn(int lane, unsigned long step) {
+    return (step/(LS_BENCH_PERIOD*(lane+1))) & 1;
+}
+
+/* memory, display or via not the same on both boards */
+static bool ls_board_differs(struct machine_t* a, struct machine_t* b) {
+    for(int p=0; p<MEM_PAGES; p++) {
+        if(memcmp(a->mem.pages[p]->data, b->mem.pages[p]->data, MEM_PAGE_SIZE)!=0)
+            return true;
+    }
+
+    uint8_t da[MACHINE_DEVICE_SIZE];
+    uint8_t db[MACHINE_DEVICE_SIZE];
+    machine_save_devices(a, da);
+    machine_save_devices(b, db);
+
+    return memcmp(da, db, MACHINE_DEVICE_SIZE)!=0;
+}
+
+/*---------------------------------------------------*/
+/* brief: compare the lockstep core against the scalar one */
+/*---------------------------------------*/
+int ls_bench(char* filename, int lanes, unsigned long steps) {
+
+    struct lockstep_t ls;
+    if(ls_init(&ls, lanes, filename)!=0) {
+        fprintf(stderr, "cannot load %s with %d lanes\n", filename, lanes);
+        return 1;
+    }
+
+    double start = ls_now();
+    for(unsigned long s=0; s<steps; s++) {
+        for(int i=0; i<lanes; i++) {
+            machine_input(&ls.m[i], INPUT_BUTTON, ls_bench_btn(i, s));
+        }
+        if(ls_step(&ls)!=0)
+            break;
+    }
+    double ls_time = ls_now()-start;
+
+    unsigned long scalar_inst = 0;
+    double scalar_time = 0;
+    int mismatch = 0;
+
+    // the reference is the board of the interface and the headless runs
+    static struct machine_t ref;
+
+    for(int i=0; i<lanes; i++) {
+        machine_init(&ref, filename);
+        struct processor_t* cpu = &ref.cpu;
+
+        start = ls_now();
+        for(unsigned long s=0; s<steps && cpu->is_running; s++) {
+            machine_input(&ref, INPUT_BUTTON, ls_bench_btn(i, s));
+            machine_step(&ref);
+            scalar_inst++;
+        }
+        scalar_time += ls_now()-start;
+
+        struct processor_t lane;
+        ls_get_cpu(&ls, i, &lane);
+        if(lane.A!=cpu->A || lane.X!=cpu->X || lane.Y!=cpu->Y
+            || lane.SP!=cpu->SP || lane.PC!=cpu->PC
+            || lane.carry!=cpu->carry || lane.zero!=cpu->zero
+            || lane.neg!=cpu->neg || lane.over!=cpu->over
+            || lane.ids!=cpu->ids || lane.cycles!=cpu->cycles
+            || ls_board_differs(&ls.m[i], &ref))
+        {
+            mismatch++;
+        }
+
+        machine_dispose(&ref);
+    }
+
+    unsigned long ls_inst = ls.vector_inst+ls.scalar_inst;
+    double scalar_ips = scalar_inst/scalar_time;
+    double ls_ips = ls_inst/ls_time;
+
+    printf("lanes........ : %d\n", lanes);
+    printf("scalar....... : %lu inst in %.3fs, %.2f Minst/s\n",
+            scalar_inst, scalar_time, scalar_ips/1e6);
+    printf("lockstep..... : %lu inst in %.3fs, %.2f Minst/s (x%.2f)\n",
+            ls_inst, ls_time, ls_ips/1e6, ls_ips/scalar_ips);
+    printf("vectorized... : %.1f%%\n", 100.0*ls.vector_inst/ls_inst);
+    printf("lane mismatch : %d\n", mismatch);
+
+    ls_dispose(&ls);
+
+    return mismatch!=0;
+}
@@ -0,0 +1,158 @@
+#include <lz.h>
+#include <string.h>
+
+#define LZ_MAX_OFFSET 0xffff
+
+static inline uint32_t lz_read32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t lz_hash(uint32_t v) {
+    return (v*2654435761u)>>(32-LZ_HASH_BITS);
+}
+
+static uint8_t* lz_put_len(uint8_t* dst, size_t len) {
+    while(len>=255) {
+        *dst++ = 255;
+        len -= 255;
+    }
+    *dst++ = len;
+    return dst;
+}
+
+static uint8_t* lz_put_seq(
+    uint8_t* dst, const uint8_t* lit, size_t n_lit, 
+    size_t offset, size_t match) 
+{
+    uint8_t* token = dst++;
+    size_t mlen = match ? match-LZ_MIN_MATCH : 0;
+
+    *token = (n_lit<15 ? n_lit : 15)<<4 | (mlen<15 ? mlen : 15);
+
+    if(n_lit>=15)
+        dst = lz_put_len(dst, n_lit-15);
+
+    memcpy(dst, lit, n_lit);
+    dst += n_lit;
+
+    if(match) {
+        *dst++ = offset & 0xff;
+        *dst++ = offset>>8;
+
+        if(mlen>=15)
+            dst = lz_put_len(dst, mlen-15);
+    }
+
+    return dst;
+}
+
+/*---------------------------------------------------*/
+/* brief: worst case compressed size of n bytes */
+/*---------------------------------------*/
+size_t lz_bound(size_t n) {
+    return n+n/255+16;
+}
+
+/*---------------------------------------------------*/
+/* brief: compress n bytes of src, dst holds lz_bound(n) */
+/*---------------------------------------*/
+size_t lz_compress(const uint8_t* src, size_t n, uint8_t* dst) {
+    uint32_t table[1<<LZ_HASH_BITS];
+    memset(table, 0, sizeof(table));
+
+    uint8_t* out = dst;
+    size_t anchor = 0;
+    size_t i = 0;
+
+    // positions are stored +1, 0 is an empty slot
+    while(i+LZ_MIN_MATCH<=n) {
+        uint32_t v = lz_read32(src+i);
+        uint32_t h = lz_hash(v);
+        size_t cand = table[h];
+        table[h] = i+1;
+
+        if(cand==0 || i-(cand-1)>LZ_MAX_OFFSET || lz_read32(src+cand-1)!=v) {
+            i++;
+            continue;
+        }
+
+        cand--;
+        size_t len = LZ_MIN_MATCH;
+        while(i+len<n && src[cand+len]==src[i+len]) {
+            len++;
+        }
+
+        out = lz_put_seq(out, src+anchor, i-anchor, i-cand, len);
+
+        i += len;
+        anchor = i;
+    }
+
+    return lz_put_seq(out, src+anchor, n-anchor, 0, 0)-dst;
+}
+
+static int lz_get_len(const uint8_t** p, const uint8_t* end, size_t* len) {
+    uint8_t b;
+    do {
+        if(*p>=end)
+            return 1;
+        b = *(*p)++;
+        *len += b;
+    } while(b==255);
+
+    return 0;
+}
+
+/*---------------------------------------------------*/
+/* brief: expand n bytes of src into at most cap bytes of dst */
+/*---------------------------------------*/
+int lz_decompress(
+    const uint8_t* src, size_t n, uint8_t* dst, size_t cap, size_t* out) 
+{
+    const uint8_t* end = src+n;
+    size_t o = 0;
+
+    while(src<end) {
+        uint8_t token = *src++;
+
+        size_t n_lit = token>>4;
+        if(n_lit==15 && lz_get_len(&src, end, &n_lit)!=0)
+            return 1;
+
+        if(n_lit>(size_t)(end-src) || n_lit>cap-o)
+            return 1;
+
+        memcpy(dst+o, src, n_lit);
+        src += n_lit;
+        o += n_lit;
+
+        if(src==end)
+            break;
+
+        if(end-src<2)
+            return 1;
+
+        size_t offset = src[0] | src[1]<<8;
+        src += 2;
+
+        size_t len = token & 0xf;
+        if(len==15 && lz_get_len(&src, end, &len)!=0)
+            return 1;
+        len += LZ_MIN_MATCH;
+
+        if(offset==0 || offset>o || len>cap-o)
+            return 1;
+
+        // overlapping matches repeat the last offset bytes
+        for(size_t k=0; k<len; k++) {
+            dst[o+k] = dst[o-offset+k];
+        }
+        o += len;
+    }
+
+    *out = o;
+
+    return 0;
+}
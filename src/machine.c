@@ -0,0 +1,328 @@
+#include <machine.h>
+#include <script.h>
+
+const char* MACHINE_STOP_NAMES[] = {
+    "step limit", "breakpoint", "watchpoint", "halted", "cycle limit"
+};
+
+/*---------------------------------------------------*/
+/* brief: what a read of the i/o page sees at this cycle */
+/* a port reads its register on the output pins, the outside on the others */
+/*---------------------------------------*/
+static uint8_t machine_read_port(void* ctx, uint16_t addr, uint8_t stored) {
+    struct machine_t* m = ctx;
+    uint8_t pins;
+
+    if((addr>>8)==(MEM_VIA>>8))
+        return via_peek(&m->via, m->cpu.cycles, addr);
+
+    switch(addr) {
+        case MEM_PTA:
+            // a read of the display drives the bus while E is high
+            pins = m->lcd.driving ? m->lcd.out : m->cpu.pins[0];
+            break;
+        case MEM_PTB:
+            pins = (m->cpu.pins[1] & ~MACHINE_BTN_MASK) 
+                | (m->cpu.button_pressed ? MACHINE_BTN_MASK : 0);
+            break;
+        default:
+            return stored;
+    }
+
+    // the data direction register, as stored, 1 for an output
+    uint8_t ddr = m->mem.pages[addr>>8]->data[(addr+MEM_DDRA-MEM_PTA) & 0xff];
+
+    return (stored & ddr) | (pins & ~ddr);
+}
+
+/*---------------------------------------------------*/
+/* brief: pass a store to the via, or the level of the control lines */
+/* to the display, which only acts when a store to PTB or DDRB moves E */
+/*---------------------------------------*/
+static void machine_write_port(void* ctx, uint16_t addr, uint8_t old, uint8_t val) {
+    struct machine_t* m = ctx;
+    uint8_t* io = m->mem.pages[MEM_PTA>>8]->data;
+
+    (void)old;
+
+    if((addr>>8)==(MEM_VIA>>8)) {
+        via_write(&m->via, m->cpu.cycles, addr, val);
+        return;
+    }
+
+    if(addr!=MEM_PTB && addr!=MEM_DDRB)
+        return;
+
+    lcd_edge(&m->lcd, m->cpu.cycles,
+        machine_read_port(m, MEM_PTB, io[MEM_PTB & 0xff]),
+        machine_read_port(m, MEM_PTA, io[MEM_PTA & 0xff]));
+}
+
+/*---------------------------------------------------*/
+/* brief: power on the board with the rom in filename */
+/*---------------------------------------*/
+int machine_init(struct machine_t* m, char* filename) {
+    cpu_init(&m->cpu);
+    mem_init(&m->mem);
+    mem_set_device(&m->mem, MEM_PTA>>8, machine_read_port, machine_write_port, m);
+    mem_set_device(&m->mem, MEM_VIA>>8, machine_read_port, machine_write_port, m);
+    lcd_init(&m->lcd);
+    via_init(&m->via);
+    m->script = NULL;
+    m->input_hook = NULL;
+    m->interrupted = false;
+    machine_replay(m, NULL);
+
+    int rc = mem_load(&m->mem, filename);
+
+    cpu_load_res_addr(&m->cpu, &m->mem);
+    mem_baseline(&m->mem, &m->pristine);
+
+    if(rc!=0)
+        m->cpu.is_running = false;
+
+    return rc;
+}
+
+/*---------------------------------------------------*/
+/* brief: release the memory of the board */
+/*---------------------------------------*/
+void machine_dispose(struct machine_t* m) {
+    mem_dispose(&m->mem);
+    mem_dispose(&m->pristine);
+}
+
+/*---------------------------------------------------*/
+/* brief: reset the cpu, memory is left as it is */
+/*---------------------------------------*/
+void machine_reset(struct machine_t* m) {
+    uint8_t* coverage = m->cpu.coverage;
+
+    cpu_init(&m->cpu);
+    cpu_load_res_addr(&m->cpu, &m->mem);
+    m->cpu.coverage = coverage;
+
+    // the display keeps its power, its busy time counted in the old cycles
+    m->lcd.busy_until = 0;
+
+    // the reset line of the via is the one of the cpu
+    via_init(&m->via);
+
+    // the cycles start again, so do the inputs
+    machine_replay(m, m->replay);
+}
+
+/*---------------------------------------------------*/
+/* brief: power cycle the board without reloading the rom */
+/* return the bytes copied, only the pages stored to since are restored */
+/*---------------------------------------*/
+size_t machine_restart(struct machine_t* m) {
+    size_t bytes = mem_revert(&m->mem, &m->pristine);
+
+    lcd_init(&m->lcd);
+    machine_reset(m);
+
+    return bytes;
+}
+
+/*---------------------------------------------------*/
+/* brief: execute one instruction, or take the interrupt */
+/* an interrupt is a step of its own, the next one runs the handler */
+/*---------------------------------------*/
+int machine_step(struct machine_t* m) {
+    if(m->cpu.cycles>=m->next_input)
+        machine_feed(m);
+    if(m->cpu.cycles>=m->via.due)
+        via_update(&m->via, m->cpu.cycles);
+
+    // the irq line is a level, taken between the instructions when I is clear
+    m->interrupted = m->via.irq && !m->cpu.ids;
+    if(m->interrupted) {
+        cpu_interrupt(&m->cpu, &m->mem, MEM_IRQ);
+        return 0;
+    }
+
+    uint64_t at = m->cpu.cycles;
+    enum opcode_e op = cpu_fetch(&m->cpu, &m->mem);
+    int rc = cpu_step(&m->cpu, &m->mem, op);
+
+    // reads of the via have side effects, peeks by the debugger do not
+    if((m->mem.last_selected>>8)==(MEM_VIA>>8) && cpu_op_reads_ea(op))
+        via_read(&m->via, at, m->mem.last_selected);
+
+    if(rc!=0) {
+        m->cpu.is_running = false;
+    }
+
+    return rc;
+}
+
+/*---------------------------------------------------*/
+/* brief: run up to steps instructions or until a break or watchpoint */
+/* to resume from a breakpoint step over it first, obs may be NULL */
+/*---------------------------------------*/
+enum machine_stop_e machine_run(
+    struct machine_t* m, unsigned long steps, 
+    struct breakpoints_t* bp, struct watchpoints_t* wp, 
+    struct machine_observer_t* obs, unsigned long* executed) 
+{
+    unsigned long n = 0;
+    enum machine_stop_e stop = MACHINE_STOP_STEPS;
+    bool breaks = bp!=NULL && bp->count>0;
+    bool watches = wp!=NULL && wp->n>0;
+
+    if(!breaks && !watches && obs==NULL) {
+        for(; n<steps && m->cpu.is_running; n++) {
+            machine_step(m);
+        }
+    } else {
+        for(; n<steps && m->cpu.is_running; n++) {
+            if(breaks && bp_test(bp, m->cpu.PC) 
+                && bp_check(bp, &m->cpu, &m->mem)) 
+            {
+                stop = MACHINE_STOP_BREAKPOINT;
+                break;
+            }
+
+            if(obs!=NULL) {
+                // inputs due go in first, the observer sees them on their own
+                if(m->cpu.cycles>=m->next_input)
+                    machine_feed(m);
+                if(obs->before!=NULL)
+                    obs->before(obs->ctx, m);
+            }
+            if(watches)
+                watch_begin(wp, &m->cpu, &m->mem);
+
+            machine_step(m);
+
+            if(obs!=NULL) {
+                if(m->interrupted) {
+                    if(obs->interrupt!=NULL)
+                        obs->interrupt(obs->ctx, m);
+                } else if(obs->after!=NULL) {
+                    obs->after(obs->ctx, m);
+                }
+            }
+            if(watches && watch_end(wp, &m->cpu, &m->mem)) {
+                stop = MACHINE_STOP_WATCHPOINT;
+                n++;
+                break;
+            }
+        }
+    }
+
+    if(!m->cpu.is_running && stop==MACHINE_STOP_STEPS)
+        stop = MACHINE_STOP_HALTED;
+
+    *executed = n;
+
+    return stop;
+}
+
+/*---------------------------------------------------*/
+/* brief: run until cycle is reached, a breakpoint or a halt */
+/* bp is only read, runs on other threads can share it */
+/*---------------------------------------*/
+enum machine_stop_e machine_run_to(
+    struct machine_t* m, uint64_t cycle, 
+    struct breakpoints_t* bp, unsigned long* executed) 
+{
+    unsigned long n = 0;
+    enum machine_stop_e stop = MACHINE_STOP_CYCLES;
+    bool breaks = bp!=NULL && bp->count>0;
+
+    while(m->cpu.cycles<cycle) {
+        if(!m->cpu.is_running) {
+            stop = MACHINE_STOP_HALTED;
+            break;
+        }
+        if(breaks && bp_test(bp, m->cpu.PC) && bp_check(bp, &m->cpu, &m->mem)) {
+            stop = MACHINE_STOP_BREAKPOINT;
+            break;
+        }
+
+        machine_step(m);
+        n++;
+    }
+
+    *executed = n;
+
+    return stop;
+}
+
+/*---------------------------------------------------*/
+/* brief: apply an external input to the board */
+/* the pins are only looked at when the program reads its port */
+/*---------------------------------------*/
+void machine_input(struct machine_t* m, uint8_t device, uint8_t value) {
+    switch(device) {
+        case INPUT_BUTTON:
+            m->cpu.button_pressed = value;
+            break;
+        case INPUT_PTA:
+        case INPUT_PTB:
+            m->cpu.pins[device-INPUT_PTA] = value;
+            break;
+    }
+
+    if(m->input_hook!=NULL)
+        m->input_hook(m->input_ctx, device, value);
+}
+
+
+/*---------------------------------------------------*/
+/* brief: feed the events of log at their cycles from now on */
+/* the log is not copied, NULL stops feeding */
+/*---------------------------------------*/
+void machine_replay(struct machine_t* m, struct input_log_t* log) {
+    m->replay = log;
+    m->replay_next = log!=NULL ? input_log_find(log, m->cpu.cycles) : 0;
+
+    // the next step finds when the first input is due
+    m->next_input = 0;
+}
+
+/*---------------------------------------------------*/
+/* brief: apply the events of the replay due by now */
+/*---------------------------------------*/
+void machine_feed(struct machine_t* m) {
+    struct input_log_t* log = m->replay;
+    uint64_t next = UINT64_MAX;
+
+    if(log!=NULL) {
+        while(m->replay_next<log->n_events 
+            && log->events[m->replay_next].cycle<=m->cpu.cycles) 
+        {
+            struct input_event_t* ev = &log->events[m->replay_next++];
+            machine_input(m, ev->device, ev->value);
+        }
+
+        if(m->replay_next<log->n_events)
+            next = log->events[m->replay_next].cycle;
+    }
+
+    if(m->script!=NULL) {
+        uint64_t due = sc_feed(m->script, m);
+        if(due<next)
+            next = due;
+    }
+
+    m->next_input = next;
+}
+
+/*---------------------------------------------------*/
+/* brief: write the state of the devices to p, MACHINE_DEVICE_SIZE bytes */
+/*---------------------------------------*/
+void machine_save_devices(struct machine_t* m, uint8_t* p) {
+    lcd_save_state(&m->lcd, p);
+    via_save_state(&m->via, p+LCD_STATE_SIZE);
+}
+
+/*---------------------------------------------------*/
+/* brief: read a state written by machine_save_devices */
+/*---------------------------------------*/
+void machine_load_devices(struct machine_t* m, const uint8_t* p) {
+    lcd_load_state(&m->lcd, p);
+    via_load_state(&m->via, p+LCD_STATE_SIZE);
+}
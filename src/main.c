@@ -1,70 +1,958 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <time.h>
 #include <memory.h>
+#include <string.h>
 #include <processor.h>
 #include <common.h>
 #include <emulator.h>
 #include <log.h>
+#include <lockstep.h>
+#include <journal.h>
+#include <machine.h>
+#include <timetravel.h>
+#include <trace.h>
+#include <tracefile.h>
+#include <tracediff.h>
+#include <profile.h>
+#include <symbols.h>
+#include <callgraph.h>
+#include <timeline.h>
+#include <breakpoint.h>
+#include <watch.h>
+#include <shadow.h>
+#include <fuzz.h>
+#include <sweep.h>
+#include <snapstore.h>
+#include <savestate.h>
+#include <script.h>
 
+static void usage(char* name) {
+    fprintf(stderr, 
+        "usage: %s [-b addr] [-w watch [-W]] [-j bytes] [-k cycles] [-L lanes] [-X runs] [-f dir [-F runs]] [-S dir | -x dir [-C cycles] [-T n] [-o file]] [-A dir:name] [-a dir:name] [-l file] [-v file] [-i file | -I file] [-u file] [-r file] [-n steps] [-R] [-t file]"
+        " [-d file [-c n]] [-p file [-P n]] [-g file] [-e file] [-s file] <rom>\n", name);
+    fprintf(stderr, "  -b addr   breakpoint, stops -R and the other runs, can be repeated\n");
+    fprintf(stderr, "            \"addr if cond\" or a cond with PC==addr breaks if cond holds\n");
+    fprintf(stderr, "  -w watch  watchpoint [r][w][c]:addr[-addr] [if cond], read, write or change\n");
+    fprintf(stderr, "  -W        like -R, catching the stores of -w with page protection (linux)\n");
+    fprintf(stderr, "  -j bytes  memory budget of the step back journal\n");
+    fprintf(stderr, "  -k cycles cycles between time travel keyframes\n");
+    fprintf(stderr, "  -L lanes  benchmark the lockstep core with lanes boards, ports and via included\n");
+    fprintf(stderr, "  -X runs   benchmark restarting the board after each run of -n steps\n");
+    fprintf(stderr, "  -f dir    fuzz the inputs, saving the schedules that fault in dir\n");
+    fprintf(stderr, "  -F runs   runs of the fuzzer\n");
+    fprintf(stderr, "  -S dir    run every input schedule *.txt in dir, reporting the end states\n");
+    fprintf(stderr, "  -x dir    like -R, then forks a process running each schedule of dir\n");
+    fprintf(stderr, "            from where the run stopped\n");
+    fprintf(stderr, "  -C cycles cycle limits of -S and -x, comma separated, each one a run\n");
+    fprintf(stderr, "  -T n      workers of -S and -x, one per core by default\n");
+    fprintf(stderr, "  -o file   report of -S and -x, csv or .json, - for stdout\n");
+    fprintf(stderr, "  -A d:name like -R, starting from the snapshot name of the store in d\n");
+    fprintf(stderr, "  -a d:name like -R, saving where the run stops as name in the store in d\n");
+    fprintf(stderr, "  -l file   --load-state, start from the board saved in file\n");
+    fprintf(stderr, "  -v file   --save-state, like -R, saving the board where the run stops\n");
+    fprintf(stderr, "  -i file   like -R, feeding the inputs in file at their cycles\n");
+    fprintf(stderr, "  -u file   like -R, driving the inputs with the script in file\n");
+    fprintf(stderr, "  -I file   open the interface replaying the inputs in file\n");
+    fprintf(stderr, "  -r file   record the inputs of the run or of the interface to file,\n");
+    fprintf(stderr, "            compact if it ends with .bin\n");
+    fprintf(stderr, "  -n steps  steps per instance for the benchmarks, the fuzzer and -R\n");
+    fprintf(stderr, "  -R        run without the interface and report the speed\n");
+    fprintf(stderr, "  -t file   like -R, recording a binary trace to file\n");
+    fprintf(stderr, "  -d file   like -R, stopping where the run leaves the trace in file\n");
+    fprintf(stderr, "  -c n      records of context printed by -d\n");
+    fprintf(stderr, "  -p file   like -R, writing a hot spot profile to file, - for stdout\n");
+    fprintf(stderr, "  -P n      lines of the profile, 0 for all of them\n");
+    fprintf(stderr, "  -g file   like -R, writing the call paths as folded stacks to file\n");
+    fprintf(stderr, "  -e file   like -R, writing a chrome trace-event timeline to file\n");
+    fprintf(stderr, "  -s file   symbols, \"name = $addr\" lines\n");
+}
+
+/* absolute cycle, or relative to now with a leading + or - */
+static uint64_t parse_cycle(char* line, uint64_t now) {
+    uint64_t val = strtoull(line+(line[0]=='+' || line[0]=='-'), NULL, 0);
+
+    if(line[0]=='+')
+        return now+val;
+    if(line[0]=='-')
+        return val>now ? 0 : now-val;
+
+    return val;
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec+ts.tv_nsec*1e-9;
+}
+
+/* what the headless run records besides running the rom */
+struct headless_t {
+    unsigned long steps;
+    char* trace_file;
+    char* profile_file;
+    int profile_lines;
+    char* callgraph_file;
+    char* timeline_file;
+    char* sym_file;
+    char* input_file;
+    char* snap_load;
+    char* snap_save;
+    char* state_load;
+    char* state_save;
+    char* record_file;
+    char* script_file;
+    struct breakpoints_t* bp;
+    struct watchpoints_t* wp;
+    bool protect;
+
+    /* schedules run from where the run stops, as -S does from reset */
+    char* explore_dir;
+    char* limits;
+    int workers;
+    char* report;
+};
+
+/*---------------------------------------------------*/
+/* brief: write the profile report where the user asked */
+/*---------------------------------------*/
+static int write_profile(
+    struct headless_t* opt, struct profile_t* prof, 
+    struct mem* mem, struct symbols_t* syms) 
+{
+    bool to_stdout = strcmp(opt->profile_file, "-")==0;
+    FILE* fp = to_stdout ? stdout : fopen(opt->profile_file, "w");
+
+    if(fp==NULL) {
+        fprintf(stderr, "cannot write %s\n", opt->profile_file);
+        return 1;
+    }
+
+    profile_report(fp, prof, mem, syms, opt->profile_lines);
+
+    return !to_stdout && fclose(fp)!=0;
+}
+
+/*---------------------------------------------------*/
+/* brief: write the folded stacks, the call paths to stdout */
+/*---------------------------------------*/
+static int write_callgraph(
+    struct headless_t* opt, struct callgraph_t* cg, struct symbols_t* syms) 
+{
+    FILE* fp = fopen(opt->callgraph_file, "w");
+    int rc = 0;
+
+    if(fp==NULL || cg_write_folded(cg, fp, syms)!=0) {
+        fprintf(stderr, "cannot write %s\n", opt->callgraph_file);
+        rc = 1;
+    }
+    if(fp!=NULL && fclose(fp)!=0)
+        rc = 1;
+
+    cg_report(cg, stdout, syms, opt->profile_lines);
+
+    return rc;
+}
+
+/* save the first n events of log, those applied by the run, */
+/* merged in cycle order with those applied by a script */
+static int record_inputs(
+    const char* filename, struct input_log_t* log, size_t n, struct script_t* sc) 
+{
+    struct input_log_t merged;
+    size_t i = 0;
+    size_t k = 0;
+    int rc = 0;
+
+    input_log_init(&merged);
+    input_log_truncate(log, n);
+
+    while(rc==0 && (i<log->n_events || (sc!=NULL && k<sc->applied.n_events))) {
+        struct input_event_t* ev = sc==NULL || k==sc->applied.n_events 
+            || (i<log->n_events && log->events[i].cycle<=sc->applied.events[k].cycle)
+            ? &log->events[i++] : &sc->applied.events[k++];
+
+        rc = input_log_append(&merged, ev->cycle, ev->device, ev->value);
+    }
+
+    if(rc!=0 || input_log_save(&merged, filename)!=0) {
+        fprintf(stderr, "cannot record the inputs to %s\n", filename);
+        rc = 1;
+    } else {
+        printf("inputs...... : %zu recorded to %s\n", merged.n_events, filename);
+    }
+
+    input_log_dispose(&merged);
+
+    return rc;
+}
+
+/* save or load the snapshot named by "dir:name" in the store in dir */
+static int store_snapshot(char* spec, struct machine_t* m, bool save) {
+    char* colon = strrchr(spec, ':');
+    struct snapstore_t st;
+    int added = 0;
+    int rc = 1;
+
+    if(colon==NULL) {
+        fprintf(stderr, "expected dir:name, not %s\n", spec);
+        return 1;
+    }
+
+    *colon = '\0';
+    if(ss_open(&st, spec)!=0)
+        fprintf(stderr, "cannot open the snapshot store %s\n", spec);
+    else if(save && (rc = ss_put(&st, colon+1, m, &added))==0)
+        printf("snapshot.... : %s, %d of %d pages new, %u in the store\n",
+            colon+1, added, MEM_PAGES, st.n_pages);
+    else if(!save)
+        rc = ss_get(&st, colon+1, m);
+
+    if(rc!=0)
+        fprintf(stderr, "cannot %s snapshot %s in %s\n", 
+            save ? "save" : "load", colon+1, spec);
+
+    ss_close(&st);
+    *colon = ':';
+
+    return rc;
+}
+
+/* run the scenarios of dir from reset, or forked from the state of m */
+static int run_sweep(char* rom, char* dir, struct headless_t* opt, struct machine_t* m) {
+    struct sweep_t sweep;
+    int rc = 1;
+
+    if(sweep_init(&sweep, rom, dir, opt->bp)!=0)
+        fprintf(stderr, "cannot list %s\n", dir);
+    else if(opt->limits!=NULL && sweep_parse_limits(&sweep, opt->limits)!=0)
+        fprintf(stderr, "bad cycle limits %s\n", opt->limits);
+    else {
+        double start = now();
+
+        if((m==NULL ? sweep_run(&sweep, opt->workers) 
+                : sweep_explore(&sweep, m, opt->workers))!=0)
+            fprintf(stderr, "cannot run %s\n", rom);
+        else if(sweep_report(&sweep, opt->report)!=0)
+            fprintf(stderr, "cannot write %s\n", opt->report);
+        else
+            rc = 0;
+
+        fprintf(stderr, "%s : %zu runs on %d workers in %.3fs\n",
+            m==NULL ? "sweep......." : "explore.....", 
+            sweep.n_jobs, opt->workers, now()-start);
+    }
+
+    sweep_dispose(&sweep);
+
+    return rc;
+}
+
+/* what run_headless records of each step, the ones not asked NULL */
+struct instruments_t {
+    struct trace_t* tr;
+    struct timeline_t* tl;
+    struct profile_t* prof;
+    struct callgraph_t* cg;
+
+    /* the step under way */
+    uint16_t pc;
+    uint64_t cycles;
+    uint8_t op;
+};
+
+static void instruments_before(void* ctx, struct machine_t* m) {
+    struct instruments_t* in = ctx;
+
+    in->pc = m->cpu.PC;
+    in->cycles = m->cpu.cycles;
+    in->op = mem_fetch_byte(&m->mem, in->pc);
+
+    if(in->tr!=NULL)
+        trace_begin(in->tr, &m->cpu, &m->mem);
+    if(in->tl!=NULL)
+        tl_begin(in->tl, &m->cpu, &m->mem);
+}
+
+static void instruments_after(void* ctx, struct machine_t* m) {
+    struct instruments_t* in = ctx;
+    uint64_t taken = m->cpu.cycles-in->cycles;
+
+    if(in->tr!=NULL)
+        trace_end(in->tr, &m->cpu, &m->mem);
+    if(in->tl!=NULL)
+        tl_end(in->tl, &m->cpu, &m->mem);
+    if(in->prof!=NULL)
+        profile_add(in->prof, in->pc, taken);
+
+    if(in->cg!=NULL) {
+        // the jsr belongs to the caller, the rts and rti to the callee
+        cg_account(in->cg, taken);
+        if(in->op==JSR_ABS)
+            cg_call(in->cg, m->cpu.PC, m->cpu.SP);
+        else
+            cg_unwind(in->cg, m->cpu.SP);
+    }
+}
+
+/* the interrupt entry is a step of its own, a call into the handler */
+/* that leaves pc as the instruction it came before */
+static void instruments_interrupt(void* ctx, struct machine_t* m) {
+    struct instruments_t* in = ctx;
+    uint64_t taken = m->cpu.cycles-in->cycles;
+
+    if(in->tr!=NULL)
+        trace_interrupt(in->tr, &m->cpu, &m->mem);
+    if(in->tl!=NULL)
+        tl_interrupt(in->tl, &m->cpu, &m->mem);
+    if(in->prof!=NULL)
+        profile_add_entry(in->prof, m->cpu.PC, taken);
+    if(in->cg!=NULL) {
+        cg_call(in->cg, m->cpu.PC, m->cpu.SP);
+        cg_account(in->cg, taken);
+    }
+}
+
+/* run the rom for steps instructions, instrumented only if asked */
+static int run_headless(char* rom, struct headless_t* opt) {
+    struct machine_t m;
+    struct symbols_t syms;
+    struct trace_t trace;
+    struct trace_t* tr = NULL;
+    struct profile_t* prof = NULL;
+    struct callgraph_t callgraph;
+    struct callgraph_t* cg = NULL;
+    struct timeline_t timeline;
+    struct timeline_t* tl = NULL;
+    struct input_log_t inputs;
+    struct script_t script;
+    struct script_t* sc = NULL;
+    char err[128];
+    int rc = 1;
+
+    sym_init(&syms);
+    input_log_init(&inputs);
+
+    if(machine_init(&m, rom)!=0) {
+        fprintf(stderr, "cannot load %s\n", rom);
+        goto out;
+    }
+
+    if(opt->snap_load!=NULL && store_snapshot(opt->snap_load, &m, false)!=0)
+        goto out;
+
+    if(opt->state_load!=NULL && sv_load(&m, opt->state_load)!=0) {
+        fprintf(stderr, "cannot load the state %s\n", opt->state_load);
+        goto out;
+    }
+
+    if(opt->sym_file!=NULL && sym_load(&syms, opt->sym_file)!=0)
+        fprintf(stderr, "cannot read symbols from %s\n", opt->sym_file);
+
+    if(opt->input_file!=NULL) {
+        if(input_log_load(&inputs, opt->input_file)!=0) {
+            fprintf(stderr, "cannot read inputs from %s\n", opt->input_file);
+            goto out;
+        }
+        machine_replay(&m, &inputs);
+    }
+
+    if(opt->script_file!=NULL) {
+        sc = &script;
+        if(sc_load(sc, opt->script_file, err, sizeof(err))!=0) {
+            fprintf(stderr, "%s\n", err);
+            goto out;
+        }
+        sc_attach(sc, &m);
+    }
+
+    if(opt->trace_file!=NULL) {
+        if(trace_open(&trace, opt->trace_file, &m.cpu, &m.mem)!=0) {
+            fprintf(stderr, "cannot trace to %s\n", opt->trace_file);
+            goto out;
+        }
+        tr = &trace;
+        m.input_hook = trace_input;
+        m.input_ctx = tr;
+    }
+
+    if(opt->profile_file!=NULL && (prof = profile_new())==NULL) {
+        fprintf(stderr, "cannot allocate the profile\n");
+        goto out;
+    }
+
+    if(opt->callgraph_file!=NULL) {
+        if(cg_init(&callgraph, m.cpu.PC)!=0) {
+            fprintf(stderr, "cannot allocate the call graph\n");
+            goto out;
+        }
+        cg = &callgraph;
+    }
+
+    struct shadow_t shadow;
+    if(opt->protect) {
+        if(shadow_init(&shadow, &m.mem)!=0) {
+            fprintf(stderr, "page protection is not available\n");
+            goto out;
+        }
+        opt->wp->shadow = &shadow;
+    }
+
+    watch_attach(opt->wp, &m.mem);
+
+    if(opt->timeline_file!=NULL) {
+        if(tl_open(&timeline, opt->timeline_file, &m.cpu, &m.mem, &syms)!=0) {
+            fprintf(stderr, "cannot write %s\n", opt->timeline_file);
+            goto out;
+        }
+        tl = &timeline;
+    }
+
+    unsigned long n = 0;
+    unsigned long steps = opt->steps;
+    enum machine_stop_e stop = MACHINE_STOP_STEPS;
+    double start = now();
+
+    struct instruments_t inst = { .tr = tr, .tl = tl, .prof = prof, .cg = cg };
+    struct machine_observer_t obs = { 
+        instruments_before, instruments_after, instruments_interrupt, &inst 
+    };
+    bool observed = tr!=NULL || prof!=NULL || cg!=NULL || tl!=NULL;
+
+    stop = machine_run(&m, steps, opt->bp, opt->wp, observed ? &obs : NULL, &n);
+
+    rc = 0;
+    if(tr!=NULL) {
+        if(trace_close(tr, &m.mem)!=0) {
+            fprintf(stderr, "cannot write %s\n", opt->trace_file);
+            rc = 1;
+        }
+        m.input_hook = NULL;
+        tr = NULL;
+    }
+
+    double elapsed = now()-start;
+
+    printf("executed.... : %lu inst, %llu cycles in %.3fs, %.2f Minst/s\n",
+            n, (unsigned long long)m.cpu.cycles, elapsed, n/elapsed/1e6);
+    printf("stopped..... : %s at $%04x\n", MACHINE_STOP_NAMES[stop], m.cpu.PC);
+    if(stop==MACHINE_STOP_WATCHPOINT) {
+        char hit[64];
+        watch_format(&opt->wp->last, &m.mem, hit, sizeof(hit));
+        printf("watch....... : %s, cycle %llu\n", 
+            hit, (unsigned long long)opt->wp->last.cycle);
+    }
+    if(opt->trace_file!=NULL && n>0) {
+        printf("trace....... : %llu bytes, %.2f bytes/inst\n",
+            (unsigned long long)trace.file_bytes, (double)trace.file_bytes/n);
+    }
+    if(tl!=NULL) {
+        printf("timeline.... : %llu events\n", timeline.events);
+    }
+    if(m.lcd.edges>0 || m.lcd.display) {
+        char row[LCD_COLS+1];
+
+        lcd_line(&m.lcd, 0, row);
+        printf("display..... : |%s| %lu transfers, %lu while busy\n", 
+            row, m.lcd.edges, m.lcd.ignored);
+        lcd_line(&m.lcd, 1, row);
+        printf("               |%s|\n", row);
+    }
+
+    if(opt->snap_save!=NULL)
+        rc |= store_snapshot(opt->snap_save, &m, true);
+    if(opt->record_file!=NULL)
+        rc |= record_inputs(opt->record_file, &inputs, m.replay_next, sc);
+    if(opt->state_save!=NULL && sv_save(&m, opt->state_save)!=0) {
+        fprintf(stderr, "cannot save the state to %s\n", opt->state_save);
+        rc = 1;
+    }
+    if(prof!=NULL)
+        rc |= write_profile(opt, prof, &m.mem, &syms);
+    if(cg!=NULL)
+        rc |= write_callgraph(opt, cg, &syms);
+
+out:
+    if(tl!=NULL && tl_close(tl, &m.cpu, &m.mem)!=0) {
+        fprintf(stderr, "cannot write %s\n", opt->timeline_file);
+        rc = 1;
+    }
+    watch_detach(opt->wp, &m.mem);
+    if(opt->wp->shadow!=NULL) {
+        shadow_dispose(opt->wp->shadow);
+        opt->wp->shadow = NULL;
+    }
+    if(cg!=NULL)
+        cg_dispose(cg);
+    profile_free(prof);
+    if(tr!=NULL) {
+        trace_close(tr, &m.mem);
+        m.input_hook = NULL;
+    }
+
+    // with every hook gone, the children see the bare machine
+    if(rc==0 && opt->explore_dir!=NULL)
+        rc = run_sweep(rom, opt->explore_dir, opt, &m);
+
+    if(sc!=NULL)
+        sc_dispose(sc);
+    sym_dispose(&syms);
+    input_log_dispose(&inputs);
+    machine_dispose(&m);
+
+    return rc;
+}
+
+/* time runs of steps each, restarting the board in between */
+static int run_restarts(char* rom, unsigned long runs, unsigned long steps) {
+    struct machine_t m;
+    unsigned long n;
+    size_t bytes = 0;
+    double reset_time = 0;
+
+    if(machine_init(&m, rom)!=0) {
+        fprintf(stderr, "cannot load %s\n", rom);
+        machine_dispose(&m);
+        return 1;
+    }
+
+    double start = now();
+    for(unsigned long r=0; r<runs; r++) {
+        machine_run(&m, steps, NULL, NULL, NULL, &n);
+
+        double t = now();
+        bytes += machine_restart(&m);
+        reset_time += now()-t;
+    }
+    double elapsed = now()-start;
+
+    // the same with the rom reloaded every time
+    start = now();
+    for(unsigned long r=0; r<runs; r++) {
+        machine_dispose(&m);
+        machine_init(&m, rom);
+    }
+    double reload_time = now()-start;
+
+    printf("runs........ : %lu of %lu steps in %.3fs\n", runs, steps, elapsed);
+    printf("restart..... : %.0f ns, %zu bytes copied per run\n",
+            reset_time/runs*1e9, bytes/runs);
+    printf("reload...... : %.0f ns per run\n", reload_time/runs*1e9);
+
+    machine_dispose(&m);
+
+    return 0;
+}
+
+/* search input schedules for faults, saved in dir */
+static int run_fuzz(char* rom, char* dir, unsigned long runs, unsigned long steps) {
+    static struct fuzz_t fuzz;
+    int rc = 1;
+
+    if(mkdir(dir, 0777)!=0 && errno!=EEXIST)
+        fprintf(stderr, "cannot create %s\n", dir);
+    else if(fuzz_init(&fuzz, rom, dir, steps)!=0)
+        fprintf(stderr, "cannot load %s\n", rom);
+    else
+        rc = fuzz_campaign(&fuzz, runs);
+
+    fuzz_dispose(&fuzz);
+
+    return rc;
+}
+
+/* run the rom against a golden trace, exit status as diff(1) */
+static int run_diff(char* rom, unsigned long steps, char* golden_file, int context) {
+    struct tracefile_t golden;
+    if(tf_open(&golden, golden_file)!=0 || tf_scan(&golden)!=0) {
+        fprintf(stderr, "cannot read trace %s\n", golden_file);
+        tf_close(&golden);
+        return TD_ERROR;
+    }
+
+    struct machine_t m;
+    int rc = TD_ERROR;
+
+    if(machine_init(&m, rom)!=0)
+        fprintf(stderr, "cannot load %s\n", rom);
+    else
+        rc = td_diff_live(&golden, &m, steps, context);
+
+    machine_dispose(&m);
+    tf_close(&golden);
+
+    return rc;
+}
 
 int main(int argc, char* argv[]) {
 
+    int lanes = 0;
+    unsigned long runs = 0;
+    char* fuzz_dir = NULL;
+    unsigned long fuzz_runs = FUZZ_DEFAULT_RUNS;
+    char* sweep_dir = NULL;
+    size_t budget = JOURNAL_DEFAULT_BUDGET;
+    uint64_t interval = TT_DEFAULT_INTERVAL;
+    bool headless = false;
+    struct breakpoints_t breaks;
+    struct watchpoints_t watches;
+    struct headless_t run = { 
+        .steps = 1000000, 
+        .profile_lines = PROFILE_DEFAULT_LINES, 
+        .bp = &breaks, 
+        .wp = &watches, 
+        .workers = sysconf(_SC_NPROCESSORS_ONLN), 
+        .report = "-"
+    };
+    uint16_t addr;
+    struct watch_t watch;
+    struct cond_t cond;
+    bool has_cond;
+    char err[64];
+
+    bp_init(&breaks);
+    watch_init(&watches);
+    char* golden_file = NULL;
+    char* replay_file = NULL;
+    int context = TD_DEFAULT_CONTEXT;
+
+    static const struct option long_opts[] = {
+        {"load-state", required_argument, NULL, 'l'},
+        {"save-state", required_argument, NULL, 'v'},
+        {NULL, 0, NULL, 0}
+    };
+
+    int opt;
+    while((opt = getopt_long(argc, argv, 
+        "a:A:b:c:C:d:e:f:F:g:i:I:j:k:l:L:n:o:p:P:r:Rs:S:t:T:u:v:w:Wx:X:", long_opts, NULL))!=-1) 
+    {
+        switch(opt) {
+            case 'a':
+                headless = true;
+                run.snap_save = optarg;
+                break;
+            case 'A':
+                headless = true;
+                run.snap_load = optarg;
+                break;
+            case 'b':
+                if(bp_parse(optarg, &addr, &cond, &has_cond, err, sizeof(err))!=0) {
+                    fprintf(stderr, "bad breakpoint %s: %s\n", optarg, err);
+                    return 1;
+                }
+                if(!has_cond)
+                    bp_set(&breaks, addr);
+                else if(bp_set_cond(&breaks, addr, &cond)!=0) {
+                    fprintf(stderr, "too many conditional breakpoints\n");
+                    return 1;
+                }
+                break;
+            case 'c':
+                context = atoi(optarg);
+                break;
+            case 'C':
+                run.limits = optarg;
+                break;
+            case 'd':
+                golden_file = optarg;
+                break;
+            case 'e':
+                headless = true;
+                run.timeline_file = optarg;
+                break;
+            case 'f':
+                fuzz_dir = optarg;
+                break;
+            case 'F':
+                fuzz_runs = strtoul(optarg, NULL, 0);
+                break;
+            case 'g':
+                headless = true;
+                run.callgraph_file = optarg;
+                break;
+            case 'i':
+                headless = true;
+                run.input_file = optarg;
+                break;
+            case 'I':
+                replay_file = optarg;
+                break;
+            case 'j':
+                budget = strtoul(optarg, NULL, 0);
+                break;
+            case 'k':
+                interval = strtoull(optarg, NULL, 0);
+                break;
+            case 'l':
+                run.state_load = optarg;
+                break;
+            case 'L':
+                lanes = atoi(optarg);
+                break;
+            case 'n':
+                run.steps = strtoul(optarg, NULL, 0);
+                break;
+            case 'r':
+                run.record_file = optarg;
+                break;
+            case 'R':
+                headless = true;
+                break;
+            case 't':
+                headless = true;
+                run.trace_file = optarg;
+                break;
+            case 'o':
+                run.report = optarg;
+                break;
+            case 'p':
+                headless = true;
+                run.profile_file = optarg;
+                break;
+            case 'P':
+                run.profile_lines = atoi(optarg);
+                break;
+            case 's':
+                run.sym_file = optarg;
+                break;
+            case 'S':
+                sweep_dir = optarg;
+                break;
+            case 'T':
+                run.workers = atoi(optarg);
+                break;
+            case 'u':
+                headless = true;
+                run.script_file = optarg;
+                break;
+            case 'v':
+                headless = true;
+                run.state_save = optarg;
+                break;
+            case 'w':
+                if(watch_parse(optarg, &watch, err, sizeof(err))!=0) {
+                    fprintf(stderr, "bad watchpoint %s: %s\n", optarg, err);
+                    return 1;
+                }
+                if(watches.n==WATCH_MAX) {
+                    fprintf(stderr, "too many watchpoints\n");
+                    return 1;
+                }
+                watches.w[watches.n++] = watch;
+                break;
+            case 'W':
+                headless = true;
+                run.protect = true;
+                break;
+            case 'x':
+                headless = true;
+                run.explore_dir = optarg;
+                break;
+            case 'X':
+                runs = strtoul(optarg, NULL, 0);
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if(optind!=argc-1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if(lanes>0)
+        return ls_bench(argv[optind], lanes, run.steps);
+
+    if(runs>0)
+        return run_restarts(argv[optind], runs, run.steps);
+
+    if(fuzz_dir!=NULL)
+        return run_fuzz(argv[optind], fuzz_dir, fuzz_runs, run.steps);
+
+    if(sweep_dir!=NULL)
+        return run_sweep(argv[optind], sweep_dir, &run, NULL);
+
+    if(golden_file!=NULL)
+        return run_diff(argv[optind], run.steps, golden_file, context);
+
+    if(headless)
+        return run_headless(argv[optind], &run);
+
     LOG_INIT("debug.log")
 
-    if(argc==2) {
+    {
+        struct machine_t m;
+        machine_init(&m, argv[optind]);
 
-        
-        struct processor_t cpu;
-        cpu_init(&cpu);
+        const char* state_file = run.state_load!=NULL ? run.state_load : EMU_STATE_FILE;
+        if(run.state_load!=NULL && sv_load(&m, run.state_load)!=0) {
+            fprintf(stderr, "cannot load the state %s\n", run.state_load);
+            machine_dispose(&m);
+            LOG_CLOSE();
+            return 1;
+        }
 
-        struct mem mem;
-        mem_init(&mem);
-        int rc = mem_load(&mem, argv[1]);
+        struct journal_t journal;
+        if(journal_init(&journal, budget)!=0) {
+            m.cpu.is_running = false;
+        }
+        journal_attach(&journal, &m.mem);
 
-        cpu_load_res_addr(&cpu, &mem);
+        struct timetravel_t tt;
+        tt_init(&tt, interval);
+        tt_start(&tt, &m);
 
-        if(rc!=0) {
-            cpu.is_running = false;
+        struct input_log_t inputs;
+        input_log_init(&inputs);
+        if(replay_file!=NULL 
+            && (input_log_load(&inputs, replay_file)!=0 || tt_replay(&tt, &m, &inputs)!=0)) 
+        {
+            fprintf(stderr, "cannot read inputs from %s\n", replay_file);
+            m.cpu.is_running = false;
         }
+        input_log_dispose(&inputs);
     
         struct emulator_t emu;
-        emu_init(&emu, &mem);
+        emu_init(&emu, &m.mem);
+        emu.bp = &breaks;
+        emu.lcd = &m.lcd;
+        watch_attach(&watches, &m.mem);
 
         emu_display_commands(&emu.commands, emu.show_io);
 
-
-        enum opcode_e op;
+        char line[64];
+        char prompt[96];
+        char state[64];
+        unsigned long n;
+        enum machine_stop_e stop;
     
-        while(cpu.is_running) {
+        while(m.cpu.is_running) {
 
-            emu_display(&emu, &cpu, &mem);
+            emu_display(&emu, &m.cpu, &m.mem);
             int ch = getch();
 
             switch(ch) {
                 case 'q':
-                    cpu.is_running = false;
+                    m.cpu.is_running = false;
                     break;
                 case 'r':
-                    cpu_init(&cpu);
-                    cpu_load_res_addr(&cpu, &mem);
+                    machine_reset(&m);
+                    journal_clear(&journal);
+                    tt_start(&tt, &m);
                     break;
                 case 's':
-                    op = cpu_fetch(&cpu, &mem);
-                    if(cpu_step(&cpu, &mem, op)!=0) {
-                        cpu.is_running = false;
+                    journal_begin(&journal, &m.cpu);
+                    tt_step(&tt, &m);
+                    journal_end(&journal);
+                    break;
+                case 'u':
+                    if(journal_undo(&journal, &m.cpu, &m.mem)==0) {
+                        tt_sync(&tt, &m);
+                    }
+                    break;
+                case 't':
+                    if(emu_prompt(&emu, "cycle: ", line, sizeof(line))==0) {
+                        journal_clear(&journal);
+                        tt_seek(&tt, &m, parse_cycle(line, m.cpu.cycles));
                     }
-                    mem_set_btn(&mem, cpu.button_pressed);
+                    break;
+                case 'c':
+                    // step off a breakpoint at PC, then run in batches 
+                    // checking for a key in between
+                    journal_clear(&journal);
+                    emu_status(&emu, "running, any key stops");
+                    stop = tt_run(&tt, &m, 1, NULL, &watches, &n);
+
+                    nodelay(stdscr, TRUE);
+                    while(stop==MACHINE_STOP_STEPS && getch()==ERR) {
+                        stop = tt_run(&tt, &m, EMU_RUN_BATCH, 
+                            &breaks, &watches, &n);
+                    }
+                    nodelay(stdscr, FALSE);
+
+                    if(stop==MACHINE_STOP_WATCHPOINT)
+                        watch_format(&watches.last, &m.mem, line, sizeof(line));
+                    else
+                        snprintf(line, sizeof(line), "%s at %04x",
+                            stop==MACHINE_STOP_STEPS 
+                                ? "stopped" : MACHINE_STOP_NAMES[stop], m.cpu.PC);
+                    emu_status(&emu, line);
+                    break;
+                case 'w':
+                    if(emu_prompt(&emu, "watch: ", line, sizeof(line))==0) {
+                        if(watch_parse(line, &watch, err, sizeof(err))!=0)
+                            emu_status(&emu, err);
+                        else if(watch_remove(&watches, &m.mem, &watch)==0)
+                            emu_status(&emu, "watchpoint cleared");
+                        else if(watch_add(&watches, &m.mem, &watch)==0)
+                            emu_status(&emu, "watchpoint set");
+                        else
+                            emu_status(&emu, "too many watchpoints");
+                    }
+                    break;
+                case 'p':
+                    // a plain address toggles, a condition adds to it
+                    if(emu_prompt(&emu, "break at: ", line, sizeof(line))!=0)
+                        break;
+
+                    if(bp_parse(line, &addr, &cond, &has_cond, err, sizeof(err))!=0)
+                        emu_status(&emu, err);
+                    else if(has_cond)
+                        emu_status(&emu, bp_set_cond(&breaks, addr, &cond)==0 
+                            ? "breakpoint set" : "too many conditions");
+                    else if(bp_toggle(&breaks, addr))
+                        emu_status(&emu, "breakpoint set");
+                    else
+                        emu_status(&emu, "breakpoint cleared");
+                    break;
+                case 'v':
+                case 'l':
+                    // an empty name is the file saved or loaded last
+                    snprintf(prompt, sizeof(prompt), "%s [%s]: ", 
+                        ch=='v' ? "save to" : "load from", state_file);
+                    if(emu_prompt(&emu, prompt, line, sizeof(line))!=0)
+                        snprintf(line, sizeof(line), "%s", state_file);
+
+                    if(ch=='v' ? sv_save(&m, line)!=0 : sv_load(&m, line)!=0) {
+                        emu_status(&emu, ch=='v' 
+                            ? "cannot save the state" : "cannot load the state");
+                        break;
+                    }
+
+                    if(ch=='l') {
+                        journal_clear(&journal);
+                        tt_start(&tt, &m);
+                    }
+                    emu_status(&emu, ch=='v' ? "state saved" : "state loaded");
+                    snprintf(state, sizeof(state), "%s", line);
+                    state_file = state;
                     break;
                 case 'b':
-                    cpu.button_pressed = !cpu.button_pressed;
-                    mem_set_btn(&mem, cpu.button_pressed);
+                    tt_input(&tt, &m, INPUT_BUTTON, !m.cpu.button_pressed);
                     break;
                 case KEY_RESIZE:
-                    emu_refresh(&emu, &cpu, &mem);
+                    emu_refresh(&emu, &m.cpu, &m.mem);
                     break;
             }   
         }
 
         emu_dispose(&emu);
+
+        // the inputs that led to where the session ended
+        if(run.record_file!=NULL)
+            record_inputs(run.record_file, &tt.input, tt.cursor, NULL);
+
+        tt_dispose(&tt);
+        watch_detach(&watches, &m.mem);
+        journal_detach(&journal, &m.mem);
+        journal_dispose(&journal);
+        machine_dispose(&m);
     }
 
     LOG_CLOSE();
@@ -1,6 +1,26 @@
 #include <mem.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <log.h>
+
+/* backs every page never written, the static reference keeps it shared */
+static struct mem_page_t mem_zero_page = { 1, true, {0} };
+
+/* the zero page is never written nor freed, so it is not counted either */
+static void mem_page_ref(struct mem_page_t* page) {
+    if(page!=&mem_zero_page)
+        page->refs++;
+}
+
+static void mem_page_release(struct mem_page_t* page) {
+    if(page!=&mem_zero_page && --page->refs==0 && !page->pooled)
+        free(page);
+}
+
+static void mem_set_dirty(struct mem* m, int page) {
+    m->dirty[page>>6] |= 1ull<<(page&63);
+}
 
 /*---------------------------------------------------*/
 /* brief: init the memory struct */
@@ -8,6 +28,23 @@
 void mem_init(struct mem* m) {
     memset(m, 0, sizeof(*m));
     m->last_selected = -1;
+
+    // memories on other threads share it without a lock
+    for(int i=0; i<MEM_PAGES; i++) {
+        m->pages[i] = &mem_zero_page;
+    }
+}
+
+/*---------------------------------------------------*/
+/* brief: drop the references to the memory pages */
+/*---------------------------------------*/
+void mem_dispose(struct mem* m) {
+    for(int i=0; i<MEM_PAGES; i++) {
+        if(m->pages[i]!=NULL)
+            mem_page_release(m->pages[i]);
+        m->pages[i] = NULL;
+        m->wpage[i] = NULL;
+    }
 }
 
 /*---------------------------------------------------*/
@@ -22,41 +59,225 @@ int mem_load(struct mem* m, char* filename) {
         return 1;
     }
 
-    int index = 0;
+    int page = MEM_CODE_ADDR/MEM_PAGE_SIZE;
+    uint8_t buf[MEM_PAGE_SIZE];
     int read = 0;
-    while((read = fread(m->data+index+MEM_CODE_ADDR, 1, 128, fp))) {
-        index+=read;
+    while(page<MEM_PAGES && (read = fread(buf, 1, MEM_PAGE_SIZE, fp))) {
+        memcpy(mem_page_own(m, page++), buf, read);
     }
 
+    fclose(fp);
+
     return 0;
 }
 
 /*---------------------------------------------------*/
-/* brief: return the 16 bit data after src */
+/* brief: make dst share every page of src, O(MEM_PAGES) */
+/* dst must be disposed, its hooks are kept */
 /*---------------------------------------*/
-uint16_t mem_get_data_short(struct mem* m, uint16_t src) {
-    uint16_t param = m->data[src];
+void mem_share(struct mem* dst, struct mem* src) {
+    for(int i=0; i<MEM_PAGES; i++) {
+        mem_page_ref(src->pages[i]);
+        dst->pages[i] = src->pages[i];
+
+        // both sides copy on their next store
+        src->wpage[i] = NULL;
+        dst->wpage[i] = NULL;
+    }
+    dst->last_selected = src->last_selected;
 
-    param = param | (m->data[src+1]<<8);
+    // the pages may all differ from the baseline now
+    memset(dst->dirty, 0xff, sizeof(dst->dirty));
+}
 
-    return param;
+/*---------------------------------------------------*/
+/* brief: init dst as a copy-on-write view of src, without hooks */
+/*---------------------------------------*/
+void mem_clone(struct mem* dst, struct mem* src) {
+    memset(dst, 0, sizeof(*dst));
+    mem_share(dst, src);
 }
 
 /*---------------------------------------------------*/
-/* brief: return the 8 bit data after src */
+/* brief: keep in base what m holds now, m starts clean */
+/* base must be disposed, the stores to m mark their pages dirty */
 /*---------------------------------------*/
-uint8_t mem_get_data_byte(struct mem* m, uint16_t src) {
-    return m->data[src];
+void mem_baseline(struct mem* m, struct mem* base) {
+    mem_clone(base, m);
+    memset(m->dirty, 0, sizeof(m->dirty));
 }
 
 /*---------------------------------------------------*/
-/* brief: set the status of the hardware btn */
+/* brief: bring the dirty pages of m back to base */
+/* return the bytes copied, the clean pages are not touched */
 /*---------------------------------------*/
-int mem_set_btn(struct mem* m, bool pressed) {
-    if(pressed && ((m->data[MEM_DDRB] & 1<<4)==0))
-        m->data[MEM_PTB] = m->data[MEM_PTB] | 1<<4;
-    else
-        m->data[MEM_PTB] = m->data[MEM_PTB] & (~(1<<4));
+size_t mem_revert(struct mem* m, struct mem* base) {
+    size_t bytes = 0;
+
+    for(int w=0; w<MEM_PAGES/64; w++) {
+        for(uint64_t bits=m->dirty[w]; bits!=0; bits &= bits-1) {
+            int i = w*64+__builtin_ctzll(bits);
+            struct mem_page_t* page = m->pages[i];
+
+            if(page==base->pages[i])
+                continue;
+
+            // an own page is refilled in place, saving a free and a malloc
+            if(page->refs==1 && !page->pooled && page!=&mem_zero_page) {
+                memcpy(page->data, base->pages[i]->data, MEM_PAGE_SIZE);
+                bytes += MEM_PAGE_SIZE;
+            } else {
+                mem_page_release(page);
+                mem_page_ref(base->pages[i]);
+                m->pages[i] = base->pages[i];
+            }
+
+            // the next store marks the page again
+            m->wpage[i] = NULL;
+        }
+        m->dirty[w] = 0;
+    }
+
+    m->last_selected = -1;
+
+    return bytes;
+}
+
+/*---------------------------------------------------*/
+/* brief: return the page data for writing, copying it if shared */
+/*---------------------------------------*/
+uint8_t* mem_page_own(struct mem* m, int page) {
+    struct mem_page_t* old = m->pages[page];
+
+    mem_set_dirty(m, page);
+
+    if(old->refs>1 || old==&mem_zero_page) {
+        struct mem_page_t* copy = malloc(sizeof(*copy));
+
+        if(copy==NULL) {
+            LOG_ERROR("cannot copy page %02x", page);
+            abort();
+        }
+
+        copy->refs = 1;
+        copy->pooled = false;
+        memcpy(copy->data, old->data, MEM_PAGE_SIZE);
+
+        mem_page_release(old);
+        m->pages[page] = copy;
+    }
+
+    // with hooks installed every store has to take the slow path
+    if(m->n_hooks==0 && !m->watched[page] && !m->device[page])
+        m->wpage[page] = m->pages[page]->data;
+
+    return m->pages[page]->data;
+}
+
+/*---------------------------------------------------*/
+/* brief: back page with a caller owned page, holding a reference */
+/*---------------------------------------*/
+void mem_page_replace(struct mem* m, int page, struct mem_page_t* with) {
+    mem_page_release(m->pages[page]);
+    m->pages[page] = with;
+    m->wpage[page] = NULL;
+    mem_set_dirty(m, page);
+}
+
+/*---------------------------------------------------*/
+/* brief: store that could not go straight to the page */
+/*---------------------------------------*/
+void mem_write_slow(struct mem* m, uint16_t dst, uint8_t val) {
+    uint8_t* page = mem_page_own(m, dst>>8);
+    uint8_t old = page[dst&0xff];
+
+    if(m->watched[dst>>8])
+        m->watch.write(m->watch.ctx, dst, page[dst&0xff], val);
+
+    for(int i=0; i<m->n_hooks; i++) {
+        m->hooks[i].write(m->hooks[i].ctx, dst, page[dst&0xff], val);
+    }
+
+    page[dst&0xff] = val;
+
+    // a device acts on what was stored, its reads see the new value
+    if(m->device[dst>>8])
+        m->write(m->device_ctx, dst, old, val);
+}
+
+/*---------------------------------------------------*/
+/* brief: call write for every store until removed */
+/*---------------------------------------*/
+int mem_add_hook(struct mem* m, mem_write_hook write, void* ctx) {
+    if(m->n_hooks==MEM_MAX_HOOKS)
+        return 1;
+
+    m->hooks[m->n_hooks].write = write;
+    m->hooks[m->n_hooks].ctx = ctx;
+    m->n_hooks++;
+
+    for(int i=0; i<MEM_PAGES; i++) {
+        m->wpage[i] = NULL;
+    }
 
     return 0;
 }
+
+/*---------------------------------------------------*/
+/* brief: stop calling a hook added with mem_add_hook */
+/*---------------------------------------*/
+void mem_remove_hook(struct mem* m, mem_write_hook write, void* ctx) {
+    for(int i=0; i<m->n_hooks; i++) {
+        if(m->hooks[i].write==write && m->hooks[i].ctx==ctx) {
+            m->hooks[i] = m->hooks[--m->n_hooks];
+            break;
+        }
+    }
+}
+
+/*---------------------------------------------------*/
+/* brief: set the hook called by stores to watched pages */
+/*---------------------------------------*/
+void mem_set_watch(struct mem* m, mem_write_hook write, void* ctx) {
+    m->watch.write = write;
+    m->watch.ctx = ctx;
+}
+
+/*---------------------------------------------------*/
+/* brief: send the stores to page to the watch hook, or stop */
+/*---------------------------------------*/
+void mem_watch_page(struct mem* m, int page, bool on) {
+    m->watched[page] = on;
+
+    // the fast path comes back with the next store to the page
+    m->wpage[page] = NULL;
+}
+
+/*---------------------------------------------------*/
+/* brief: answer the reads of page with read and pass its stores to */
+/* write, after they are done, NULL for plain memory */
+/* one pair serves every device page, addr tells them apart */
+/*---------------------------------------*/
+void mem_set_device(
+    struct mem* m, int page, mem_read_hook read, mem_write_hook write, void* ctx)
+{
+    m->device[page] = read!=NULL;
+    m->wpage[page] = NULL;
+
+    if(read!=NULL) {
+        m->read = read;
+        m->write = write;
+        m->device_ctx = ctx;
+    }
+}
+
+/*---------------------------------------------------*/
+/* brief: return the 16 bit data after src */
+/*---------------------------------------*/
+uint16_t mem_get_data_short(struct mem* m, uint16_t src) {
+    uint16_t param = mem_get_data_byte(m, src);
+
+    param = param | (mem_get_data_byte(m, src+1)<<8);
+
+    return param;
+}
@@ -4,11 +4,13 @@
 #include <log.h>
 
 /*---------------------------------------------------*/
-/* brief: init the cpu struct */
+/* brief: init the cpu struct, as after the reset line */
+/* the 65C02 comes out of reset with I set and D clear */
 /*---------------------------------------*/
 void cpu_init(struct processor_t* cpu) {
     memset(cpu, 0, sizeof(*cpu));
     cpu->is_running = true;
+    cpu->ids = 1;
     cpu->PC = MEM_RES;
 }
 
@@ -16,7 +18,66 @@ void cpu_init(struct processor_t* cpu) {
 /* brief: load the address of the program from the resect vector */
 /*----------------------------------------------------------------*/
 void cpu_load_res_addr(struct processor_t* cpu, struct mem* mem) {
-    cpu->PC = mem->data[MEM_RES] | (mem->data[MEM_RES+1]<<8);
+    cpu->PC = mem_get_data_short(mem, MEM_RES);
+}
+
+/*---------------------------------------------------*/
+/* brief: write the state to p, CPU_STATE_SIZE bytes, little endian */
+/* A X Y SP PC:16 P run/button:8 cycles:64 PTA pins PTB pins, */
+/* the same on every build */
+/*---------------------------------------*/
+void cpu_save_state(struct processor_t* cpu, uint8_t* p) {
+    p[0] = cpu->A;
+    p[1] = cpu->X;
+    p[2] = cpu->Y;
+    p[3] = cpu->SP;
+    p[4] = cpu->PC & 0xff;
+    p[5] = cpu->PC>>8;
+    p[6] = cpu->neg<<7 | cpu->over<<6 | 1<<5 | cpu->brk<<4 
+        | cpu->dec<<3 | cpu->ids<<2 | cpu->zero<<1 | cpu->carry;
+    p[7] = cpu->is_running | cpu->button_pressed<<1;
+
+    for(int i=0; i<8; i++) {
+        p[8+i] = cpu->cycles>>(8*i);
+    }
+
+    p[16] = cpu->pins[0];
+    p[17] = cpu->pins[1];
+}
+
+/*---------------------------------------------------*/
+/* brief: read a state written by cpu_save_state */
+/* the coverage map is left as it is */
+/*---------------------------------------*/
+void cpu_load_state(struct processor_t* cpu, const uint8_t* p) {
+    uint8_t* coverage = cpu->coverage;
+
+    memset(cpu, 0, sizeof(*cpu));
+    cpu->coverage = coverage;
+
+    cpu->A = p[0];
+    cpu->X = p[1];
+    cpu->Y = p[2];
+    cpu->SP = p[3];
+    cpu->PC = p[4] | p[5]<<8;
+
+    cpu->neg = p[6]>>7 & 1;
+    cpu->over = p[6]>>6 & 1;
+    cpu->brk = p[6]>>4 & 1;
+    cpu->dec = p[6]>>3 & 1;
+    cpu->ids = p[6]>>2 & 1;
+    cpu->zero = p[6]>>1 & 1;
+    cpu->carry = p[6] & 1;
+
+    cpu->is_running = p[7] & 1;
+    cpu->button_pressed = p[7]>>1 & 1;
+
+    for(int i=0; i<8; i++) {
+        cpu->cycles |= (uint64_t)p[8+i]<<(8*i);
+    }
+
+    cpu->pins[0] = p[16];
+    cpu->pins[1] = p[17];
 }
 
 /*---------------------------------------------------*/
@@ -626,6 +687,32 @@ const char* cpu_get_op_name(enum opcode_e op) {
     return NULL;
 }
 
+/*---------------------------------------------------*/
+/* brief: true if the instruction loads from its effective address */
+/*---------------------------------------*/
+bool cpu_op_reads_ea(enum opcode_e op) {
+    const char* name = cpu_get_op_name(op);
+
+    if(name==NULL || strncmp(name, "ST", 2)==0)
+        return false;
+
+    switch(cpu_get_op_type(op)) {
+        case OP_ABS:
+            return op!=JMP_ABS && op!=JSR_ABS;
+        case OP_ABS_X:
+        case OP_ABS_Y:
+        case OP_IND:
+        case OP_X_IND:
+        case OP_IND_Y:
+        case OP_ZPG:
+        case OP_ZPG_X:
+        case OP_ZPG_Y:
+            return true;
+        default:
+            return false;
+    }
+}
+
 /*---------------------------------------------------*/
 /* brief: return the next op code */
 /*---------------------------------------*/
@@ -637,7 +724,7 @@ uint8_t cpu_fetch(struct processor_t* cpu, struct mem* m) {
 /* brief: return the next operand byte */
 /*---------------------------------------*/
 uint8_t cpu_get_operand_byte(struct processor_t* cpu, struct mem* m) {
-    return m->data[cpu->PC++];
+    return mem_fetch_byte(m, cpu->PC++);
 }
 
 /*---------------------------------------------------*/
@@ -727,6 +814,18 @@ uint16_t cpu_get_address_abs_y(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------------------*/
 /* operation handlers */
 
+/*---------------------------------------------------*/
+/* brief: count the edge from the instruction ending at from to to */
+/*---------------------------------------*/
+static inline void cpu_cover(struct processor_t* cpu, uint16_t from, uint16_t to) {
+    if(cpu->coverage!=NULL) {
+        uint8_t* hits = &cpu->coverage[(uint16_t)(from>>1 ^ to)];
+
+        // saturate, a loop running 256 times is not one running none
+        *hits += *hits!=0xff;
+    }
+}
+
 /*---------------------------------------------------*/
 /* brief: handle unsupported operation */
 /*---------------------------------------*/
@@ -767,7 +866,7 @@ static void cpu_handle_adc_abs(struct processor_t* cpu, struct mem* mem) {
 
     uint8_t tmp = cpu->A;
 
-    cpu->A += mem->data[address] + cpu->carry;
+    cpu->A += mem_get_data_byte(mem, address) + cpu->carry;
 
     cpu->carry = cpu->A<tmp;
     cpu->zero = cpu->A==0;
@@ -788,7 +887,7 @@ static void cpu_handle_adc_zpg(struct processor_t* cpu, struct mem* mem) {
 
     uint8_t tmp = cpu->A;
 
-    cpu->A += mem->data[address] + cpu->carry;
+    cpu->A += mem_get_data_byte(mem, address) + cpu->carry;
 
     cpu->carry = cpu->A<tmp;
     cpu->zero = cpu->A==0;
@@ -809,7 +908,7 @@ static void cpu_handle_adc_ind_x(struct processor_t* cpu, struct mem* mem) {
 
     uint8_t tmp = cpu->A;
 
-    cpu->A += mem->data[address];
+    cpu->A += mem_get_data_byte(mem, address);
 
     cpu->carry = cpu->A<tmp;
     cpu->zero = cpu->A==0;
@@ -829,7 +928,7 @@ static void cpu_handle_adc_ind_y(struct processor_t* cpu, struct mem* mem) {
 
     uint8_t tmp = cpu->A;
 
-    cpu->A += mem->data[address];
+    cpu->A += mem_get_data_byte(mem, address);
 
     cpu->carry = cpu->A<tmp;
     cpu->zero = cpu->A==0;
@@ -850,7 +949,7 @@ static void cpu_handle_adc_zpg_x(struct processor_t* cpu, struct mem* mem) {
 
     uint8_t tmp = cpu->A;
 
-    cpu->A += mem->data[address] + cpu->carry;
+    cpu->A += mem_get_data_byte(mem, address) + cpu->carry;
 
     cpu->carry = cpu->A<tmp;
     cpu->zero = cpu->A==0;
@@ -871,7 +970,7 @@ static void cpu_handle_adc_abs_x(struct processor_t* cpu, struct mem* mem) {
 
     uint8_t tmp = cpu->A;
 
-    cpu->A += mem->data[address] + cpu->carry;
+    cpu->A += mem_get_data_byte(mem, address) + cpu->carry;
 
     cpu->carry = cpu->A<tmp;
     cpu->zero = cpu->A==0;
@@ -892,7 +991,7 @@ static void cpu_handle_adc_abs_y(struct processor_t* cpu, struct mem* mem) {
 
     uint8_t tmp = cpu->A;
 
-    cpu->A += mem->data[address] + cpu->carry;
+    cpu->A += mem_get_data_byte(mem, address) + cpu->carry;
 
     cpu->carry = cpu->A<tmp;
     cpu->zero = cpu->A==0;
@@ -931,7 +1030,7 @@ static void cpu_handle_and_imm(struct processor_t* cpu, struct mem* mem) {
 static void cpu_handle_and_abs(struct processor_t* cpu, struct mem* mem) {
     uint16_t address;
     address = cpu_get_operand_short(cpu, mem);
-    cpu->A = cpu->A & mem->data[address];
+    cpu->A = cpu->A & mem_get_data_byte(mem, address);
 
     cpu->zero = cpu->A==0;
     cpu->neg = cpu->A>>7;
@@ -948,7 +1047,7 @@ static void cpu_handle_and_abs(struct processor_t* cpu, struct mem* mem) {
 static void cpu_handle_and_zpg(struct processor_t* cpu, struct mem* mem) {
     uint8_t address;
     address = cpu_get_address_zpg(cpu, mem);
-    cpu->A = cpu->A & mem->data[address];
+    cpu->A = cpu->A & mem_get_data_byte(mem, address);
 
     cpu->zero = cpu->A==0;
     cpu->neg = cpu->A>>7;
@@ -965,7 +1064,7 @@ static void cpu_handle_and_zpg(struct processor_t* cpu, struct mem* mem) {
 static void cpu_handle_and_ind_x(struct processor_t* cpu, struct mem* mem) {
     uint16_t address = cpu_get_address_ind_x(cpu, mem);
 
-    cpu->A = cpu->A & mem->data[address];
+    cpu->A = cpu->A & mem_get_data_byte(mem, address);
 
     cpu->zero = cpu->A==0;
     cpu->neg = cpu->A>>7;
@@ -982,7 +1081,7 @@ static void cpu_handle_and_ind_x(struct processor_t* cpu, struct mem* mem) {
 static void cpu_handle_and_ind_y(struct processor_t* cpu, struct mem* mem) {
     uint16_t address = cpu_get_address_ind_y(cpu, mem);
 
-    cpu->A = cpu->A & mem->data[address];
+    cpu->A = cpu->A & mem_get_data_byte(mem, address);
 
     cpu->zero = cpu->A==0;
     cpu->neg = cpu->A>>7;
@@ -999,7 +1098,7 @@ static void cpu_handle_and_ind_y(struct processor_t* cpu, struct mem* mem) {
 static void cpu_handle_and_zpg_x(struct processor_t* cpu, struct mem* mem) {
     uint8_t address = cpu_get_address_zpg_x(cpu, mem);
 
-    cpu->A = cpu->A & mem->data[address];
+    cpu->A = cpu->A & mem_get_data_byte(mem, address);
 
     cpu->zero = cpu->A==0;
     cpu->neg = cpu->A>>7;
@@ -1016,7 +1115,7 @@ static void cpu_handle_and_zpg_x(struct processor_t* cpu, struct mem* mem) {
 static void cpu_handle_and_abs_x(struct processor_t* cpu, struct mem* mem) {
     uint16_t address = cpu_get_address_abs_x(cpu, mem);
 
-    cpu->A = cpu->A & mem->data[address];
+    cpu->A = cpu->A & mem_get_data_byte(mem, address);
 
     cpu->zero = cpu->A==0;
     cpu->neg = cpu->A>>7;
@@ -1033,7 +1132,7 @@ static void cpu_handle_and_abs_x(struct processor_t* cpu, struct mem* mem) {
 static void cpu_handle_and_abs_y(struct processor_t* cpu, struct mem* mem) {
     uint16_t address = cpu_get_address_abs_y(cpu, mem);
 
-    cpu->A = cpu->A & mem->data[address];
+    cpu->A = cpu->A & mem_get_data_byte(mem, address);
 
     cpu->zero = cpu->A==0;
     cpu->neg = cpu->A>>7;
@@ -1072,12 +1171,15 @@ static void cpu_handle_asl_zpg(struct processor_t* cpu, struct mem* mem) {
 
     uint8_t address = cpu_get_address_zpg(cpu, mem);
 
-    cpu->carry = mem->data[address]>>7;
+    uint8_t value = mem_get_data_byte(mem, address);
 
-    mem->data[address] = mem->data[address] << 1;
+    cpu->carry = value>>7;
 
-    cpu->zero = mem->data[address]==0;
-    cpu->neg = mem->data[address]>>7;
+    value = value << 1;
+    mem_set_data_byte(mem, address, value);
+
+    cpu->zero = value==0;
+    cpu->neg = value>>7;
 
     cpu->A_st = true;
     cpu->zero_st = true;
@@ -1092,12 +1194,15 @@ static void cpu_handle_asl_zpg_x(struct processor_t* cpu, struct mem* mem) {
 
     uint8_t address = cpu_get_address_zpg_x(cpu, mem);
 
-    cpu->carry = mem->data[address]>>7;
+    uint8_t value = mem_get_data_byte(mem, address);
+
+    cpu->carry = value>>7;
 
-    mem->data[address] = mem->data[address] << 1;
+    value = value << 1;
+    mem_set_data_byte(mem, address, value);
 
-    cpu->zero = mem->data[address]==0;
-    cpu->neg = mem->data[address]>>7;
+    cpu->zero = value==0;
+    cpu->neg = value>>7;
 
     cpu->A_st = true;
     cpu->zero_st = true;
@@ -1112,12 +1217,15 @@ static void cpu_handle_asl_abs(struct processor_t* cpu, struct mem* mem) {
 
     uint16_t address = cpu_get_operand_short(cpu, mem);
 
-    cpu->carry = mem->data[address]>>7;
+    uint8_t value = mem_get_data_byte(mem, address);
 
-    mem->data[address] = mem->data[address] << 1;
+    cpu->carry = value>>7;
 
-    cpu->zero = mem->data[address]==0;
-    cpu->neg = mem->data[address]>>7;
+    value = value << 1;
+    mem_set_data_byte(mem, address, value);
+
+    cpu->zero = value==0;
+    cpu->neg = value>>7;
 
     cpu->A_st = true;
     cpu->zero_st = true;
@@ -1132,12 +1240,15 @@ static void cpu_handle_asl_abs_x(struct processor_t* cpu, struct mem* mem) {
 
     uint16_t address = cpu_get_address_abs_x(cpu, mem);
 
-    cpu->carry = mem->data[address]>>7;
+    uint8_t value = mem_get_data_byte(mem, address);
+
+    cpu->carry = value>>7;
 
-    mem->data[address] = mem->data[address] << 1;
+    value = value << 1;
+    mem_set_data_byte(mem, address, value);
 
-    cpu->zero = mem->data[address]==0;
-    cpu->neg = mem->data[address]>>7;
+    cpu->zero = value==0;
+    cpu->neg = value>>7;
 
     cpu->A_st = true;
     cpu->zero_st = true;
@@ -1154,10 +1265,13 @@ static void cpu_handle_asl_abs_x(struct processor_t* cpu, struct mem* mem) {
 static void cpu_handle_bcc_rel(struct processor_t* cpu, struct mem* mem) {
 
     int8_t oper = cpu_get_operand_byte(cpu, mem);
+    uint16_t from = cpu->PC;
 
     if(!cpu->carry) {
         cpu->PC += oper;
     }
+
+    cpu_cover(cpu, from, cpu->PC);
 }
 
 /*---------------------------------------------------*/
@@ -1169,10 +1283,13 @@ static void cpu_handle_bcc_rel(struct processor_t* cpu, struct mem* mem) {
 static void cpu_handle_bcs_rel(struct processor_t* cpu, struct mem* mem) {
 
     int8_t oper = cpu_get_operand_byte(cpu, mem);
+    uint16_t from = cpu->PC;
 
     if(cpu->carry) {
         cpu->PC += oper;
     }
+
+    cpu_cover(cpu, from, cpu->PC);
 }
 
 /*---------------------------------------------------*/
@@ -1184,10 +1301,13 @@ static void cpu_handle_bcs_rel(struct processor_t* cpu, struct mem* mem) {
 static void cpu_handle_beq_rel(struct processor_t* cpu, struct mem* mem) {
 
     int8_t oper = cpu_get_operand_byte(cpu, mem);
+    uint16_t from = cpu->PC;
 
     if(cpu->zero) {
         cpu->PC += oper;
     }
+
+    cpu_cover(cpu, from, cpu->PC);
 }
 
 /*---------------------------------------------------*/
@@ -1199,10 +1319,13 @@ static void cpu_handle_beq_rel(struct processor_t* cpu, struct mem* mem) {
 static void cpu_handle_bmi_rel(struct processor_t* cpu, struct mem* mem) {
 
     int8_t oper = cpu_get_operand_byte(cpu, mem);
+    uint16_t from = cpu->PC;
 
     if(cpu->neg) {
         cpu->PC += oper;
     }
+
+    cpu_cover(cpu, from, cpu->PC);
 }
 
 /*---------------------------------------------------*/
@@ -1214,10 +1337,13 @@ static void cpu_handle_bmi_rel(struct processor_t* cpu, struct mem* mem) {
 static void cpu_handle_bne_rel(struct processor_t* cpu, struct mem* mem) {
 
     int8_t oper = cpu_get_operand_byte(cpu, mem);
+    uint16_t from = cpu->PC;
 
     if(!cpu->zero) {
         cpu->PC += oper;
     }
+
+    cpu_cover(cpu, from, cpu->PC);
 }
 
 /*---------------------------------------------------*/
@@ -1229,10 +1355,13 @@ static void cpu_handle_bne_rel(struct processor_t* cpu, struct mem* mem) {
 static void cpu_handle_bpl_rel(struct processor_t* cpu, struct mem* mem) {
 
     int8_t oper = cpu_get_operand_byte(cpu, mem);
+    uint16_t from = cpu->PC;
 
     if(!cpu->neg) {
         cpu->PC += oper;
     }
+
+    cpu_cover(cpu, from, cpu->PC);
 }
 
 /*---------------------------------------------------*/
@@ -1244,10 +1373,13 @@ static void cpu_handle_bpl_rel(struct processor_t* cpu, struct mem* mem) {
 static void cpu_handle_bvc_rel(struct processor_t* cpu, struct mem* mem) {
 
     int8_t oper = cpu_get_operand_byte(cpu, mem);
+    uint16_t from = cpu->PC;
 
     if(!cpu->over) {
         cpu->PC += oper;
     }
+
+    cpu_cover(cpu, from, cpu->PC);
 }
 
 /*---------------------------------------------------*/
@@ -1259,10 +1391,13 @@ static void cpu_handle_bvc_rel(struct processor_t* cpu, struct mem* mem) {
 static void cpu_handle_bvs_rel(struct processor_t* cpu, struct mem* mem) {
 
     int8_t oper = cpu_get_operand_byte(cpu, mem);
+    uint16_t from = cpu->PC;
 
     if(cpu->over) {
         cpu->PC += oper;
     }
+
+    cpu_cover(cpu, from, cpu->PC);
 }
 
 /*---------------------------------------------------*/
@@ -1333,7 +1468,7 @@ static void cpu_handle_cmp_imm(struct processor_t* cpu, struct mem* mem) {
 static void cpu_handle_cmp_zpg(struct processor_t* cpu, struct mem* mem) {
     uint8_t oper;
     oper = cpu_get_address_zpg(cpu, mem);
-    oper = mem->data[oper];
+    oper = mem_get_data_byte(mem, oper);
 
     cpu->carry = cpu->A>=oper;
     
@@ -1353,7 +1488,7 @@ static void cpu_handle_cmp_zpg(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_cmp_zpg_x(struct processor_t* cpu, struct mem* mem) {
     uint8_t oper = cpu_get_address_zpg_x(cpu, mem);
-    oper = mem->data[oper];
+    oper = mem_get_data_byte(mem, oper);
 
     cpu->carry = cpu->A>=oper;
     
@@ -1373,7 +1508,7 @@ static void cpu_handle_cmp_zpg_x(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_cmp_abs(struct processor_t* cpu, struct mem* mem) {
     uint16_t oper = cpu_get_operand_short(cpu, mem);
-    oper = mem->data[oper];
+    oper = mem_get_data_byte(mem, oper);
 
     cpu->carry = cpu->A>=oper;
     
@@ -1393,7 +1528,7 @@ static void cpu_handle_cmp_abs(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_cmp_abs_x(struct processor_t* cpu, struct mem* mem) {
     uint16_t oper = cpu_get_address_abs_x(cpu, mem);
-    oper = mem->data[oper];
+    oper = mem_get_data_byte(mem, oper);
 
     cpu->carry = cpu->A>=oper;
     
@@ -1413,7 +1548,7 @@ static void cpu_handle_cmp_abs_x(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_cmp_abs_y(struct processor_t* cpu, struct mem* mem) {
     uint16_t oper = cpu_get_address_abs_y(cpu, mem);
-    oper = mem->data[oper];
+    oper = mem_get_data_byte(mem, oper);
 
     cpu->carry = cpu->A>=oper;
     
@@ -1433,7 +1568,7 @@ static void cpu_handle_cmp_abs_y(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_cmp_ind_x(struct processor_t* cpu, struct mem* mem) {
     uint16_t oper = cpu_get_address_ind_x(cpu, mem);
-    oper = mem->data[oper];
+    oper = mem_get_data_byte(mem, oper);
 
     cpu->carry = cpu->A>=oper;
     
@@ -1453,7 +1588,7 @@ static void cpu_handle_cmp_ind_x(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_cmp_ind_y(struct processor_t* cpu, struct mem* mem) {
     uint16_t oper = cpu_get_address_ind_y(cpu, mem);
-    oper = mem->data[oper];
+    oper = mem_get_data_byte(mem, oper);
 
     cpu->carry = cpu->A>=oper;
     
@@ -1496,7 +1631,7 @@ static void cpu_handle_cpx_imm(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_cpx_zpg(struct processor_t* cpu, struct mem* mem) {
     uint8_t oper = cpu_get_address_zpg(cpu, mem);
-    oper = mem->data[oper];
+    oper = mem_get_data_byte(mem, oper);
 
     cpu->carry = cpu->X>=oper;
     
@@ -1516,7 +1651,7 @@ static void cpu_handle_cpx_zpg(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_cpx_abs(struct processor_t* cpu, struct mem* mem) {
     uint16_t oper = cpu_get_operand_short(cpu, mem);
-    oper = mem->data[oper];
+    oper = mem_get_data_byte(mem, oper);
 
     cpu->carry = cpu->X>=oper;
     
@@ -1559,7 +1694,7 @@ static void cpu_handle_cpy_imm(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_cpy_zpg(struct processor_t* cpu, struct mem* mem) {
     uint8_t oper = cpu_get_address_zpg(cpu, mem);
-    oper = mem->data[oper];
+    oper = mem_get_data_byte(mem, oper);
 
     cpu->carry = cpu->Y>=oper;
     
@@ -1579,7 +1714,7 @@ static void cpu_handle_cpy_zpg(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_cpy_abs(struct processor_t* cpu, struct mem* mem) {
     uint16_t oper = cpu_get_operand_short(cpu, mem);
-    oper = mem->data[oper];
+    oper = mem_get_data_byte(mem, oper);
 
     cpu->carry = cpu->Y>=oper;
     
@@ -1602,10 +1737,11 @@ static void cpu_handle_cpy_abs(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_dec_zpg(struct processor_t* cpu, struct mem* mem) {
     uint8_t address = cpu_get_address_zpg(cpu, mem);
-    mem->data[address]--;
+    uint8_t value = mem_get_data_byte(mem, address)-1;
+    mem_set_data_byte(mem, address, value);
 
-    cpu->zero = mem->data[address]==0;
-    cpu->neg = mem->data[address]>>7;
+    cpu->zero = value==0;
+    cpu->neg = value>>7;
 
     cpu->zero_st = true;
     cpu->neg_st = true;
@@ -1617,10 +1753,11 @@ static void cpu_handle_dec_zpg(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_dec_zpg_x(struct processor_t* cpu, struct mem* mem) {
     uint8_t address = cpu_get_address_zpg_x(cpu, mem);
-    mem->data[address]--;
+    uint8_t value = mem_get_data_byte(mem, address)-1;
+    mem_set_data_byte(mem, address, value);
 
-    cpu->zero = mem->data[address]==0;
-    cpu->neg = mem->data[address]>>7;
+    cpu->zero = value==0;
+    cpu->neg = value>>7;
 
     cpu->zero_st = true;
     cpu->neg_st = true;
@@ -1632,10 +1769,11 @@ static void cpu_handle_dec_zpg_x(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_dec_abs(struct processor_t* cpu, struct mem* mem) {
     uint16_t address = cpu_get_operand_short(cpu, mem);
-    mem->data[address]--;
+    uint8_t value = mem_get_data_byte(mem, address)-1;
+    mem_set_data_byte(mem, address, value);
 
-    cpu->zero = mem->data[address]==0;
-    cpu->neg = mem->data[address]>>7;
+    cpu->zero = value==0;
+    cpu->neg = value>>7;
 
     cpu->zero_st = true;
     cpu->neg_st = true;
@@ -1647,10 +1785,11 @@ static void cpu_handle_dec_abs(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_dec_abs_x(struct processor_t* cpu, struct mem* mem) {
     uint16_t address = cpu_get_address_abs_x(cpu, mem);
-    mem->data[address]--;
+    uint8_t value = mem_get_data_byte(mem, address)-1;
+    mem_set_data_byte(mem, address, value);
 
-    cpu->zero = mem->data[address]==0;
-    cpu->neg = mem->data[address]>>7;
+    cpu->zero = value==0;
+    cpu->neg = value>>7;
 
     cpu->zero_st = true;
     cpu->neg_st = true;
@@ -1717,7 +1856,7 @@ static void cpu_handle_eor_imm(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_eor_zpg(struct processor_t* cpu, struct mem* mem) {
     uint8_t oper = cpu_get_address_zpg(cpu, mem);
-    oper = mem->data[oper];
+    oper = mem_get_data_byte(mem, oper);
 
     cpu->A = cpu->A ^ oper;
 
@@ -1735,7 +1874,7 @@ static void cpu_handle_eor_zpg(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_eor_zpg_x(struct processor_t* cpu, struct mem* mem) {
     uint8_t oper = cpu_get_address_zpg_x(cpu, mem);
-    oper = mem->data[oper];
+    oper = mem_get_data_byte(mem, oper);
     
     cpu->A = cpu->A ^ oper;
 
@@ -1753,7 +1892,7 @@ static void cpu_handle_eor_zpg_x(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_eor_abs(struct processor_t* cpu, struct mem* mem) {
     uint16_t oper = cpu_get_operand_short(cpu, mem);
-    oper = mem->data[oper];
+    oper = mem_get_data_byte(mem, oper);
     
     cpu->A = cpu->A ^ oper;
 
@@ -1771,7 +1910,7 @@ static void cpu_handle_eor_abs(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_eor_abs_x(struct processor_t* cpu, struct mem* mem) {
     uint16_t oper = cpu_get_address_abs_x(cpu, mem);
-    oper = mem->data[oper];
+    oper = mem_get_data_byte(mem, oper);
     
     cpu->A = cpu->A ^ oper;
 
@@ -1789,7 +1928,7 @@ static void cpu_handle_eor_abs_x(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_eor_abs_y(struct processor_t* cpu, struct mem* mem) {
     uint16_t oper = cpu_get_address_abs_y(cpu, mem);
-    oper = mem->data[oper];
+    oper = mem_get_data_byte(mem, oper);
     
     cpu->A = cpu->A ^ oper;
 
@@ -1807,7 +1946,7 @@ static void cpu_handle_eor_abs_y(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_eor_ind_x(struct processor_t* cpu, struct mem* mem) {
     uint16_t oper = cpu_get_address_ind_x(cpu, mem);
-    oper = mem->data[oper];
+    oper = mem_get_data_byte(mem, oper);
     
     cpu->A = cpu->A ^ oper;
 
@@ -1825,7 +1964,7 @@ static void cpu_handle_eor_ind_x(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_eor_ind_y(struct processor_t* cpu, struct mem* mem) {
     uint16_t oper = cpu_get_address_ind_y(cpu, mem);
-    oper = mem->data[oper];
+    oper = mem_get_data_byte(mem, oper);
     
     cpu->A = cpu->A ^ oper;
 
@@ -1846,10 +1985,11 @@ static void cpu_handle_eor_ind_y(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_inc_zpg(struct processor_t* cpu, struct mem* mem) {
     uint8_t address = cpu_get_address_zpg(cpu, mem);
-    mem->data[address]++;
+    uint8_t value = mem_get_data_byte(mem, address)+1;
+    mem_set_data_byte(mem, address, value);
 
-    cpu->zero = mem->data[address]==0;
-    cpu->neg = mem->data[address]>>7;
+    cpu->zero = value==0;
+    cpu->neg = value>>7;
 
     cpu->zero_st = true;
     cpu->neg_st = true;
@@ -1860,10 +2000,11 @@ static void cpu_handle_inc_zpg(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_inc_zpg_x(struct processor_t* cpu, struct mem* mem) {
     uint8_t address = cpu_get_address_zpg_x(cpu, mem);
-    mem->data[address]++;
+    uint8_t value = mem_get_data_byte(mem, address)+1;
+    mem_set_data_byte(mem, address, value);
 
-    cpu->zero = mem->data[address]==0;
-    cpu->neg = mem->data[address]>>7;
+    cpu->zero = value==0;
+    cpu->neg = value>>7;
 
     cpu->zero_st = true;
     cpu->neg_st = true;
@@ -1874,10 +2015,11 @@ static void cpu_handle_inc_zpg_x(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_inc_abs(struct processor_t* cpu, struct mem* mem) {
     uint16_t address = cpu_get_operand_short(cpu, mem);
-    mem->data[address]++;
+    uint8_t value = mem_get_data_byte(mem, address)+1;
+    mem_set_data_byte(mem, address, value);
 
-    cpu->zero = mem->data[address]==0;
-    cpu->neg = mem->data[address]>>7;
+    cpu->zero = value==0;
+    cpu->neg = value>>7;
 
     cpu->zero_st = true;
     cpu->neg_st = true;
@@ -1889,10 +2031,11 @@ static void cpu_handle_inc_abs(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_inc_abs_x(struct processor_t* cpu, struct mem* mem) {
     uint16_t address = cpu_get_address_abs_x(cpu, mem);
-    mem->data[address]++;
+    uint8_t value = mem_get_data_byte(mem, address)+1;
+    mem_set_data_byte(mem, address, value);
 
-    cpu->zero = mem->data[address]==0;
-    cpu->neg = mem->data[address]>>7;
+    cpu->zero = value==0;
+    cpu->neg = value>>7;
 
     cpu->zero_st = true;
     cpu->neg_st = true;
@@ -1945,6 +2088,7 @@ static void cpu_handle_iny_imp(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_jmp_abs(struct processor_t* cpu, struct mem* mem) {
     uint16_t address = cpu_get_operand_short(cpu, mem);
+    cpu_cover(cpu, cpu->PC, address);
     cpu->PC = address;
     mem->last_selected = -1;
 }
@@ -1954,6 +2098,7 @@ static void cpu_handle_jmp_abs(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_jmp_ind(struct processor_t* cpu, struct mem* mem) {
     int8_t address = cpu_get_operand_byte(cpu, mem);
+    cpu_cover(cpu, cpu->PC, cpu->PC+address);
     cpu->PC += address;
 }
 
@@ -1966,9 +2111,10 @@ static void cpu_handle_jmp_ind(struct processor_t* cpu, struct mem* mem) {
 static void cpu_handle_jsr_abs(struct processor_t* cpu, struct mem* mem) {
     uint16_t address = cpu_get_operand_short(cpu, mem);
 
-    mem->data[cpu->SP--] = cpu->PC & 0xff;
-    mem->data[cpu->SP--] = cpu->PC>>8;
+    mem_set_data_byte(mem, cpu->SP--, cpu->PC & 0xff);
+    mem_set_data_byte(mem, cpu->SP--, cpu->PC>>8);
 
+    cpu_cover(cpu, cpu->PC, address);
     cpu->PC = address;
 
     cpu->PC_st = true;
@@ -2001,7 +2147,7 @@ static void cpu_handle_lda_imm(struct processor_t* cpu, struct mem* mem) {
 static void cpu_handle_lda_abs(struct processor_t* cpu, struct mem* mem) {
     uint16_t address;
     address = cpu_get_operand_short(cpu, mem);
-    cpu->A = mem->data[address];
+    cpu->A = mem_get_data_byte(mem, address);
 
     cpu->zero = cpu->A==0;
     cpu->neg = cpu->A>>7;
@@ -2017,7 +2163,7 @@ static void cpu_handle_lda_abs(struct processor_t* cpu, struct mem* mem) {
 static void cpu_handle_lda_zpg(struct processor_t* cpu, struct mem* mem) {
     uint8_t address;
     address = cpu_get_address_zpg(cpu, mem);
-    cpu->A = mem->data[address];
+    cpu->A = mem_get_data_byte(mem, address);
     
     cpu->zero = cpu->A==0;
     cpu->neg = cpu->A>>7;
@@ -2033,7 +2179,7 @@ static void cpu_handle_lda_zpg(struct processor_t* cpu, struct mem* mem) {
 static void cpu_handle_lda_ind_x(struct processor_t* cpu, struct mem* mem) {
     uint16_t oper = cpu_get_address_ind_x(cpu, mem);
 
-    cpu->A = mem->data[oper];
+    cpu->A = mem_get_data_byte(mem, oper);
     
     cpu->zero = cpu->A==0;
     cpu->neg = cpu->A>>7;
@@ -2050,7 +2196,7 @@ static void cpu_handle_lda_ind_x(struct processor_t* cpu, struct mem* mem) {
 static void cpu_handle_lda_ind_y(struct processor_t* cpu, struct mem* mem) {
     uint16_t oper = cpu_get_address_ind_y(cpu, mem);
 
-    cpu->A = mem->data[oper];
+    cpu->A = mem_get_data_byte(mem, oper);
     
     cpu->zero = cpu->A==0;
     cpu->neg = cpu->A>>7;
@@ -2067,7 +2213,7 @@ static void cpu_handle_lda_ind_y(struct processor_t* cpu, struct mem* mem) {
 static void cpu_handle_lda_zpg_x(struct processor_t* cpu, struct mem* mem) {
     uint8_t oper = cpu_get_address_zpg_x(cpu, mem);
 
-    cpu->A = mem->data[oper];
+    cpu->A = mem_get_data_byte(mem, oper);
     
     cpu->zero = cpu->A==0;
     cpu->neg = cpu->A>>7;
@@ -2084,7 +2230,7 @@ static void cpu_handle_lda_zpg_x(struct processor_t* cpu, struct mem* mem) {
 static void cpu_handle_lda_abs_x(struct processor_t* cpu, struct mem* mem) {
     uint16_t oper = cpu_get_address_abs_x(cpu, mem);
 
-    cpu->A = mem->data[oper];
+    cpu->A = mem_get_data_byte(mem, oper);
     
     cpu->zero = cpu->A==0;
     cpu->neg = cpu->A>>7;
@@ -2101,7 +2247,7 @@ static void cpu_handle_lda_abs_x(struct processor_t* cpu, struct mem* mem) {
 static void cpu_handle_lda_abs_y(struct processor_t* cpu, struct mem* mem) {
     uint16_t oper = cpu_get_address_abs_y(cpu, mem);
 
-    cpu->A = mem->data[oper];
+    cpu->A = mem_get_data_byte(mem, oper);
     
     cpu->zero = cpu->A==0;
     cpu->neg = cpu->A>>7;
@@ -2136,7 +2282,7 @@ static void cpu_handle_ldx_imm(struct processor_t* cpu, struct mem* mem) {
 static void cpu_handle_ldx_zpg(struct processor_t* cpu, struct mem* mem) {
     uint16_t address = cpu_get_address_zpg(cpu, mem);
 
-    cpu->X = mem->data[address];
+    cpu->X = mem_get_data_byte(mem, address);
 
     cpu->zero = cpu->X==0;
     cpu->neg = cpu->X>>7;
@@ -2153,7 +2299,7 @@ static void cpu_handle_ldx_zpg(struct processor_t* cpu, struct mem* mem) {
 static void cpu_handle_ldx_zpg_y(struct processor_t* cpu, struct mem* mem) {
     uint16_t address = cpu_get_address_zpg_y(cpu, mem);
 
-    cpu->X = mem->data[address];
+    cpu->X = mem_get_data_byte(mem, address);
 
     cpu->zero = cpu->X==0;
     cpu->neg = cpu->X>>7;
@@ -2170,7 +2316,7 @@ static void cpu_handle_ldx_zpg_y(struct processor_t* cpu, struct mem* mem) {
 static void cpu_handle_ldx_abs(struct processor_t* cpu, struct mem* mem) {
     uint16_t address = cpu_get_operand_short(cpu, mem);
 
-    cpu->X = mem->data[address];
+    cpu->X = mem_get_data_byte(mem, address);
 
     cpu->zero = cpu->X==0;
     cpu->neg = cpu->X>>7;
@@ -2187,7 +2333,7 @@ static void cpu_handle_ldx_abs(struct processor_t* cpu, struct mem* mem) {
 static void cpu_handle_ldx_abs_y(struct processor_t* cpu, struct mem* mem) {
     uint16_t address = cpu_get_address_abs_y(cpu, mem);
 
-    cpu->X = mem->data[address];
+    cpu->X = mem_get_data_byte(mem, address);
 
     cpu->zero = cpu->X==0;
     cpu->neg = cpu->X>>7;
@@ -2222,7 +2368,7 @@ static void cpu_handle_ldy_imm(struct processor_t* cpu, struct mem* mem) {
 static void cpu_handle_ldy_zpg(struct processor_t* cpu, struct mem* mem) {
     uint16_t address = cpu_get_address_zpg(cpu, mem);
 
-    cpu->Y = mem->data[address];
+    cpu->Y = mem_get_data_byte(mem, address);
 
     cpu->zero = cpu->Y==0;
     cpu->neg = cpu->Y>>7;
@@ -2239,7 +2385,7 @@ static void cpu_handle_ldy_zpg(struct processor_t* cpu, struct mem* mem) {
 static void cpu_handle_ldy_zpg_x(struct processor_t* cpu, struct mem* mem) {
     uint16_t address = cpu_get_address_zpg_x(cpu, mem);
 
-    cpu->Y = mem->data[address];
+    cpu->Y = mem_get_data_byte(mem, address);
 
     cpu->zero = cpu->Y==0;
     cpu->neg = cpu->Y>>7;
@@ -2256,7 +2402,7 @@ static void cpu_handle_ldy_zpg_x(struct processor_t* cpu, struct mem* mem) {
 static void cpu_handle_ldy_abs(struct processor_t* cpu, struct mem* mem) {
     uint16_t address = cpu_get_operand_short(cpu, mem);
 
-    cpu->Y = mem->data[address];
+    cpu->Y = mem_get_data_byte(mem, address);
 
     cpu->zero = cpu->Y==0;
     cpu->neg = cpu->Y>>7;
@@ -2273,7 +2419,7 @@ static void cpu_handle_ldy_abs(struct processor_t* cpu, struct mem* mem) {
 static void cpu_handle_ldy_abs_x(struct processor_t* cpu, struct mem* mem) {
     uint16_t address = cpu_get_address_abs_x(cpu, mem);
 
-    cpu->Y = mem->data[address];
+    cpu->Y = mem_get_data_byte(mem, address);
 
     cpu->zero = cpu->Y==0;
     cpu->neg = cpu->Y>>7;
@@ -2311,11 +2457,14 @@ static void cpu_handle_lsr_zpg(struct processor_t* cpu, struct mem* mem) {
 
     uint8_t address = cpu_get_address_zpg(cpu, mem);
 
-    cpu->carry = mem->data[address] & 1;
+    uint8_t value = mem_get_data_byte(mem, address);
+
+    cpu->carry = value & 1;
 
-    mem->data[address] = mem->data[address]>>1;
+    value = value>>1;
+    mem_set_data_byte(mem, address, value);
     
-    cpu->zero = mem->data[address]==0;
+    cpu->zero = value==0;
 
     cpu->carry_st = true;
     cpu->zero_st = true;
@@ -2329,11 +2478,14 @@ static void cpu_handle_lsr_zpg_x(struct processor_t* cpu, struct mem* mem) {
 
     uint16_t address = cpu_get_address_zpg_x(cpu, mem);
 
-    cpu->carry = mem->data[address] & 1;
+    uint8_t value = mem_get_data_byte(mem, address);
 
-    mem->data[address] = mem->data[address]>>1;
+    cpu->carry = value & 1;
+
+    value = value>>1;
+    mem_set_data_byte(mem, address, value);
     
-    cpu->zero = mem->data[address]==0;
+    cpu->zero = value==0;
 
     cpu->carry_st = true;
     cpu->zero_st = true;
@@ -2347,11 +2499,14 @@ static void cpu_handle_lsr_abs(struct processor_t* cpu, struct mem* mem) {
 
     uint8_t address = cpu_get_operand_short(cpu, mem);
 
-    cpu->carry = mem->data[address] & 1;
+    uint8_t value = mem_get_data_byte(mem, address);
+
+    cpu->carry = value & 1;
 
-    mem->data[address] = mem->data[address]>>1;
+    value = value>>1;
+    mem_set_data_byte(mem, address, value);
     
-    cpu->zero = mem->data[address]==0;
+    cpu->zero = value==0;
 
     cpu->carry_st = true;
     cpu->zero_st = true;
@@ -2365,11 +2520,14 @@ static void cpu_handle_lsr_abs_x(struct processor_t* cpu, struct mem* mem) {
 
     uint8_t address = cpu_get_address_abs_x(cpu, mem);
 
-    cpu->carry = mem->data[address] & 1;
+    uint8_t value = mem_get_data_byte(mem, address);
 
-    mem->data[address] = mem->data[address]>>1;
+    cpu->carry = value & 1;
+
+    value = value>>1;
+    mem_set_data_byte(mem, address, value);
     
-    cpu->zero = mem->data[address]==0;
+    cpu->zero = value==0;
 
     cpu->carry_st = true;
     cpu->zero_st = true;
@@ -2396,8 +2554,8 @@ static void cpu_handle_ora_imm(struct processor_t* cpu, struct mem* mem) {
 
     cpu->A = cpu->A | cpu_get_operand_byte(cpu, mem);
 
-    cpu->zero = cpu->Y==0;
-    cpu->neg = cpu->Y>>7;
+    cpu->zero = cpu->A==0;
+    cpu->neg = cpu->A>>7;
     
     cpu->A_st = true;
     cpu->zero_st = true;
@@ -2412,10 +2570,10 @@ static void cpu_handle_ora_zpg(struct processor_t* cpu, struct mem* mem) {
 
     uint16_t addr = cpu_get_address_zpg(cpu, mem);
 
-    cpu->A = cpu->A | mem->data[addr];
+    cpu->A = cpu->A | mem_get_data_byte(mem, addr);
 
-    cpu->zero = cpu->Y==0;
-    cpu->neg = cpu->Y>>7;
+    cpu->zero = cpu->A==0;
+    cpu->neg = cpu->A>>7;
     
     cpu->A_st = true;
     cpu->zero_st = true;
@@ -2430,10 +2588,10 @@ static void cpu_handle_ora_zpg_x(struct processor_t* cpu, struct mem* mem) {
 
     uint16_t addr = cpu_get_address_zpg_x(cpu, mem);
 
-    cpu->A = cpu->A | mem->data[addr];
+    cpu->A = cpu->A | mem_get_data_byte(mem, addr);
 
-    cpu->zero = cpu->Y==0;
-    cpu->neg = cpu->Y>>7;
+    cpu->zero = cpu->A==0;
+    cpu->neg = cpu->A>>7;
     
     cpu->A_st = true;
     cpu->zero_st = true;
@@ -2448,10 +2606,10 @@ static void cpu_handle_ora_abs(struct processor_t* cpu, struct mem* mem) {
 
     uint16_t addr = cpu_get_operand_short(cpu, mem);
 
-    cpu->A = cpu->A | mem->data[addr];
+    cpu->A = cpu->A | mem_get_data_byte(mem, addr);
 
-    cpu->zero = cpu->Y==0;
-    cpu->neg = cpu->Y>>7;
+    cpu->zero = cpu->A==0;
+    cpu->neg = cpu->A>>7;
     
     cpu->A_st = true;
     cpu->zero_st = true;
@@ -2466,10 +2624,10 @@ static void cpu_handle_ora_abs_x(struct processor_t* cpu, struct mem* mem) {
 
     uint16_t addr = cpu_get_address_abs_x(cpu, mem);
 
-    cpu->A = cpu->A | mem->data[addr];
+    cpu->A = cpu->A | mem_get_data_byte(mem, addr);
 
-    cpu->zero = cpu->Y==0;
-    cpu->neg = cpu->Y>>7;
+    cpu->zero = cpu->A==0;
+    cpu->neg = cpu->A>>7;
     
     cpu->A_st = true;
     cpu->zero_st = true;
@@ -2484,10 +2642,10 @@ static void cpu_handle_ora_abs_y(struct processor_t* cpu, struct mem* mem) {
 
     uint16_t addr = cpu_get_address_abs_y(cpu, mem);
 
-    cpu->A = cpu->A | mem->data[addr];
+    cpu->A = cpu->A | mem_get_data_byte(mem, addr);
 
-    cpu->zero = cpu->Y==0;
-    cpu->neg = cpu->Y>>7;
+    cpu->zero = cpu->A==0;
+    cpu->neg = cpu->A>>7;
     
     cpu->A_st = true;
     cpu->zero_st = true;
@@ -2502,10 +2660,10 @@ static void cpu_handle_ora_ind_x(struct processor_t* cpu, struct mem* mem) {
 
     uint16_t addr = cpu_get_address_ind_x(cpu, mem);
 
-    cpu->A = cpu->A | mem->data[addr];
+    cpu->A = cpu->A | mem_get_data_byte(mem, addr);
 
-    cpu->zero = cpu->Y==0;
-    cpu->neg = cpu->Y>>7;
+    cpu->zero = cpu->A==0;
+    cpu->neg = cpu->A>>7;
     
     cpu->A_st = true;
     cpu->zero_st = true;
@@ -2520,10 +2678,10 @@ static void cpu_handle_ora_ind_y(struct processor_t* cpu, struct mem* mem) {
 
     uint16_t addr = cpu_get_address_ind_y(cpu, mem);
 
-    cpu->A = cpu->A | mem->data[addr];
+    cpu->A = cpu->A | mem_get_data_byte(mem, addr);
 
-    cpu->zero = cpu->Y==0;
-    cpu->neg = cpu->Y>>7;
+    cpu->zero = cpu->A==0;
+    cpu->neg = cpu->A>>7;
     
     cpu->A_st = true;
     cpu->zero_st = true;
@@ -2539,7 +2697,7 @@ static void cpu_handle_ora_ind_y(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_pha_imp(struct processor_t* cpu, struct mem* mem) {
 
-    mem->data[cpu->SP--] = cpu->A;
+    mem_set_data_byte(mem, cpu->SP--, cpu->A);
 
     cpu->SP_st = true;
 
@@ -2556,7 +2714,7 @@ static void cpu_handle_php_imp(struct processor_t* cpu, struct mem* mem) {
     uint8_t status = cpu->neg<<7 | cpu->over<<6 | cpu->dec<<3 | 
         cpu->ids<<2 | cpu->zero<<1 | cpu->carry;
 
-    mem->data[cpu->SP--] = status;
+    mem_set_data_byte(mem, cpu->SP--, status);
 
     cpu->SP_st = true;
 
@@ -2570,12 +2728,43 @@ static void cpu_handle_php_imp(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_pla_imp(struct processor_t* cpu, struct mem* mem) {
 
-    cpu->A = mem->data[++cpu->SP];
+    cpu->A = mem_get_data_byte(mem, ++cpu->SP);
 
     cpu->SP_st = true;
     cpu->A_st = true;
 }
 
+/*---------------------------------------------------*/
+/* RTI OPERATION */
+
+/*---------------------------------------------------*/
+/* brief: handle rti imp, pulls what cpu_interrupt pushed */
+/*---------------------------------------*/
+static void cpu_handle_rti_imp(struct processor_t* cpu, struct mem* mem) {
+    uint16_t from = cpu->PC;
+    uint8_t status = mem_get_data_byte(mem, ++cpu->SP);
+
+    cpu->neg = status>>7 & 1;
+    cpu->over = status>>6 & 1;
+    cpu->dec = status>>3 & 1;
+    cpu->ids = status>>2 & 1;
+    cpu->zero = status>>1 & 1;
+    cpu->carry = status & 1;
+
+    cpu->PC = mem_get_data_byte(mem, ++cpu->SP)<<8;
+    cpu->PC = cpu->PC | mem_get_data_byte(mem, ++cpu->SP);
+    cpu_cover(cpu, from, cpu->PC);
+
+    cpu->SP_st = true;
+    cpu->PC_st = true;
+    cpu->neg_st = true;
+    cpu->over_st = true;
+    cpu->dec_st = true;
+    cpu->ids_st = true;
+    cpu->zero_st = true;
+    cpu->carry_st = true;
+}
+
 /*---------------------------------------------------*/
 /* RTS OPERATION */
 
@@ -2583,10 +2772,12 @@ static void cpu_handle_pla_imp(struct processor_t* cpu, struct mem* mem) {
 /* brief: handle rts imp */
 /*---------------------------------------*/
 static void cpu_handle_rts_imp(struct processor_t* cpu, struct mem* mem) {
-    
+    uint16_t from = cpu->PC;
+
     cpu->PC = 0;
-    cpu->PC = cpu->PC | mem->data[++cpu->SP]<<8;
-    cpu->PC = (cpu->PC | mem->data[++cpu->SP]);
+    cpu->PC = cpu->PC | mem_get_data_byte(mem, ++cpu->SP)<<8;
+    cpu->PC = (cpu->PC | mem_get_data_byte(mem, ++cpu->SP));
+    cpu_cover(cpu, from, cpu->PC);
 
     cpu->SP_st = true;
     cpu->PC_st = true;
@@ -2625,7 +2816,7 @@ static void cpu_handle_sbc_zpg(struct processor_t* cpu, struct mem* mem) {
 
     uint8_t tmp = cpu->A;
 
-    cpu->A = cpu->A - mem->data[oper] - cpu->carry;
+    cpu->A = cpu->A - mem_get_data_byte(mem, oper) - cpu->carry;
 
     cpu->carry = cpu->A<tmp;
     cpu->zero = cpu->A==0;
@@ -2646,7 +2837,7 @@ static void cpu_handle_sbc_zpg_x(struct processor_t* cpu, struct mem* mem) {
 
     uint8_t tmp = cpu->A;
 
-    cpu->A = cpu->A - mem->data[oper] - cpu->carry;
+    cpu->A = cpu->A - mem_get_data_byte(mem, oper) - cpu->carry;
 
     cpu->carry = cpu->A<tmp;
     cpu->zero = cpu->A==0;
@@ -2667,7 +2858,7 @@ static void cpu_handle_sbc_abs(struct processor_t* cpu, struct mem* mem) {
 
     uint8_t tmp = cpu->A;
 
-    cpu->A = cpu->A - mem->data[oper] - cpu->carry;
+    cpu->A = cpu->A - mem_get_data_byte(mem, oper) - cpu->carry;
 
     cpu->carry = cpu->A<tmp;
     cpu->zero = cpu->A==0;
@@ -2688,7 +2879,7 @@ static void cpu_handle_sbc_abs_x(struct processor_t* cpu, struct mem* mem) {
 
     uint8_t tmp = cpu->A;
 
-    cpu->A = cpu->A - mem->data[oper] - cpu->carry;
+    cpu->A = cpu->A - mem_get_data_byte(mem, oper) - cpu->carry;
 
     cpu->carry = cpu->A<tmp;
     cpu->zero = cpu->A==0;
@@ -2709,7 +2900,7 @@ static void cpu_handle_sbc_abs_y(struct processor_t* cpu, struct mem* mem) {
 
     uint8_t tmp = cpu->A;
 
-    cpu->A = cpu->A - mem->data[oper] - cpu->carry;
+    cpu->A = cpu->A - mem_get_data_byte(mem, oper) - cpu->carry;
 
     cpu->carry = cpu->A<tmp;
     cpu->zero = cpu->A==0;
@@ -2730,7 +2921,7 @@ static void cpu_handle_sbc_ind_x(struct processor_t* cpu, struct mem* mem) {
 
     uint8_t tmp = cpu->A;
 
-    cpu->A = cpu->A - mem->data[oper] - cpu->carry;
+    cpu->A = cpu->A - mem_get_data_byte(mem, oper) - cpu->carry;
 
     cpu->carry = cpu->A<tmp;
     cpu->zero = cpu->A==0;
@@ -2751,7 +2942,7 @@ static void cpu_handle_sbc_ind_y(struct processor_t* cpu, struct mem* mem) {
 
     uint8_t tmp = cpu->A;
 
-    cpu->A = cpu->A - mem->data[oper] - cpu->carry;
+    cpu->A = cpu->A - mem_get_data_byte(mem, oper) - cpu->carry;
 
     cpu->carry = cpu->A<tmp;
     cpu->zero = cpu->A==0;
@@ -2814,7 +3005,7 @@ static void cpu_handle_sei_imp(struct processor_t* cpu, struct mem* mem) {
 static void cpu_handle_sta_abs(struct processor_t* cpu, struct mem* mem) {
     uint16_t address;
     address = cpu_get_operand_short(cpu, mem);
-    mem->data[address] = cpu->A;
+    mem_set_data_byte(mem, address, cpu->A);
 
     cpu->A_st = true;
 }
@@ -2825,7 +3016,7 @@ static void cpu_handle_sta_abs(struct processor_t* cpu, struct mem* mem) {
 static void cpu_handle_sta_zpg(struct processor_t* cpu, struct mem* mem) {
     uint16_t address;
     address = cpu_get_address_zpg(cpu, mem);
-    mem->data[address] = cpu->A;
+    mem_set_data_byte(mem, address, cpu->A);
 
     cpu->A_st = true;
 }
@@ -2835,7 +3026,7 @@ static void cpu_handle_sta_zpg(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_sta_ind_x(struct processor_t* cpu, struct mem* mem) {
     uint16_t address = cpu_get_address_ind_x(cpu, mem);
-    mem->data[address] = cpu->A;
+    mem_set_data_byte(mem, address, cpu->A);
 
     cpu->A_st = true;
 }
@@ -2845,7 +3036,7 @@ static void cpu_handle_sta_ind_x(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_sta_ind_y(struct processor_t* cpu, struct mem* mem) {
     uint16_t address = cpu_get_address_ind_y(cpu, mem);
-    mem->data[address] = cpu->A;
+    mem_set_data_byte(mem, address, cpu->A);
 
     cpu->A_st = true;
 }
@@ -2855,7 +3046,7 @@ static void cpu_handle_sta_ind_y(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_sta_zpg_x(struct processor_t* cpu, struct mem* mem) {
     uint16_t address = cpu_get_address_zpg_x(cpu, mem);
-    mem->data[address] = cpu->A;
+    mem_set_data_byte(mem, address, cpu->A);
 
     cpu->A_st = true;
 }
@@ -2865,7 +3056,7 @@ static void cpu_handle_sta_zpg_x(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_sta_abs_x(struct processor_t* cpu, struct mem* mem) {
     uint16_t address = cpu_get_address_abs_x(cpu, mem);
-    mem->data[address] = cpu->A;
+    mem_set_data_byte(mem, address, cpu->A);
 
     cpu->A_st = true;
 }
@@ -2875,7 +3066,7 @@ static void cpu_handle_sta_abs_x(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_sta_abs_y(struct processor_t* cpu, struct mem* mem) {
     uint16_t address = cpu_get_address_abs_y(cpu, mem);
-    mem->data[address] = cpu->A;
+    mem_set_data_byte(mem, address, cpu->A);
 
     cpu->A_st = true;
 }
@@ -2888,7 +3079,7 @@ static void cpu_handle_sta_abs_y(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_stx_zpg(struct processor_t* cpu, struct mem* mem) {
     uint16_t address = cpu_get_operand_byte(cpu, mem);
-    mem->data[address] = cpu->X;
+    mem_set_data_byte(mem, address, cpu->X);
 
     cpu->X_st = true;
 }
@@ -2898,7 +3089,7 @@ static void cpu_handle_stx_zpg(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_stx_zpg_y(struct processor_t* cpu, struct mem* mem) {
     uint16_t address = cpu_get_address_zpg_y(cpu, mem);
-    mem->data[address] = cpu->X;
+    mem_set_data_byte(mem, address, cpu->X);
 
     cpu->X_st = true;
 }
@@ -2908,7 +3099,7 @@ static void cpu_handle_stx_zpg_y(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_stx_abs(struct processor_t* cpu, struct mem* mem) {
     uint16_t address = cpu_get_operand_short(cpu, mem);
-    mem->data[address] = cpu->X;
+    mem_set_data_byte(mem, address, cpu->X);
 
     cpu->X_st = true;
 }
@@ -2921,7 +3112,7 @@ static void cpu_handle_stx_abs(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_sty_zpg(struct processor_t* cpu, struct mem* mem) {
     uint16_t address = cpu_get_operand_byte(cpu, mem);
-    mem->data[address] = cpu->Y;
+    mem_set_data_byte(mem, address, cpu->Y);
 
     cpu->Y_st = true;
 }
@@ -2931,7 +3122,7 @@ static void cpu_handle_sty_zpg(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_sty_zpg_x(struct processor_t* cpu, struct mem* mem) {
     uint16_t address = cpu_get_address_zpg_x(cpu, mem);
-    mem->data[address] = cpu->Y;
+    mem_set_data_byte(mem, address, cpu->Y);
 
     cpu->Y_st = true;
 }
@@ -2941,7 +3132,7 @@ static void cpu_handle_sty_zpg_x(struct processor_t* cpu, struct mem* mem) {
 /*---------------------------------------*/
 static void cpu_handle_sty_abs(struct processor_t* cpu, struct mem* mem) {
     uint16_t address = cpu_get_operand_short(cpu, mem);
-    mem->data[address] = cpu->Y;
+    mem_set_data_byte(mem, address, cpu->Y);
 
     cpu->Y_st = true;
 }
@@ -3061,272 +3252,272 @@ static void cpu_handle_tya_imp(struct processor_t* cpu, struct mem* mem) {
 
 struct cpu_op_handler_t op_handler[] = {
     /* ADC */
-    {ADC_IMM,   cpu_handle_adc_imm},
-    {ADC_ABS,   cpu_handle_adc_abs},
-    {ADC_ZPG,   cpu_handle_adc_zpg},
-    {ADC_IND_X, cpu_handle_adc_ind_x}, 
-    {ADC_IND_Y, cpu_handle_adc_ind_y},
-    {ADC_ZPG_X, cpu_handle_adc_zpg_x},
-    {ADC_ABS_X, cpu_handle_adc_abs_x},
-    {ADC_ABS_Y, cpu_handle_adc_abs_y},
+    {ADC_IMM,   cpu_handle_adc_imm, 2},
+    {ADC_ABS,   cpu_handle_adc_abs, 4},
+    {ADC_ZPG,   cpu_handle_adc_zpg, 3},
+    {ADC_IND_X, cpu_handle_adc_ind_x, 6}, 
+    {ADC_IND_Y, cpu_handle_adc_ind_y, 5},
+    {ADC_ZPG_X, cpu_handle_adc_zpg_x, 4},
+    {ADC_ABS_X, cpu_handle_adc_abs_x, 4},
+    {ADC_ABS_Y, cpu_handle_adc_abs_y, 4},
 
     /* AND */
-    {AND_IMM,   cpu_handle_and_imm},
-    {AND_ABS,   cpu_handle_and_abs},
-    {AND_ZPG,   cpu_handle_and_zpg},
-    {AND_IND_X, cpu_handle_and_ind_x},
-    {AND_IND_Y, cpu_handle_and_ind_y}, 
-    {AND_ZPG_X, cpu_handle_and_zpg_x},
-    {AND_ABS_X, cpu_handle_and_abs_x},
-    {AND_ABS_Y, cpu_handle_and_abs_y},
+    {AND_IMM,   cpu_handle_and_imm, 2},
+    {AND_ABS,   cpu_handle_and_abs, 4},
+    {AND_ZPG,   cpu_handle_and_zpg, 3},
+    {AND_IND_X, cpu_handle_and_ind_x, 6},
+    {AND_IND_Y, cpu_handle_and_ind_y, 5}, 
+    {AND_ZPG_X, cpu_handle_and_zpg_x, 4},
+    {AND_ABS_X, cpu_handle_and_abs_x, 4},
+    {AND_ABS_Y, cpu_handle_and_abs_y, 4},
 
     /* ASL */
-    {ASL_ACC,   cpu_handle_asl_acc},
-    {ASL_ZPG,   cpu_handle_asl_zpg}, 
-    {ASL_ZPG_X, cpu_handle_asl_zpg_x},
-    {ASL_ABS,   cpu_handle_asl_abs}, 
-    {ASL_ABS_X, cpu_handle_asl_abs_x},
+    {ASL_ACC,   cpu_handle_asl_acc, 2},
+    {ASL_ZPG,   cpu_handle_asl_zpg, 5}, 
+    {ASL_ZPG_X, cpu_handle_asl_zpg_x, 6},
+    {ASL_ABS,   cpu_handle_asl_abs, 6}, 
+    {ASL_ABS_X, cpu_handle_asl_abs_x, 6},
 
     /* BCC */
-    {BCC_REL,   cpu_handle_bcc_rel},
+    {BCC_REL,   cpu_handle_bcc_rel, 2},
     
     /* BCS */
-    {BCS_REL,   cpu_handle_bcs_rel},
+    {BCS_REL,   cpu_handle_bcs_rel, 2},
    
     /* BEQ */
-    {BEQ_REL,   cpu_handle_beq_rel},
+    {BEQ_REL,   cpu_handle_beq_rel, 2},
     
     /* BIT */
-    {BIT_ZPG,   NULL}, //TO ADD
-    {BIT_ABS,   NULL}, //TO ADD
+    {BIT_ZPG,   NULL, 3}, //TO ADD
+    {BIT_ABS,   NULL, 4}, //TO ADD
     
     /* BMI */
-    {BMI_REL,   cpu_handle_bmi_rel},
+    {BMI_REL,   cpu_handle_bmi_rel, 2},
     
     /* BNE */
-    {BNE_REL,   cpu_handle_bne_rel},
+    {BNE_REL,   cpu_handle_bne_rel, 2},
     
     /* BPL */   
-    {BPL_REL,   cpu_handle_bpl_rel},
+    {BPL_REL,   cpu_handle_bpl_rel, 2},
     
     /* BRK */   
-    {BRK_IMP,   NULL}, //TO ADD
+    {BRK_IMP,   NULL, 7}, //TO ADD
     
     /* BVC */ 
-    {BVC_REL,   cpu_handle_bvc_rel},
+    {BVC_REL,   cpu_handle_bvc_rel, 2},
 
     /* BVS */ 
-    {BVS_REL,   cpu_handle_bvs_rel},
+    {BVS_REL,   cpu_handle_bvs_rel, 2},
     
     /* CLC */ 
-    {CLC_IMP,   cpu_handle_clc_imp},
+    {CLC_IMP,   cpu_handle_clc_imp, 2},
     
     /* CLD */ 
-    {CLD_IMP,   cpu_handle_cld_imp},
+    {CLD_IMP,   cpu_handle_cld_imp, 2},
     
     /* CLI */ 
-    {CLI_IMP,   cpu_handle_cli_imp},
+    {CLI_IMP,   cpu_handle_cli_imp, 2},
     
     /* CLV */ 
-    {CLV_IMP,   cpu_handle_clv_imp},
+    {CLV_IMP,   cpu_handle_clv_imp, 2},
     
     /* CMP */ 
-    {CMP_IMM,   cpu_handle_cmp_imm},
-    {CMP_ZPG,   cpu_handle_cmp_zpg},
-    {CMP_ZPG_X, cpu_handle_cmp_zpg_x},
-    {CMP_ABS,   cpu_handle_cmp_abs},
-    {CMP_ABS_X, cpu_handle_cmp_abs_x},
-    {CMP_ABS_Y, cpu_handle_cmp_abs_y},
-    {CMP_IND_X, cpu_handle_cmp_ind_x},
-    {CMP_IND_Y, cpu_handle_cmp_ind_y},
+    {CMP_IMM,   cpu_handle_cmp_imm, 2},
+    {CMP_ZPG,   cpu_handle_cmp_zpg, 3},
+    {CMP_ZPG_X, cpu_handle_cmp_zpg_x, 4},
+    {CMP_ABS,   cpu_handle_cmp_abs, 4},
+    {CMP_ABS_X, cpu_handle_cmp_abs_x, 4},
+    {CMP_ABS_Y, cpu_handle_cmp_abs_y, 4},
+    {CMP_IND_X, cpu_handle_cmp_ind_x, 6},
+    {CMP_IND_Y, cpu_handle_cmp_ind_y, 5},
     
     /* CPX */
-    {CPX_IMM,   cpu_handle_cpx_imm},
-    {CPX_ZPG,   cpu_handle_cpx_zpg},
-    {CPX_ABS,   cpu_handle_cpx_abs},
+    {CPX_IMM,   cpu_handle_cpx_imm, 2},
+    {CPX_ZPG,   cpu_handle_cpx_zpg, 3},
+    {CPX_ABS,   cpu_handle_cpx_abs, 4},
     
     /* CPY */
-    {CPY_IMM,   cpu_handle_cpy_imm}, 
-    {CPY_ZPG,   cpu_handle_cpy_zpg}, 
-    {CPY_ABS,   cpu_handle_cpy_abs}, 
+    {CPY_IMM,   cpu_handle_cpy_imm, 2}, 
+    {CPY_ZPG,   cpu_handle_cpy_zpg, 3}, 
+    {CPY_ABS,   cpu_handle_cpy_abs, 4}, 
     
     /* DEC */
-    {DEC_ZPG,   cpu_handle_dec_zpg},
-    {DEC_ZPG_X, cpu_handle_dec_zpg_x},
-    {DEC_ABS,   cpu_handle_dec_abs},
-    {DEC_ABS_X, cpu_handle_dec_abs_x},
+    {DEC_ZPG,   cpu_handle_dec_zpg, 5},
+    {DEC_ZPG_X, cpu_handle_dec_zpg_x, 6},
+    {DEC_ABS,   cpu_handle_dec_abs, 6},
+    {DEC_ABS_X, cpu_handle_dec_abs_x, 7},
     
     /* DEX */
-    {DEX_IMP,   cpu_handle_dex_imp},
+    {DEX_IMP,   cpu_handle_dex_imp, 2},
     
     /* DEY */
-    {DEY_IMP,   cpu_handle_dey_imp},
+    {DEY_IMP,   cpu_handle_dey_imp, 2},
    
     /* EOR */
-    {EOR_IMM,   cpu_handle_eor_imm},
-    {EOR_ZPG,   cpu_handle_eor_zpg}, 
-    {EOR_ZPG_X, cpu_handle_eor_zpg_x}, 
-    {EOR_ABS,   cpu_handle_eor_abs},
-    {EOR_ABS_X, cpu_handle_eor_abs_x},
-    {EOR_ABS_Y, cpu_handle_eor_abs_y},
-    {EOR_IND_X, cpu_handle_eor_ind_x},
-    {EOR_IND_Y, cpu_handle_eor_ind_y},
+    {EOR_IMM,   cpu_handle_eor_imm, 2},
+    {EOR_ZPG,   cpu_handle_eor_zpg, 3}, 
+    {EOR_ZPG_X, cpu_handle_eor_zpg_x, 4}, 
+    {EOR_ABS,   cpu_handle_eor_abs, 4},
+    {EOR_ABS_X, cpu_handle_eor_abs_x, 4},
+    {EOR_ABS_Y, cpu_handle_eor_abs_y, 4},
+    {EOR_IND_X, cpu_handle_eor_ind_x, 6},
+    {EOR_IND_Y, cpu_handle_eor_ind_y, 5},
     
     /* INC */
-    {INC_ZPG,   cpu_handle_inc_zpg},
-    {INC_ZPG_X, cpu_handle_inc_zpg_x},
-    {INC_ABS,   cpu_handle_inc_abs},
-    {INC_ABS_X, cpu_handle_inc_abs_x},
+    {INC_ZPG,   cpu_handle_inc_zpg, 5},
+    {INC_ZPG_X, cpu_handle_inc_zpg_x, 6},
+    {INC_ABS,   cpu_handle_inc_abs, 6},
+    {INC_ABS_X, cpu_handle_inc_abs_x, 7},
     
     /* INX */
-    {INX_IMP,   cpu_handle_inx_imp},
+    {INX_IMP,   cpu_handle_inx_imp, 2},
     
     /* INY */
-    {INY_IMP,   cpu_handle_iny_imp},
+    {INY_IMP,   cpu_handle_iny_imp, 2},
     
     /* JMP */
-    {JMP_ABS,   cpu_handle_jmp_abs},
-    {JMP_IND,   cpu_handle_jmp_ind},
+    {JMP_ABS,   cpu_handle_jmp_abs, 3},
+    {JMP_IND,   cpu_handle_jmp_ind, 6},
     
     /* JSR */
-    {JSR_ABS,   cpu_handle_jsr_abs}, 
+    {JSR_ABS,   cpu_handle_jsr_abs, 6}, 
 
     /* LDA */
-    {LDA_IMM,   cpu_handle_lda_imm},
-    {LDA_ABS,   cpu_handle_lda_abs},
-    {LDA_ZPG,   cpu_handle_lda_zpg},
-    {LDA_IND_X, cpu_handle_lda_ind_x},
-    {LDA_IND_Y, cpu_handle_lda_ind_y},
-    {LDA_ZPG_X, cpu_handle_lda_zpg_x},
-    {LDA_ABS_X, cpu_handle_lda_abs_x},
-    {LDA_ABS_Y, cpu_handle_lda_abs_y},
+    {LDA_IMM,   cpu_handle_lda_imm, 2},
+    {LDA_ABS,   cpu_handle_lda_abs, 4},
+    {LDA_ZPG,   cpu_handle_lda_zpg, 3},
+    {LDA_IND_X, cpu_handle_lda_ind_x, 6},
+    {LDA_IND_Y, cpu_handle_lda_ind_y, 5},
+    {LDA_ZPG_X, cpu_handle_lda_zpg_x, 4},
+    {LDA_ABS_X, cpu_handle_lda_abs_x, 4},
+    {LDA_ABS_Y, cpu_handle_lda_abs_y, 4},
 
 
     /* LDX */
-    {LDX_IMM,   cpu_handle_ldx_imm},
-    {LDX_ZPG,   cpu_handle_ldx_zpg},
-    {LDX_ZPG_Y, cpu_handle_ldx_zpg_y},
-    {LDX_ABS,   cpu_handle_ldx_abs}, 
-    {LDX_ABS_Y, cpu_handle_ldx_abs_y},
+    {LDX_IMM,   cpu_handle_ldx_imm, 2},
+    {LDX_ZPG,   cpu_handle_ldx_zpg, 3},
+    {LDX_ZPG_Y, cpu_handle_ldx_zpg_y, 4},
+    {LDX_ABS,   cpu_handle_ldx_abs, 4}, 
+    {LDX_ABS_Y, cpu_handle_ldx_abs_y, 4},
 
     /* LDY */
-    {LDY_IMM,   cpu_handle_ldy_imm},
-    {LDY_ZPG,   cpu_handle_ldy_zpg},
-    {LDY_ZPG_X, cpu_handle_ldy_zpg_x},
-    {LDY_ABS,   cpu_handle_ldy_abs}, 
-    {LDY_ABS_X, cpu_handle_ldy_abs_x},
+    {LDY_IMM,   cpu_handle_ldy_imm, 2},
+    {LDY_ZPG,   cpu_handle_ldy_zpg, 3},
+    {LDY_ZPG_X, cpu_handle_ldy_zpg_x, 4},
+    {LDY_ABS,   cpu_handle_ldy_abs, 4}, 
+    {LDY_ABS_X, cpu_handle_ldy_abs_x, 4},
 
     /* LSR */
-    {LSR_ACC,   cpu_handle_lsr_acc},
-    {LSR_ZPG,   cpu_handle_lsr_zpg},
-    {LSR_ZPG_X, cpu_handle_lsr_zpg_x},
-    {LSR_ABS,   cpu_handle_lsr_abs}, 
-    {LSR_ABS_X, cpu_handle_lsr_abs_x},
+    {LSR_ACC,   cpu_handle_lsr_acc, 2},
+    {LSR_ZPG,   cpu_handle_lsr_zpg, 5},
+    {LSR_ZPG_X, cpu_handle_lsr_zpg_x, 6},
+    {LSR_ABS,   cpu_handle_lsr_abs, 6}, 
+    {LSR_ABS_X, cpu_handle_lsr_abs_x, 6},
     
     /* NOP */
-    {NOP,  cpu_handle_nop}, 
+    {NOP,  cpu_handle_nop, 2}, 
     
     /* ORA */
-    {ORA_IMM,   cpu_handle_ora_imm}, 
-    {ORA_ZPG,   cpu_handle_ora_zpg},
-    {ORA_ZPG_X, cpu_handle_ora_zpg_x},
-    {ORA_ABS,   cpu_handle_ora_abs}, 
-    {ORA_ABS_X, cpu_handle_ora_abs_x},
-    {ORA_ABS_Y, cpu_handle_ora_abs_y},
-    {ORA_IND_X, cpu_handle_ora_ind_x},
-    {ORA_IND_Y, cpu_handle_ora_ind_y},
+    {ORA_IMM,   cpu_handle_ora_imm, 2}, 
+    {ORA_ZPG,   cpu_handle_ora_zpg, 3},
+    {ORA_ZPG_X, cpu_handle_ora_zpg_x, 4},
+    {ORA_ABS,   cpu_handle_ora_abs, 4}, 
+    {ORA_ABS_X, cpu_handle_ora_abs_x, 4},
+    {ORA_ABS_Y, cpu_handle_ora_abs_y, 4},
+    {ORA_IND_X, cpu_handle_ora_ind_x, 6},
+    {ORA_IND_Y, cpu_handle_ora_ind_y, 5},
     
     /* PHA */
-    {PHA_IMP,   cpu_handle_pha_imp}, 
+    {PHA_IMP,   cpu_handle_pha_imp, 3}, 
     
     /* PHP */
-    {PHP_IMP,   cpu_handle_php_imp}, 
+    {PHP_IMP,   cpu_handle_php_imp, 3}, 
     
     /* PLA */
-    {PLA_IMP,   cpu_handle_pla_imp}, 
+    {PLA_IMP,   cpu_handle_pla_imp, 4}, 
     
     /* PLP */
-    {PLP_IMP,   NULL}, //TO ADD
+    {PLP_IMP,   NULL, 4}, //TO ADD
 
     /* ROL */
-    {ROL_ACC,   NULL}, //TO ADD
-    {ROL_ZPG,   NULL}, //TO ADD
-    {ROL_ZPG_X,   NULL}, //TO ADD
-    {ROL_ABS,   NULL}, //TO ADD
-    {ROL_ABS_X,   NULL}, //TO ADD
+    {ROL_ACC,   NULL, 2}, //TO ADD
+    {ROL_ZPG,   NULL, 5}, //TO ADD
+    {ROL_ZPG_X,   NULL, 6}, //TO ADD
+    {ROL_ABS,   NULL, 6}, //TO ADD
+    {ROL_ABS_X,   NULL, 6}, //TO ADD
     
     /* ROR */
-    {ROR_ACC,   NULL}, //TO ADD
-    {ROR_ZPG,   NULL}, //TO ADD
-    {ROR_ZPG_X,   NULL}, //TO ADD
-    {ROR_ABS,   NULL}, //TO ADD
-    {ROR_ABS_X,   NULL}, //TO ADD
+    {ROR_ACC,   NULL, 2}, //TO ADD
+    {ROR_ZPG,   NULL, 5}, //TO ADD
+    {ROR_ZPG_X,   NULL, 6}, //TO ADD
+    {ROR_ABS,   NULL, 6}, //TO ADD
+    {ROR_ABS_X,   NULL, 6}, //TO ADD
     
     /* RTI */
-    {RTI_IMP,   NULL}, //TO ADD
+    {RTI_IMP,   cpu_handle_rti_imp, 6},
     
     /* RTS */
-    {RTS_IMP,   cpu_handle_rts_imp},
+    {RTS_IMP,   cpu_handle_rts_imp, 6},
     
     /* SBC */
-    {SBC_IMM,   cpu_handle_sbc_imm},
-    {SBC_ZPG,   cpu_handle_sbc_zpg}, 
-    {SBC_ZPG_X, cpu_handle_sbc_zpg_x},
-    {SBC_ABS,   cpu_handle_sbc_abs}, 
-    {SBC_ABS_X, cpu_handle_sbc_abs_x},
-    {SBC_ABS_Y, cpu_handle_sbc_abs_y},
-    {SBC_IND_X, cpu_handle_sbc_ind_x},
-    {SBC_IND_Y, cpu_handle_sbc_ind_y}, 
+    {SBC_IMM,   cpu_handle_sbc_imm, 2},
+    {SBC_ZPG,   cpu_handle_sbc_zpg, 3}, 
+    {SBC_ZPG_X, cpu_handle_sbc_zpg_x, 4},
+    {SBC_ABS,   cpu_handle_sbc_abs, 4}, 
+    {SBC_ABS_X, cpu_handle_sbc_abs_x, 4},
+    {SBC_ABS_Y, cpu_handle_sbc_abs_y, 4},
+    {SBC_IND_X, cpu_handle_sbc_ind_x, 6},
+    {SBC_IND_Y, cpu_handle_sbc_ind_y, 5}, 
     
     /* SEC */
-    {SEC_IMP,   cpu_handle_sec_imp},
+    {SEC_IMP,   cpu_handle_sec_imp, 2},
     
     /* SED */
-    {SED_IMP,   cpu_handle_sed_imp},
+    {SED_IMP,   cpu_handle_sed_imp, 2},
     
     /* SEI */
-    {SEI_IMP,   cpu_handle_sei_imp}, 
+    {SEI_IMP,   cpu_handle_sei_imp, 2}, 
    
     /* STA */
-    {STA_ABS,   cpu_handle_sta_abs},
-    {STA_ZPG,   cpu_handle_sta_zpg},
-    {STA_IND_X, cpu_handle_sta_ind_x}, 
-    {STA_IND_Y, cpu_handle_sta_ind_y},
-    {STA_ZPG_X, cpu_handle_sta_zpg_x},
-    {STA_ABS_X, cpu_handle_sta_abs_x},
-    {STA_ABS_Y, cpu_handle_sta_abs_y},
+    {STA_ABS,   cpu_handle_sta_abs, 4},
+    {STA_ZPG,   cpu_handle_sta_zpg, 3},
+    {STA_IND_X, cpu_handle_sta_ind_x, 6}, 
+    {STA_IND_Y, cpu_handle_sta_ind_y, 6},
+    {STA_ZPG_X, cpu_handle_sta_zpg_x, 4},
+    {STA_ABS_X, cpu_handle_sta_abs_x, 5},
+    {STA_ABS_Y, cpu_handle_sta_abs_y, 5},
 
     /* STX */
-    {STX_ZPG,   cpu_handle_stx_zpg},
-    {STX_ZPG_Y, cpu_handle_stx_zpg_y},
-    {STX_ABS,   cpu_handle_stx_abs}, 
+    {STX_ZPG,   cpu_handle_stx_zpg, 3},
+    {STX_ZPG_Y, cpu_handle_stx_zpg_y, 4},
+    {STX_ABS,   cpu_handle_stx_abs, 4}, 
     
     /* STY */
-    {STY_ZPG,   cpu_handle_sty_zpg},
-    {STY_ZPG_X, cpu_handle_sty_zpg_x}, 
-    {STY_ABS,   cpu_handle_sty_abs}, 
+    {STY_ZPG,   cpu_handle_sty_zpg, 3},
+    {STY_ZPG_X, cpu_handle_sty_zpg_x, 4}, 
+    {STY_ABS,   cpu_handle_sty_abs, 4}, 
     
     /* TAX */
-    {TAX_IMP,   cpu_handle_tax_imp},
+    {TAX_IMP,   cpu_handle_tax_imp, 2},
     
     /* TAY */
-    {TAY_IMP,   cpu_handle_tay_imp},
+    {TAY_IMP,   cpu_handle_tay_imp, 2},
     
     /* TSX */
-    {TSX_IMP,   cpu_handle_tsx_imp},
+    {TSX_IMP,   cpu_handle_tsx_imp, 2},
     
     /* TXA */
-    {TXA_IMP,   cpu_handle_txa_imp},
+    {TXA_IMP,   cpu_handle_txa_imp, 2},
     
     /* TXS */
-    {TXS_IMP,   cpu_handle_txs_imp},
+    {TXS_IMP,   cpu_handle_txs_imp, 2},
     
     /* TYA */
-    {TYA_IMP,   cpu_handle_tya_imp}, 
+    {TYA_IMP,   cpu_handle_tya_imp, 2}, 
 };
 
 /*---------------------------------------------------*/
-/* brief: return the next operand short */
+/* brief: execute op, the opcode just fetched */
 /*---------------------------------------*/
 int cpu_step(struct processor_t* cpu, struct mem* mem, enum opcode_e op) {
 
@@ -3339,11 +3530,21 @@ int cpu_step(struct processor_t* cpu, struct mem* mem, enum opcode_e op) {
 
     for(int i=0; i<sizeof(op_handler)/sizeof(struct cpu_op_handler_t); i++) {
         if(op==op_handler[i].op) {
+            uint16_t next = cpu->PC+cpu_op_get_n_bytes(op);
+
             if(op_handler[i].operation==NULL) {
                 cpu_handle_unsupported(op);
             } else {
                 op_handler[i].operation(cpu, mem);
             }
+
+            cpu->cycles += op_handler[i].cycles;
+
+            // taken branches cost one more cycle, two across a page
+            if(cpu_get_op_type(op)==OP_REL && cpu->PC!=next) {
+                cpu->cycles += (cpu->PC>>8)==(next>>8) ? 1 : 2;
+            }
+
             return 0;
         }
     }
@@ -3351,3 +3552,55 @@ int cpu_step(struct processor_t* cpu, struct mem* mem, enum opcode_e op) {
     return 1;
   
 }
+
+/*---------------------------------------------------*/
+/* brief: the cycles op takes, before the branch penalty, 0 if unknown */
+/*---------------------------------------*/
+int cpu_op_get_cycles(enum opcode_e op) {
+    for(int i=0; i<sizeof(op_handler)/sizeof(struct cpu_op_handler_t); i++) {
+        if(op==op_handler[i].op)
+            return op_handler[i].cycles;
+    }
+
+    return 0;
+}
+
+/*---------------------------------------------------*/
+/* brief: take an interrupt between two instructions, 7 cycles */
+/* the PC and then P are pushed as jsr and php do, I is set and D */
+/* cleared as on the 65C02, the handler starts at the address in vector */
+/*---------------------------------------*/
+void cpu_interrupt(struct processor_t* cpu, struct mem* mem, uint16_t vector) {
+    uint16_t from = cpu->PC;
+    uint8_t status = cpu->neg<<7 | cpu->over<<6 | cpu->dec<<3 | 
+        cpu->ids<<2 | cpu->zero<<1 | cpu->carry;
+
+    mem_set_data_byte(mem, cpu->SP--, cpu->PC & 0xff);
+    mem_set_data_byte(mem, cpu->SP--, cpu->PC>>8);
+    mem_set_data_byte(mem, cpu->SP--, status);
+
+    cpu->ids = 1;
+    cpu->dec = 0;
+    cpu->PC = mem_get_data_short(mem, vector);
+    cpu_cover(cpu, from, cpu->PC);
+
+    cpu->cycles += 7;
+
+    cpu->SP_st = true;
+    cpu->PC_st = true;
+    cpu->ids_st = true;
+    cpu->dec_st = true;
+    mem->last_selected = -1;
+}
+
+/*---------------------------------------------------*/
+/* brief: true if op does something, false for the unknown and the NULL ones */
+/*---------------------------------------*/
+bool cpu_op_supported(enum opcode_e op) {
+    for(int i=0; i<sizeof(op_handler)/sizeof(struct cpu_op_handler_t); i++) {
+        if(op==op_handler[i].op)
+            return op_handler[i].operation!=NULL;
+    }
+
+    return false;
+}
@@ -0,0 +1,126 @@
+#include <profile.h>
+#include <disasm.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* cycles spent under one symbol */
+struct profile_sym_t {
+    struct symbol_t* sym;
+    uint64_t count;
+    uint64_t cycles;
+};
+
+/* one line of the report */
+struct profile_pc_t {
+    uint16_t pc;
+    uint64_t cycles;
+};
+
+static int profile_compare_pc(const void* a, const void* b) {
+    uint64_t ca = ((const struct profile_pc_t*)a)->cycles;
+    uint64_t cb = ((const struct profile_pc_t*)b)->cycles;
+
+    return ca<cb ? 1 : ca>cb ? -1 : 0;
+}
+
+static int profile_compare_sym(const void* a, const void* b) {
+    uint64_t ca = ((const struct profile_sym_t*)a)->cycles;
+    uint64_t cb = ((const struct profile_sym_t*)b)->cycles;
+
+    return ca<cb ? 1 : ca>cb ? -1 : 0;
+}
+
+/*---------------------------------------------------*/
+/* brief: allocate zeroed counters */
+/*---------------------------------------*/
+struct profile_t* profile_new(void) {
+    return calloc(1, sizeof(struct profile_t));
+}
+
+/*---------------------------------------------------*/
+/* brief: release the counters */
+/*---------------------------------------*/
+void profile_free(struct profile_t* p) {
+    free(p);
+}
+
+/*---------------------------------------------------*/
+/* brief: print the hottest instructions, and symbols if any */
+/*---------------------------------------*/
+void profile_report(
+    FILE* fp, struct profile_t* p, struct mem* mem, 
+    struct symbols_t* syms, int lines) 
+{
+    static struct profile_pc_t pcs[MEM_SIZE];
+    int n = 0;
+    uint64_t total = 0;
+    uint64_t count = 0;
+
+    for(int pc=0; pc<MEM_SIZE; pc++) {
+        if(p->count[pc]>0) {
+            pcs[n].pc = pc;
+            pcs[n].cycles = p->cycles[pc];
+            n++;
+            total += p->cycles[pc];
+            count += p->count[pc];
+        }
+    }
+
+    qsort(pcs, n, sizeof(pcs[0]), profile_compare_pc);
+
+    fprintf(fp, "%llu instructions, %llu cycles, %d addresses\n\n",
+        (unsigned long long)count, (unsigned long long)total, n);
+
+    fprintf(fp, "%-5s %-20s %-16s %12s %14s %7s %7s\n",
+        "pc", "symbol", "instruction", "count", "cycles", "%", "cum %");
+
+    uint64_t cum = 0;
+    for(int i=0; i<n && (lines<=0 || i<lines); i++) {
+        uint16_t pc = pcs[i].pc;
+        char where[SYM_MAX_NAME+8];
+        char text[DISASM_MAX_TEXT];
+
+        disasm_mem(mem, pc, text, sizeof(text));
+        cum += p->cycles[pc];
+
+        fprintf(fp, "%04x  %-20s %-16s %12llu %14llu %6.2f%% %6.2f%%\n",
+            pc, syms->n ? sym_format(syms, pc, where, sizeof(where)) : "", 
+            text, (unsigned long long)p->count[pc],
+            (unsigned long long)p->cycles[pc], 
+            100.0*p->cycles[pc]/total, 100.0*cum/total);
+    }
+
+    if(syms->n==0)
+        return;
+
+    struct profile_sym_t* by_sym = calloc(syms->n+1, sizeof(*by_sym));
+    if(by_sym==NULL)
+        return;
+
+    // slot syms->n collects the addresses below the first symbol
+    for(int i=0; i<n; i++) {
+        struct symbol_t* sym = sym_find(syms, pcs[i].pc);
+        size_t k = sym ? (size_t)(sym-syms->syms) : syms->n;
+
+        by_sym[k].sym = sym;
+        by_sym[k].count += p->count[pcs[i].pc];
+        by_sym[k].cycles += pcs[i].cycles;
+    }
+
+    qsort(by_sym, syms->n+1, sizeof(*by_sym), profile_compare_sym);
+
+    fprintf(fp, "\n%-26s %12s %14s %7s\n", "symbol", "count", "cycles", "%");
+
+    for(size_t i=0; i<=syms->n && by_sym[i].cycles>0; i++) {
+        if(lines>0 && i>=(size_t)lines)
+            break;
+
+        fprintf(fp, "%-26s %12llu %14llu %6.2f%%\n",
+            by_sym[i].sym ? by_sym[i].sym->name : "?",
+            (unsigned long long)by_sym[i].count, 
+            (unsigned long long)by_sym[i].cycles,
+            100.0*by_sym[i].cycles/total);
+    }
+
+    free(by_sym);
+}
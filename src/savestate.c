@@ -0,0 +1,122 @@
+#include <savestate.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+static void sv_header(uint8_t* p) {
+    memcpy(p, SV_MAGIC, 4);
+    p[4] = SV_VERSION & 0xff;
+    p[5] = SV_VERSION>>8;
+    p[6] = SV_STATE_SIZE & 0xff;
+    p[7] = SV_STATE_SIZE>>8;
+
+    for(int i=0; i<4; i++) {
+        p[8+i] = (uint32_t)MEM_SIZE>>(8*i);
+        p[12+i] = 0;
+    }
+}
+
+/*---------------------------------------------------*/
+/* brief: write the board to filename in one call */
+/* the file is written aside and renamed, an old one stays whole */
+/*---------------------------------------*/
+int sv_save(struct machine_t* m, const char* filename) {
+    uint8_t state[SV_STATE_SIZE];
+    struct iovec iov[1+MEM_PAGES];
+    char tmp[4096];
+
+    sv_header(state);
+    cpu_save_state(&m->cpu, state+SV_HEADER_SIZE);
+    machine_save_devices(m, state+SV_HEADER_SIZE+CPU_STATE_SIZE);
+
+    iov[0].iov_base = state;
+    iov[0].iov_len = sizeof(state);
+    for(int p=0; p<MEM_PAGES; p++) {
+        iov[1+p].iov_base = m->mem.pages[p]->data;
+        iov[1+p].iov_len = MEM_PAGE_SIZE;
+    }
+
+    if(snprintf(tmp, sizeof(tmp), "%s.tmp", filename)>=(int)sizeof(tmp))
+        return 1;
+
+    int fd = open(tmp, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+    if(fd<0)
+        return 1;
+
+    int rc = writev(fd, iov, 1+MEM_PAGES)!=SV_FILE_SIZE;
+    rc |= close(fd)!=0;
+
+    if(rc==0)
+        rc = rename(tmp, filename)!=0;
+    else
+        remove(tmp);
+
+    return rc;
+}
+
+/*---------------------------------------------------*/
+/* brief: replace the board with the one saved in filename */
+/* one read fills the registers and fresh pages, the machine is left */
+/* as it was unless the whole file is of this version */
+/*---------------------------------------*/
+int sv_load(struct machine_t* m, const char* filename) {
+    uint8_t state[SV_STATE_SIZE];
+    uint8_t expect[SV_HEADER_SIZE];
+    struct iovec iov[1+MEM_PAGES];
+    struct mem_page_t* pages[MEM_PAGES];
+    struct stat sb;
+    int rc = 0;
+    int p;
+
+    int fd = open(filename, O_RDONLY);
+    if(fd<0)
+        return 1;
+
+    if(fstat(fd, &sb)!=0 || sb.st_size!=SV_FILE_SIZE) {
+        close(fd);
+        return 1;
+    }
+
+    iov[0].iov_base = state;
+    iov[0].iov_len = sizeof(state);
+    for(p=0; p<MEM_PAGES; p++) {
+        if((pages[p] = malloc(sizeof(*pages[p])))==NULL) {
+            rc = 1;
+            break;
+        }
+        pages[p]->refs = 1;
+        pages[p]->pooled = false;
+        iov[1+p].iov_base = pages[p]->data;
+        iov[1+p].iov_len = MEM_PAGE_SIZE;
+    }
+
+    if(rc==0)
+        rc = readv(fd, iov, 1+MEM_PAGES)!=SV_FILE_SIZE;
+    close(fd);
+
+    sv_header(expect);
+    if(rc==0)
+        rc = memcmp(state, expect, SV_HEADER_SIZE)!=0;
+
+    if(rc!=0) {
+        while(p-->0) {
+            free(pages[p]);
+        }
+        return 1;
+    }
+
+    for(p=0; p<MEM_PAGES; p++) {
+        mem_page_replace(&m->mem, p, pages[p]);
+    }
+    cpu_load_state(&m->cpu, state+SV_HEADER_SIZE);
+    machine_load_devices(m, state+SV_HEADER_SIZE+CPU_STATE_SIZE);
+
+    // the inputs still to come are those after the cycle loaded
+    machine_replay(m, m->replay);
+
+    return 0;
+}
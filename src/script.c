@@ -0,0 +1,227 @@
+#include <script.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <machine.h>
+
+/* the next word of the line at p, NULL at its end */
+static char* sc_word(char** p) {
+    char* w = *p+strspn(*p, " \t");
+    char* end = w+strcspn(w, " \t");
+
+    *p = *end!='\0' ? end+1 : end;
+    *end = '\0';
+
+    return *w!='\0' ? w : NULL;
+}
+
+/* a cycle count or a value, decimal, $hex or 0x hex */
+static int sc_number(const char* w, uint64_t* val) {
+    char* end;
+
+    if(w==NULL)
+        return 1;
+
+    *val = w[0]=='$' ? strtoull(w+1, &end, 16) : strtoull(w, &end, 0);
+
+    return end==w || *end!='\0';
+}
+
+/*---------------------------------------------------*/
+/* brief: compile one line, the input first, then its timing */
+/*---------------------------------------*/
+static int sc_parse(struct sc_rule_t* r, char* line, char* err, size_t n) {
+    char* p = line;
+    char* w = sc_word(&p);
+    bool has_at = false;
+    uint64_t val;
+
+    memset(r, 0, sizeof(*r));
+    r->fire_at = SC_NEVER;
+    r->release_at = SC_NEVER;
+
+    if(strcasecmp(w, "press")==0 || strcasecmp(w, "release")==0) {
+        r->device = INPUT_BUTTON;
+        r->value = strcasecmp(w, "press")==0;
+    } else {
+        while(r->device<INPUT_DEVICES
+            && strcasecmp(w, INPUT_DEVICE_NAMES[r->device])!=0)
+        {
+            r->device++;
+        }
+
+        if(r->device==INPUT_DEVICES || sc_number(sc_word(&p), &val)!=0 || val>0xff) {
+            snprintf(err, n, "expected press, release or a device and a value");
+            return 1;
+        }
+        r->value = val;
+    }
+
+    while((w = sc_word(&p))!=NULL) {
+        uint64_t* field = NULL;
+
+        // the condition is the rest of the line
+        if(strcasecmp(w, "when")==0) {
+            r->when = true;
+            if(cond_compile(&r->cond, p, err, n)!=0)
+                return 1;
+            break;
+        }
+
+        if(strcasecmp(w, "at")==0) {
+            field = &r->fire_at;
+            has_at = true;
+        } else if(strcasecmp(w, "for")==0)
+            field = &r->hold;
+        else if(strcasecmp(w, "every")==0)
+            field = &r->every;
+        else if(strcasecmp(w, "after")==0)
+            field = &r->delay;
+
+        if(strcasecmp(w, "times")==0) {
+            if(sc_number(sc_word(&p), &val)!=0 || val==0) {
+                snprintf(err, n, "expected a count after times");
+                return 1;
+            }
+            r->times = val;
+        } else if(field==NULL || sc_number(sc_word(&p), field)!=0) {
+            snprintf(err, n, field==NULL ? "unknown word %s" : "expected cycles after %s", w);
+            return 1;
+        }
+    }
+
+    if(has_at==r->when)
+        snprintf(err, n, "expected either at or when");
+    else if(r->hold && (r->device!=INPUT_BUTTON || r->value!=1))
+        snprintf(err, n, "only a press can be held for some cycles");
+    else if(r->every && (r->when || r->every<=r->hold))
+        snprintf(err, n, "every needs at and more cycles than for");
+    else if(r->delay && !r->when)
+        snprintf(err, n, "after needs when");
+    else if(r->times && !r->every && !r->when)
+        snprintf(err, n, "times needs every or when");
+    else
+        return 0;
+
+    return 1;
+}
+
+/*---------------------------------------------------*/
+/* brief: compile the rules of a script, one per line */
+/* blank lines and # comments are skipped, err tells the line at fault */
+/*---------------------------------------*/
+int sc_load(struct script_t* s, const char* filename, char* err, size_t n) {
+    char line[256];
+    char msg[96];
+    int number = 0;
+    int rc = 0;
+
+    memset(s, 0, sizeof(*s));
+    input_log_init(&s->applied);
+
+    FILE* fp = fopen(filename, "r");
+    if(fp==NULL) {
+        snprintf(err, n, "cannot read %s", filename);
+        return 1;
+    }
+
+    while(rc==0 && fgets(line, sizeof(line), fp)!=NULL) {
+        number++;
+
+        line[strcspn(line, "#\r\n")] = '\0';
+        if(line[strspn(line, " \t")]=='\0')
+            continue;
+
+        if(s->n_rules==SC_MAX_RULES) {
+            snprintf(msg, sizeof(msg), "more than %d rules", SC_MAX_RULES);
+            rc = 1;
+        } else {
+            rc = sc_parse(&s->rules[s->n_rules++], line, msg, sizeof(msg));
+        }
+
+        if(rc!=0)
+            snprintf(err, n, "%s:%d: %s", filename, number, msg);
+    }
+
+    fclose(fp);
+
+    return rc;
+}
+
+/*---------------------------------------------------*/
+/* brief: release the inputs applied */
+/*---------------------------------------*/
+void sc_dispose(struct script_t* s) {
+    input_log_dispose(&s->applied);
+}
+
+/*---------------------------------------------------*/
+/* brief: let machine_feed drive the inputs of m from now on */
+/*---------------------------------------*/
+void sc_attach(struct script_t* s, struct machine_t* m) {
+    m->script = s;
+    m->next_input = 0;
+}
+
+static void sc_apply(
+    struct script_t* s, struct machine_t* m, uint8_t device, uint8_t value)
+{
+    machine_input(m, device, value);
+    input_log_append(&s->applied, m->cpu.cycles, device, value);
+}
+
+static bool sc_can_fire(struct sc_rule_t* r) {
+    return r->times==0 || r->fired<r->times;
+}
+
+/*---------------------------------------------------*/
+/* brief: apply the inputs due by now */
+/* return the cycle of the next one, now while a condition is watched, */
+/* so the armed conditions are evaluated between every two instructions */
+/*---------------------------------------*/
+uint64_t sc_feed(struct script_t* s, struct machine_t* m) {
+    uint64_t now = m->cpu.cycles;
+    uint64_t next = SC_NEVER;
+
+    // releases come first, a press due at the same cycle wins
+    for(int i=0; i<s->n_rules; i++) {
+        struct sc_rule_t* r = &s->rules[i];
+
+        // registers, ram and the devices change with any instruction
+        if(r->when && sc_can_fire(r)) {
+            bool is_true = cond_eval(&r->cond, &m->cpu, &m->mem)!=0;
+
+            if(is_true && !r->was_true && r->fire_at==SC_NEVER)
+                r->fire_at = now+r->delay;
+            r->was_true = is_true;
+        }
+
+        if(r->release_at<=now) {
+            sc_apply(s, m, r->device, 0);
+            r->release_at = SC_NEVER;
+        }
+    }
+
+    for(int i=0; i<s->n_rules; i++) {
+        struct sc_rule_t* r = &s->rules[i];
+
+        if(r->fire_at<=now) {
+            sc_apply(s, m, r->device, r->value);
+            r->fired++;
+
+            if(r->hold)
+                r->release_at = now+r->hold;
+            r->fire_at = r->every && sc_can_fire(r) ? r->fire_at+r->every : SC_NEVER;
+        }
+
+        if(r->fire_at<next)
+            next = r->fire_at;
+        if(r->release_at<next)
+            next = r->release_at;
+        if(r->when && sc_can_fire(r))
+            next = now;
+    }
+
+    return next;
+}
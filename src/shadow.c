@@ -0,0 +1,212 @@
+#include <shadow.h>
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+
+#ifdef __linux__
+
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+/* the handler has no argument, one shadow at a time */
+static struct shadow_t* shadow_active = NULL;
+static struct sigaction shadow_old_action;
+
+static void shadow_on_fault(int sig, siginfo_t* info, void* uctx) {
+    struct shadow_t* s = shadow_active;
+    uint8_t* addr = info->si_addr;
+
+    for(int p=0; s!=NULL && p<MEM_PAGES; p++) {
+        uint8_t* data = s->maps[p]!=NULL ? s->maps[p]+s->host_page : NULL;
+
+        if(data==NULL || addr<data || addr>=data+MEM_PAGE_SIZE)
+            continue;
+
+        if(s->n_faults<SHADOW_MAX_PENDING) {
+            struct shadow_fault_t* f = &s->faults[s->n_faults++];
+            f->page = p;
+            f->addr = p<<8 | (addr-data);
+            memcpy(f->old, data, MEM_PAGE_SIZE);
+        }
+
+        mprotect(data, s->host_page, PROT_READ|PROT_WRITE);
+        return;
+    }
+
+    // not a watched page, fault again with the previous handler
+    sigaction(SIGSEGV, &shadow_old_action, NULL);
+}
+
+/*---------------------------------------------------*/
+/* brief: take over the write faults for the pages of mem */
+/*---------------------------------------*/
+int shadow_init(struct shadow_t* s, struct mem* mem) {
+    memset(s, 0, sizeof(*s));
+
+    if(shadow_active!=NULL)
+        return 1;
+
+    s->mem = mem;
+    s->host_page = sysconf(_SC_PAGESIZE);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = shadow_on_fault;
+    sa.sa_flags = SA_SIGINFO;
+    sigemptyset(&sa.sa_mask);
+
+    if(sigaction(SIGSEGV, &sa, &shadow_old_action)!=0)
+        return 1;
+
+    shadow_active = s;
+
+    return 0;
+}
+
+/*---------------------------------------------------*/
+/* brief: put every page back on the heap and the handler back */
+/*---------------------------------------*/
+void shadow_dispose(struct shadow_t* s) {
+    if(shadow_active!=s)
+        return;
+
+    for(int p=0; p<MEM_PAGES; p++) {
+        shadow_protect(s, p, false);
+    }
+
+    sigaction(SIGSEGV, &shadow_old_action, NULL);
+    shadow_active = NULL;
+}
+
+/* the page header sits at the end of the first host page of the mapping */
+static struct mem_page_t* shadow_page(struct shadow_t* s, int page) {
+    uint8_t* data = s->maps[page]+s->host_page;
+
+    return (struct mem_page_t*)(data-offsetof(struct mem_page_t, data));
+}
+
+/*---------------------------------------------------*/
+/* brief: move page to its own read-only host page, or back */
+/*---------------------------------------*/
+int shadow_protect(struct shadow_t* s, int page, bool on) {
+    struct mem* mem = s->mem;
+
+    if(on==(s->maps[page]!=NULL))
+        return 0;
+
+    if(!on) {
+        struct mem_page_t* shadow = shadow_page(s, page);
+        mprotect(shadow->data, s->host_page, PROT_READ|PROT_WRITE);
+
+        // copied on write since it was shared, mem holds its own page already
+        if(mem->pages[page]==shadow) {
+            // held twice, the page is copied to the heap and let go
+            shadow->refs++;
+            mem_page_own(mem, page);
+            shadow->refs--;
+        }
+
+        // the memories sharing it keep the mapping, it is never freed
+        if(shadow->refs==0)
+            munmap(s->maps[page], 2*s->host_page);
+        s->maps[page] = NULL;
+
+        for(int i=0; i<s->n_protected; i++) {
+            if(s->protected[i]==page) {
+                s->protected[i] = s->protected[--s->n_protected];
+                break;
+            }
+        }
+        return 0;
+    }
+
+    // the header ends the first host page, the data starts the second
+    uint8_t* map = mmap(NULL, 2*s->host_page, PROT_READ|PROT_WRITE,
+        MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if(map==MAP_FAILED)
+        return 1;
+
+    s->maps[page] = map;
+    s->protected[s->n_protected++] = page;
+
+    struct mem_page_t* shadow = shadow_page(s, page);
+    shadow->refs = 1;
+    shadow->pooled = true;
+    memcpy(shadow->data, mem->pages[page]->data, MEM_PAGE_SIZE);
+
+    mem_page_replace(mem, page, shadow);
+
+    if(mprotect(shadow->data, s->host_page, PROT_READ)!=0) {
+        shadow_protect(s, page, false);
+        return 1;
+    }
+
+    return 0;
+}
+
+/*---------------------------------------------------*/
+/* brief: protect again the pages the last instruction wrote */
+/* return the number of faults, left in faults for the caller */
+/*---------------------------------------*/
+int shadow_collect(struct shadow_t* s) {
+    for(int i=0; i<s->n_faults; i++) {
+        int p = s->faults[i].page;
+
+        if(s->maps[p]!=NULL)
+            mprotect(s->maps[p]+s->host_page, s->host_page, PROT_READ);
+    }
+
+    // a store to a page shared by a snapshot copies it without a fault,
+    // the shadow still holds the page as it was: the copy is moved to a
+    // new shadow, backwards as that puts the page last in protected
+    for(int i=s->n_protected-1; i>=0; i--) {
+        int p = s->protected[i];
+        struct mem_page_t* shadow = shadow_page(s, p);
+        uint8_t* data = s->mem->pages[p]->data;
+
+        if(s->mem->pages[p]==shadow)
+            continue;
+
+        if(s->n_faults<SHADOW_MAX_PENDING) {
+            struct shadow_fault_t* f = &s->faults[s->n_faults++];
+            int a = 0;
+
+            while(a<MEM_PAGE_SIZE-1 && data[a]==shadow->data[a]) {
+                a++;
+            }
+
+            f->page = p;
+            f->addr = p<<8 | a;
+            memcpy(f->old, shadow->data, MEM_PAGE_SIZE);
+        }
+
+        shadow_protect(s, p, false);
+        shadow_protect(s, p, true);
+    }
+
+    int n = s->n_faults;
+    s->n_faults = 0;
+
+    return n;
+}
+
+#else
+
+int shadow_init(struct shadow_t* s, struct mem* mem) {
+    memset(s, 0, sizeof(*s));
+    return 1;
+}
+
+void shadow_dispose(struct shadow_t* s) {
+}
+
+int shadow_protect(struct shadow_t* s, int page, bool on) {
+    return 1;
+}
+
+int shadow_collect(struct shadow_t* s) {
+    return 0;
+}
+
+#endif
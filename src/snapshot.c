@@ -0,0 +1,35 @@
+#include <snapshot.h>
+#include <string.h>
+
+/*---------------------------------------------------*/
+/* brief: capture cpu, devices and memory without copying the pages */
+/*---------------------------------------*/
+void snapshot_take(struct snapshot_t* snap, struct machine_t* m) {
+    memcpy(&snap->cpu, &m->cpu, sizeof(m->cpu));
+    memcpy(&snap->lcd, &m->lcd, sizeof(m->lcd));
+    memcpy(&snap->via, &m->via, sizeof(m->via));
+    mem_clone(&snap->mem, &m->mem);
+}
+
+/*---------------------------------------------------*/
+/* brief: bring cpu, devices and memory back to the snapshot */
+/*---------------------------------------*/
+void snapshot_restore(struct snapshot_t* snap, struct machine_t* m) {
+    unsigned long version = m->lcd.version;
+
+    memcpy(&m->cpu, &snap->cpu, sizeof(m->cpu));
+    memcpy(&m->lcd, &snap->lcd, sizeof(m->lcd));
+    memcpy(&m->via, &snap->via, sizeof(m->via));
+    mem_dispose(&m->mem);
+    mem_share(&m->mem, &snap->mem);
+
+    // what was drawn may not be what the snapshot shows
+    m->lcd.version = version+1;
+}
+
+/*---------------------------------------------------*/
+/* brief: release the pages held by the snapshot */
+/*---------------------------------------*/
+void snapshot_dispose(struct snapshot_t* snap) {
+    mem_dispose(&snap->mem);
+}
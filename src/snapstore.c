@@ -0,0 +1,307 @@
+#include <snapstore.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <trace.h>
+
+static void ss_put64(uint8_t* p, uint64_t v) {
+    for(int i=0; i<8; i++) {
+        p[i] = v>>(8*i);
+    }
+}
+
+static uint64_t ss_get64(const uint8_t* p) {
+    uint64_t v = 0;
+
+    for(int i=0; i<8; i++) {
+        v |= (uint64_t)p[i]<<(8*i);
+    }
+
+    return v;
+}
+
+/* the slot holding hash, or the free one where it would go */
+static size_t ss_slot(struct snapstore_t* st, uint64_t hash) {
+    size_t i = hash & (st->cap-1);
+
+    while(st->slots[i]!=0 && st->hashes[i]!=hash) {
+        i = (i+1) & (st->cap-1);
+    }
+
+    return i;
+}
+
+static int ss_grow(struct snapstore_t* st, size_t cap) {
+    uint64_t* hashes = calloc(cap, sizeof(*hashes));
+    uint32_t* slots = calloc(cap, sizeof(*slots));
+
+    if(hashes==NULL || slots==NULL) {
+        free(hashes);
+        free(slots);
+        return 1;
+    }
+
+    uint64_t* old_hashes = st->hashes;
+    uint32_t* old_slots = st->slots;
+    size_t old_cap = st->cap;
+
+    st->hashes = hashes;
+    st->slots = slots;
+    st->cap = cap;
+
+    for(size_t i=0; i<old_cap; i++) {
+        if(old_slots[i]!=0) {
+            size_t k = ss_slot(st, old_hashes[i]);
+            st->hashes[k] = old_hashes[i];
+            st->slots[k] = old_slots[i];
+        }
+    }
+
+    free(old_hashes);
+    free(old_slots);
+
+    return 0;
+}
+
+/* index page under hash, keeping the table at most half full */
+static int ss_index(struct snapstore_t* st, uint64_t hash, uint32_t page) {
+    if((page+1)*2>st->cap && ss_grow(st, st->cap*2)!=0)
+        return 1;
+
+    size_t k = ss_slot(st, hash);
+    if(st->slots[k]==0) {
+        st->hashes[k] = hash;
+        st->slots[k] = page+1;
+    }
+
+    return 0;
+}
+
+/*---------------------------------------------------*/
+/* brief: open the store in dir, creating it if needed */
+/*---------------------------------------*/
+int ss_open(struct snapstore_t* st, const char* dir) {
+    char path[SS_MAX_NAME+16];
+    struct stat sb;
+
+    memset(st, 0, sizeof(*st));
+    st->pack = -1;
+    snprintf(st->dir, sizeof(st->dir), "%s", dir);
+
+    if(mkdir(dir, 0777)!=0 && errno!=EEXIST)
+        return 1;
+
+    snprintf(path, sizeof(path), "%s/%s", dir, SS_PACK);
+    st->pack = open(path, O_RDWR|O_CREAT, 0644);
+    if(st->pack<0 || fstat(st->pack, &sb)!=0)
+        return 1;
+
+    // a page cut short by a crash is dropped
+    st->n_pages = sb.st_size/MEM_PAGE_SIZE;
+    if(sb.st_size%MEM_PAGE_SIZE!=0
+        && ftruncate(st->pack, (off_t)st->n_pages*MEM_PAGE_SIZE)!=0)
+    {
+        return 1;
+    }
+
+    size_t cap = 1024;
+    while(cap<2*(size_t)st->n_pages+2) {
+        cap *= 2;
+    }
+    if(ss_grow(st, cap)!=0)
+        return 1;
+
+    if(st->n_pages==0)
+        return 0;
+
+    size_t size = (size_t)st->n_pages*MEM_PAGE_SIZE;
+    uint8_t* pack = mmap(NULL, size, PROT_READ, MAP_PRIVATE, st->pack, 0);
+    if(pack==MAP_FAILED)
+        return 1;
+
+    int rc = 0;
+    for(uint32_t i=0; i<st->n_pages && rc==0; i++) {
+        rc = ss_index(st, trace_hash(pack+(size_t)i*MEM_PAGE_SIZE, MEM_PAGE_SIZE), i);
+    }
+
+    munmap(pack, size);
+
+    return rc;
+}
+
+/*---------------------------------------------------*/
+/* brief: close the pack and free the index */
+/*---------------------------------------*/
+void ss_close(struct snapstore_t* st) {
+    if(st->pack>=0)
+        close(st->pack);
+
+    free(st->hashes);
+    free(st->slots);
+    memset(st, 0, sizeof(*st));
+    st->pack = -1;
+}
+
+static int ss_manifest_path(
+    struct snapstore_t* st, const char* name, char* path, size_t n)
+{
+    if(name[0]=='\0' || name[0]=='.' || strchr(name, '/')!=NULL)
+        return 1;
+
+    return snprintf(path, n, "%s/%s.snap", st->dir, name)>=(int)n-4;
+}
+
+/*---------------------------------------------------*/
+/* brief: store the state as name, writing only the pages not in the pack */
+/* added counts them, a snapshot with the same name is replaced */
+/*---------------------------------------*/
+int ss_put(
+    struct snapstore_t* st, const char* name, struct machine_t* m, int* added)
+{
+    uint8_t manifest[SS_MANIFEST_SIZE];
+    uint8_t stored[MEM_PAGE_SIZE];
+    char path[SS_MAX_NAME+16];
+    char tmp[SS_MAX_NAME+20];
+
+    *added = 0;
+
+    if(ss_manifest_path(st, name, path, sizeof(path))!=0)
+        return 1;
+
+    memcpy(manifest, SS_MAGIC, 4);
+    manifest[4] = SS_VERSION & 0xff;
+    manifest[5] = SS_VERSION>>8;
+    manifest[6] = 0;
+    manifest[7] = 0;
+    cpu_save_state(&m->cpu, manifest+8);
+    machine_save_devices(m, manifest+8+CPU_STATE_SIZE);
+
+    for(int p=0; p<MEM_PAGES; p++) {
+        const uint8_t* data = m->mem.pages[p]->data;
+        uint64_t hash = trace_hash(data, MEM_PAGE_SIZE);
+        size_t k = ss_slot(st, hash);
+
+        if(st->slots[k]!=0) {
+            // a hash naming two pages would silently load the wrong one
+            off_t at = (off_t)(st->slots[k]-1)*MEM_PAGE_SIZE;
+            if(pread(st->pack, stored, MEM_PAGE_SIZE, at)!=MEM_PAGE_SIZE
+                || memcmp(stored, data, MEM_PAGE_SIZE)!=0)
+            {
+                return 1;
+            }
+        } else {
+            off_t at = (off_t)st->n_pages*MEM_PAGE_SIZE;
+            if(pwrite(st->pack, data, MEM_PAGE_SIZE, at)!=MEM_PAGE_SIZE
+                || ss_index(st, hash, st->n_pages)!=0)
+            {
+                return 1;
+            }
+            st->n_pages++;
+            (*added)++;
+        }
+
+        ss_put64(manifest+SS_HEADER_SIZE+8*p, hash);
+    }
+
+    // the old manifest stays whole until the new one replaces it
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE* fp = fopen(tmp, "wb");
+    if(fp==NULL)
+        return 1;
+
+    int rc = fwrite(manifest, 1, sizeof(manifest), fp)!=sizeof(manifest);
+    rc |= fclose(fp)!=0;
+
+    if(rc==0)
+        rc = rename(tmp, path)!=0;
+    else
+        remove(tmp);
+
+    return rc;
+}
+
+/*---------------------------------------------------*/
+/* brief: load the snapshot name into the machine */
+/* only the pages it names are read, equal ones shared copy-on-write */
+/*---------------------------------------*/
+int ss_get(
+    struct snapstore_t* st, const char* name, struct machine_t* m)
+{
+    uint8_t manifest[SS_MANIFEST_SIZE];
+    char path[SS_MAX_NAME+16];
+    uint32_t index[MEM_PAGES];
+    struct mem_page_t* pages[MEM_PAGES];
+
+    if(ss_manifest_path(st, name, path, sizeof(path))!=0)
+        return 1;
+
+    FILE* fp = fopen(path, "rb");
+    if(fp==NULL)
+        return 1;
+
+    size_t n = fread(manifest, 1, sizeof(manifest), fp);
+    fclose(fp);
+
+    if(n!=sizeof(manifest) || memcmp(manifest, SS_MAGIC, 4)!=0
+        || (manifest[4] | manifest[5]<<8)!=SS_VERSION)
+    {
+        return 1;
+    }
+
+    for(int p=0; p<MEM_PAGES; p++) {
+        size_t k = ss_slot(st, ss_get64(manifest+SS_HEADER_SIZE+8*p));
+
+        if(st->slots[k]==0)
+            return 1;
+        index[p] = st->slots[k]-1;
+    }
+
+    int rc = 0;
+    int p;
+    for(p=0; p<MEM_PAGES; p++) {
+        int same = 0;
+        while(same<p && index[same]!=index[p]) {
+            same++;
+        }
+
+        if(same<p) {
+            pages[p] = pages[same];
+        } else if((pages[p] = malloc(sizeof(*pages[p])))!=NULL) {
+            // read rather than mapped, the refs go right before the data
+            off_t at = (off_t)index[p]*MEM_PAGE_SIZE;
+            pages[p]->refs = 0;
+            pages[p]->pooled = false;
+
+            if(pread(st->pack, pages[p]->data, MEM_PAGE_SIZE, at)!=MEM_PAGE_SIZE) {
+                free(pages[p]);
+                rc = 1;
+                break;
+            }
+        } else {
+            rc = 1;
+            break;
+        }
+        pages[p]->refs++;
+    }
+
+    if(rc!=0) {
+        while(p-->0) {
+            if(--pages[p]->refs==0)
+                free(pages[p]);
+        }
+        return 1;
+    }
+
+    for(p=0; p<MEM_PAGES; p++) {
+        mem_page_replace(&m->mem, p, pages[p]);
+    }
+    cpu_load_state(&m->cpu, manifest+8);
+    machine_load_devices(m, manifest+8+CPU_STATE_SIZE);
+
+    return 0;
+}
@@ -0,0 +1,376 @@
+#include <sweep.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <input.h>
+
+static int sweep_is_scenario(const struct dirent* e) {
+    size_t len = strlen(e->d_name);
+
+    return e->d_name[0]!='.' && len>4 && strcmp(e->d_name+len-4, ".txt")==0;
+}
+
+/*---------------------------------------------------*/
+/* brief: list the *.txt input schedules of dir, sorted by name */
+/*---------------------------------------*/
+int sweep_init(struct sweep_t* s, char* rom, char* dir, struct breakpoints_t* bp) {
+    struct dirent** list;
+
+    memset(s, 0, sizeof(*s));
+    s->rom = rom;
+    s->bp = bp;
+
+    int n = scandir(dir, &list, sweep_is_scenario, alphasort);
+    if(n<0)
+        return 1;
+
+    s->scenarios = calloc(n ? n : 1, sizeof(*s->scenarios));
+
+    for(int i=0; i<n; i++) {
+        size_t len = strlen(dir)+strlen(list[i]->d_name)+2;
+
+        if(s->scenarios!=NULL && (s->scenarios[i] = malloc(len))!=NULL) {
+            snprintf(s->scenarios[i], len, "%s/%s", dir, list[i]->d_name);
+            s->n_scenarios++;
+        }
+        free(list[i]);
+    }
+    free(list);
+
+    return s->n_scenarios!=n;
+}
+
+static void sweep_free_results(struct sweep_t* s) {
+    if(s->shared && s->results!=NULL)
+        munmap(s->results, (s->n_jobs ? s->n_jobs : 1)*sizeof(*s->results));
+    else
+        free(s->results);
+
+    s->results = NULL;
+    s->shared = false;
+}
+
+/*---------------------------------------------------*/
+/* brief: count the jobs and clear their results */
+/* shared results are seen by the processes forked after */
+/*---------------------------------------*/
+static int sweep_prepare(struct sweep_t* s, bool shared) {
+    sweep_free_results(s);
+
+    if(s->n_limits==0) {
+        s->limits[0] = SWEEP_DEFAULT_CYCLES;
+        s->n_limits = 1;
+    }
+
+    s->n_jobs = s->n_scenarios*s->n_limits;
+    s->next = 0;
+
+    size_t size = (s->n_jobs ? s->n_jobs : 1)*sizeof(*s->results);
+
+    if(shared) {
+        s->results = mmap(NULL, size, PROT_READ|PROT_WRITE, 
+            MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+        if(s->results==MAP_FAILED)
+            s->results = NULL;
+        s->shared = s->results!=NULL;
+    } else {
+        s->results = calloc(1, size);
+    }
+
+    return s->results==NULL;
+}
+
+/*---------------------------------------------------*/
+/* brief: release the scenario names and the results */
+/*---------------------------------------*/
+void sweep_dispose(struct sweep_t* s) {
+    for(size_t i=0; i<s->n_scenarios; i++) {
+        free(s->scenarios[i]);
+    }
+    free(s->scenarios);
+    sweep_free_results(s);
+}
+
+/*---------------------------------------------------*/
+/* brief: set the cycle limits from a comma separated list */
+/*---------------------------------------*/
+int sweep_parse_limits(struct sweep_t* s, const char* list) {
+    const char* p = list;
+
+    s->n_limits = 0;
+
+    while(*p!='\0') {
+        char* end;
+        unsigned long long limit = strtoull(p, &end, 0);
+
+        if(end==p || s->n_limits==SWEEP_MAX_LIMITS || (*end!=',' && *end!='\0'))
+            return 1;
+
+        s->limits[s->n_limits++] = limit;
+        p = *end==',' ? end+1 : end;
+    }
+
+    return s->n_limits==0;
+}
+
+/* fnv-1a of the whole memory, as trace_hash page after page */
+static uint64_t sweep_digest(struct mem* mem) {
+    uint64_t h = 0xcbf29ce484222325ull;
+
+    for(int p=0; p<MEM_PAGES; p++) {
+        const uint8_t* data = mem->pages[p]->data;
+
+        for(int i=0; i<MEM_PAGE_SIZE; i++) {
+            h = (h^data[i])*0x100000001b3ull;
+        }
+    }
+
+    return h;
+}
+
+/*---------------------------------------------------*/
+/* brief: run one job on the machine of the worker */
+/* a fork goes on from the state of m, its schedule and limit after it */
+/*---------------------------------------*/
+static void sweep_job(
+    struct sweep_t* s, struct machine_t* m, 
+    struct input_log_t* log, size_t job, bool fork)
+{
+    struct sweep_result_t* res = &s->results[job];
+    uint64_t base = fork ? m->cpu.cycles : 0;
+    unsigned long n = 0;
+
+    res->scenario = s->scenarios[job/s->n_limits];
+    res->limit = s->limits[job%s->n_limits];
+
+    input_log_clear(log);
+    if(input_log_load(log, res->scenario)!=0) {
+        res->stop = "bad input";
+        return;
+    }
+
+    if(!fork)
+        machine_restart(m);
+    for(size_t i=0; i<log->n_events; i++) {
+        log->events[i].cycle += base;
+    }
+    machine_replay(m, log);
+
+    // a fork stopped on a breakpoint goes past it first
+    if(fork && s->bp!=NULL && bp_test(s->bp, m->cpu.PC) && m->cpu.is_running) {
+        machine_step(m);
+        res->steps++;
+    }
+
+    enum machine_stop_e stop = machine_run_to(m, base+res->limit, s->bp, &n);
+
+    res->stop = MACHINE_STOP_NAMES[stop];
+    res->steps += n;
+    res->cycles = m->cpu.cycles;
+    trace_get_regs(&m->cpu, &res->regs);
+    res->digest = sweep_digest(&m->mem);
+}
+
+/* takes jobs until none is left, sharing nothing but the counter */
+static void* sweep_worker(void* arg) {
+    struct sweep_t* s = arg;
+    struct machine_t m;
+    struct input_log_t log;
+
+    input_log_init(&log);
+
+    if(machine_init(&m, s->rom)==0) {
+        while(true) {
+            size_t job = __atomic_fetch_add(&s->next, 1, __ATOMIC_RELAXED);
+
+            if(job>=s->n_jobs)
+                break;
+            sweep_job(s, &m, &log, job, false);
+        }
+    }
+
+    machine_dispose(&m);
+    input_log_dispose(&log);
+
+    return NULL;
+}
+
+/*---------------------------------------------------*/
+/* brief: run every scenario at every limit on workers threads */
+/*---------------------------------------*/
+int sweep_run(struct sweep_t* s, int workers) {
+    pthread_t threads[SWEEP_MAX_WORKERS];
+
+    if(sweep_prepare(s, false)!=0)
+        return 1;
+
+    if(workers<1)
+        workers = 1;
+    if(workers>SWEEP_MAX_WORKERS)
+        workers = SWEEP_MAX_WORKERS;
+
+    int started = 0;
+    while(started<workers) {
+        if(pthread_create(&threads[started], NULL, sweep_worker, s)!=0)
+            break;
+        started++;
+    }
+
+    // with no thread at all the jobs run here
+    if(started==0)
+        sweep_worker(s);
+
+    for(int i=0; i<started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    // a worker that cannot load the rom leaves its jobs unset
+    for(size_t i=0; i<s->n_jobs; i++) {
+        if(s->results[i].stop==NULL)
+            return 1;
+    }
+
+    return 0;
+}
+
+/*---------------------------------------------------*/
+/* brief: run every scenario from the state of m, each in a process */
+/* forked from this one, so m is shared copy-on-write by the kernel */
+/*---------------------------------------*/
+int sweep_explore(struct sweep_t* s, struct machine_t* m, int workers) {
+    pid_t pids[SWEEP_MAX_WORKERS];
+    size_t jobs[SWEEP_MAX_WORKERS];
+    int running = 0;
+    int rc = 0;
+
+    if(sweep_prepare(s, true)!=0)
+        return 1;
+
+    if(workers<1)
+        workers = 1;
+    if(workers>SWEEP_MAX_WORKERS)
+        workers = SWEEP_MAX_WORKERS;
+
+    // buffered output would be written again by every child
+    fflush(stdout);
+    fflush(stderr);
+
+    while(s->next<s->n_jobs || running>0) {
+        if(s->next<s->n_jobs && running<workers) {
+            pid_t pid = fork();
+
+            if(pid==0) {
+                struct input_log_t log;
+
+                input_log_init(&log);
+                sweep_job(s, m, &log, s->next, true);
+                _exit(0);
+            }
+
+            if(pid>0) {
+                pids[running] = pid;
+                jobs[running++] = s->next++;
+                continue;
+            }
+
+            // out of processes, wait for one to end or give up
+            if(running==0) {
+                rc = 1;
+                break;
+            }
+        }
+
+        int status;
+        pid_t done = wait(&status);
+        if(done<0) {
+            rc = 1;
+            break;
+        }
+
+        for(int i=0; i<running; i++) {
+            if(pids[i]!=done)
+                continue;
+
+            if(!WIFEXITED(status) || WEXITSTATUS(status)!=0)
+                s->results[jobs[i]].stop = "crashed";
+
+            pids[i] = pids[--running];
+            jobs[i] = jobs[running];
+            break;
+        }
+    }
+
+    for(size_t i=0; i<s->next; i++) {
+        if(s->results[i].stop==NULL)
+            rc = 1;
+    }
+
+    return rc || s->next<s->n_jobs;
+}
+
+static void sweep_json_string(FILE* fp, const char* str) {
+    fputc('"', fp);
+    for(; *str!='\0'; str++) {
+        if(*str=='"' || *str=='\\')
+            fputc('\\', fp);
+        fputc(*str, fp);
+    }
+    fputc('"', fp);
+}
+
+/*---------------------------------------------------*/
+/* brief: write the results as csv, or json if filename ends with .json */
+/* - writes csv to stdout */
+/*---------------------------------------*/
+int sweep_report(struct sweep_t* s, const char* filename) {
+    size_t len = strlen(filename);
+    bool json = len>5 && strcmp(filename+len-5, ".json")==0;
+    bool to_stdout = strcmp(filename, "-")==0;
+    FILE* fp = to_stdout ? stdout : fopen(filename, "w");
+
+    if(fp==NULL)
+        return 1;
+
+    if(json) {
+        fprintf(fp, "{\"rom\":");
+        sweep_json_string(fp, s->rom);
+        fprintf(fp, ",\"results\":[\n");
+    } else {
+        fprintf(fp, "scenario,limit,stop,steps,cycles,pc,a,x,y,sp,p,digest\n");
+    }
+
+    for(size_t i=0; i<s->n_jobs; i++) {
+        struct sweep_result_t* r = &s->results[i];
+
+        if(json) {
+            fprintf(fp, "{\"scenario\":");
+            sweep_json_string(fp, r->scenario);
+            fprintf(fp, ",\"limit\":%llu,\"stop\":\"%s\",\"steps\":%lu,\"cycles\":%llu,"
+                "\"pc\":%u,\"a\":%u,\"x\":%u,\"y\":%u,\"sp\":%u,\"p\":%u,"
+                "\"digest\":\"%016llx\"}%s\n",
+                (unsigned long long)r->limit, r->stop, r->steps,
+                (unsigned long long)r->cycles,
+                r->regs.PC, r->regs.A, r->regs.X, r->regs.Y, r->regs.SP, r->regs.P,
+                (unsigned long long)r->digest, i+1<s->n_jobs ? "," : "");
+        } else {
+            fprintf(fp, "%s,%llu,%s,%lu,%llu,%04x,%02x,%02x,%02x,%02x,%02x,%016llx\n",
+                r->scenario, (unsigned long long)r->limit, r->stop, r->steps,
+                (unsigned long long)r->cycles,
+                r->regs.PC, r->regs.A, r->regs.X, r->regs.Y, r->regs.SP, r->regs.P,
+                (unsigned long long)r->digest);
+        }
+    }
+
+    if(json)
+        fprintf(fp, "]}\n");
+
+    if(to_stdout)
+        return fflush(fp)!=0;
+
+    return fclose(fp)!=0;
+}
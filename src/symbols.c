@@ -0,0 +1,151 @@
+#include <symbols.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+/*---------------------------------------------------*/
+/* brief: init an empty table, lookups find nothing */
+/*---------------------------------------*/
+void sym_init(struct symbols_t* s) {
+    memset(s, 0, sizeof(*s));
+}
+
+/*---------------------------------------------------*/
+/* brief: release the table */
+/*---------------------------------------*/
+void sym_dispose(struct symbols_t* s) {
+    free(s->syms);
+    memset(s, 0, sizeof(*s));
+}
+
+/*---------------------------------------------------*/
+/* brief: parse $8000, 0x8000 or 8000, nothing else on the token */
+/*---------------------------------------*/
+int sym_parse_addr(const char* tok, uint16_t* addr) {
+    const char* p = tok;
+
+    if(p[0]=='$')
+        p++;
+    else if(p[0]=='0' && (p[1]=='x' || p[1]=='X'))
+        p += 2;
+
+    if(*p=='\0' || strlen(p)>4)
+        return 1;
+
+    for(const char* q=p; *q; q++) {
+        if(!isxdigit((unsigned char)*q))
+            return 1;
+    }
+
+    *addr = strtoul(p, NULL, 16);
+
+    return 0;
+}
+
+static int sym_compare(const void* a, const void* b) {
+    const struct symbol_t* sa = a;
+    const struct symbol_t* sb = b;
+
+    return (int)sa->addr-(int)sb->addr;
+}
+
+/*---------------------------------------------------*/
+/* brief: load "name = $addr", "name $addr" or "addr name" lines */
+/* anything after ';' is a comment, other lines are skipped */
+/*---------------------------------------*/
+int sym_load(struct symbols_t* s, const char* filename) {
+    FILE* fp = fopen(filename, "r");
+
+    if(fp==NULL)
+        return 1;
+
+    size_t cap = s->n;
+    char line[256];
+
+    while(fgets(line, sizeof(line), fp)!=NULL) {
+        char* comment = strchr(line, ';');
+        if(comment!=NULL)
+            *comment = '\0';
+
+        char* tok[3];
+        int n_tok = 0;
+        for(char* t=strtok(line, " \t\r\n=:"); t!=NULL && n_tok<3; 
+            t=strtok(NULL, " \t\r\n=:")) 
+        {
+            tok[n_tok++] = t;
+        }
+
+        if(n_tok!=2)
+            continue;
+
+        struct symbol_t sym;
+        const char* name;
+
+        if(sym_parse_addr(tok[1], &sym.addr)==0)
+            name = tok[0];
+        else if(sym_parse_addr(tok[0], &sym.addr)==0)
+            name = tok[1];
+        else
+            continue;
+
+        // a number is not a name, "8000 8000" says nothing
+        if(!isalpha((unsigned char)name[0]) && name[0]!='_' && name[0]!='.')
+            continue;
+
+        snprintf(sym.name, sizeof(sym.name), "%s", name);
+
+        if(s->n==cap) {
+            cap = cap ? cap*2 : 64;
+            struct symbol_t* syms = realloc(s->syms, cap*sizeof(*syms));
+
+            if(syms==NULL) {
+                fclose(fp);
+                return 1;
+            }
+            s->syms = syms;
+        }
+
+        s->syms[s->n++] = sym;
+    }
+
+    fclose(fp);
+
+    qsort(s->syms, s->n, sizeof(*s->syms), sym_compare);
+
+    return 0;
+}
+
+/*---------------------------------------------------*/
+/* brief: the closest symbol at or below addr, NULL if none */
+/*---------------------------------------*/
+struct symbol_t* sym_find(struct symbols_t* s, uint16_t addr) {
+    size_t lo = 0;
+    size_t hi = s->n;
+
+    while(lo<hi) {
+        size_t mid = lo+(hi-lo)/2;
+        if(s->syms[mid].addr<=addr)
+            lo = mid+1;
+        else
+            hi = mid;
+    }
+
+    return lo>0 ? &s->syms[lo-1] : NULL;
+}
+
+/*---------------------------------------------------*/
+/* brief: addr as name+offset, or as a hex address without symbols */
+/*---------------------------------------*/
+const char* sym_format(struct symbols_t* s, uint16_t addr, char* buf, size_t n) {
+    struct symbol_t* sym = sym_find(s, addr);
+
+    if(sym==NULL)
+        snprintf(buf, n, "$%04x", addr);
+    else if(sym->addr==addr)
+        snprintf(buf, n, "%s", sym->name);
+    else
+        snprintf(buf, n, "%s+%d", sym->name, addr-sym->addr);
+
+    return buf;
+}
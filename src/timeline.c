@@ -0,0 +1,158 @@
+#include <timeline.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*---------------------------------------------------*/
+/* brief: start an event, the caller writes its fields */
+/*---------------------------------------*/
+static void tl_event(struct timeline_t* tl, char ph, uint64_t cycle) {
+    fprintf(tl->fp, "%s\n{\"ph\":\"%c\",\"pid\":1,\"tid\":1,\"ts\":%llu",
+        tl->first ? "" : ",", ph, (unsigned long long)cycle);
+
+    tl->first = false;
+    tl->events++;
+}
+
+/*---------------------------------------------------*/
+/* brief: write addr as a json string naming its symbol */
+/*---------------------------------------*/
+static void tl_name(struct timeline_t* tl, uint16_t addr) {
+    char name[SYM_MAX_NAME+8];
+    sym_format(tl->syms, addr, name, sizeof(name));
+
+    fputc('"', tl->fp);
+    for(char* c=name; *c; c++) {
+        if(*c=='"' || *c=='\\')
+            fputc('\\', tl->fp);
+        if((unsigned char)*c>=0x20)
+            fputc(*c, tl->fp);
+    }
+    fputc('"', tl->fp);
+}
+
+static void tl_begin_slice(
+    struct timeline_t* tl, const char* cat, uint16_t addr, uint64_t cycle) 
+{
+    tl_event(tl, 'B', cycle);
+    fprintf(tl->fp, ",\"cat\":\"%s\",\"name\":", cat);
+    tl_name(tl, addr);
+    fputc('}', tl->fp);
+}
+
+static void tl_end_slices(struct timeline_t* tl, int n, uint64_t cycle) {
+    for(int i=0; i<n; i++) {
+        tl_event(tl, 'E', cycle);
+        fputc('}', tl->fp);
+    }
+}
+
+static const char* tl_port_name(uint16_t addr) {
+    switch(addr) {
+        case MEM_PTA:  return "PTA";
+        case MEM_PTB:  return "PTB";
+        case MEM_DDRA: return "DDRA";
+        case MEM_DDRB: return "DDRB";
+    }
+    return NULL;
+}
+
+static void tl_on_write(void* ctx, uint16_t addr, uint8_t old, uint8_t val) {
+    struct timeline_t* tl = ctx;
+    const char* port = tl_port_name(addr);
+
+    if(port==NULL)
+        return;
+
+    tl_event(tl, 'i', tl->cycle);
+    fprintf(tl->fp, ",\"s\":\"g\",\"cat\":\"io\",\"name\":\"%s\","
+        "\"args\":{\"old\":\"$%02x\",\"val\":\"$%02x\"}}", port, old, val);
+}
+
+/*---------------------------------------------------*/
+/* brief: start the timeline of a run from the state of cpu */
+/* syms must outlive the timeline */
+/*---------------------------------------*/
+int tl_open(
+    struct timeline_t* tl, char* filename, 
+    struct processor_t* cpu, struct mem* mem, struct symbols_t* syms) 
+{
+    memset(tl, 0, sizeof(*tl));
+    tl->syms = syms;
+    tl->first = true;
+
+    tl->fp = fopen(filename, "w");
+    if(tl->fp==NULL)
+        return 1;
+
+    tl->buf = malloc(TL_BUFFER_SIZE);
+    if(tl->buf!=NULL)
+        setvbuf(tl->fp, tl->buf, _IOFBF, TL_BUFFER_SIZE);
+
+    if(cg_init(&tl->cg, cpu->PC)!=0 || mem_add_hook(mem, tl_on_write, tl)!=0) {
+        cg_dispose(&tl->cg);
+        fclose(tl->fp);
+        free(tl->buf);
+        return 1;
+    }
+
+    fprintf(tl->fp, "{\"traceEvents\":[");
+    tl_begin_slice(tl, "call", cpu->PC, cpu->cycles);
+
+    return 0;
+}
+
+/*---------------------------------------------------*/
+/* brief: close the open slices and the file */
+/*---------------------------------------*/
+int tl_close(struct timeline_t* tl, struct processor_t* cpu, struct mem* mem) {
+    mem_remove_hook(mem, tl_on_write, tl);
+
+    tl_end_slices(tl, tl->cg.depth, cpu->cycles);
+    fprintf(tl->fp, "\n]}\n");
+
+    int rc = ferror(tl->fp);
+    if(fclose(tl->fp)!=0)
+        rc = 1;
+
+    cg_dispose(&tl->cg);
+    free(tl->buf);
+
+    return rc;
+}
+
+/*---------------------------------------------------*/
+/* brief: note the instruction about to run */
+/*---------------------------------------*/
+void tl_begin(struct timeline_t* tl, struct processor_t* cpu, struct mem* mem) {
+    tl->cycle = cpu->cycles;
+    tl->op = mem_fetch_byte(mem, cpu->PC);
+}
+
+/*---------------------------------------------------*/
+/* brief: open or close the slices of the instruction run */
+/*---------------------------------------*/
+void tl_end(struct timeline_t* tl, struct processor_t* cpu, struct mem* mem) {
+    int depth = tl->cg.depth;
+
+    if(tl->op==JSR_ABS) {
+        cg_call(&tl->cg, cpu->PC, cpu->SP);
+        if(tl->cg.depth>depth)
+            tl_begin_slice(tl, "call", cpu->PC, cpu->cycles);
+    } else {
+        cg_unwind(&tl->cg, cpu->SP);
+        if(tl->cg.depth<depth)
+            tl_end_slices(tl, depth-tl->cg.depth, cpu->cycles);
+    }
+}
+
+/*---------------------------------------------------*/
+/* brief: open the slice of the handler of the interrupt just taken */
+/* it starts with the entry, RTI ends it as RTS ends a call */
+/*---------------------------------------*/
+void tl_interrupt(struct timeline_t* tl, struct processor_t* cpu, struct mem* mem) {
+    int depth = tl->cg.depth;
+
+    cg_call(&tl->cg, cpu->PC, cpu->SP);
+    if(tl->cg.depth>depth)
+        tl_begin_slice(tl, "irq", cpu->PC, tl->cycle);
+}
@@ -0,0 +1,234 @@
+#include <timetravel.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*---------------------------------------------------*/
+/* brief: drop the keyframes after cycle */
+/*---------------------------------------*/
+static void tt_truncate_keys(struct timetravel_t* tt, uint64_t cycle) {
+    while(tt->n_keys>0 && tt->keys[tt->n_keys-1].cpu.cycles>cycle) {
+        snapshot_dispose(&tt->keys[--tt->n_keys]);
+    }
+}
+
+/*---------------------------------------------------*/
+/* brief: append a keyframe of the current state */
+/*---------------------------------------*/
+static int tt_keyframe(struct timetravel_t* tt, struct machine_t* m) {
+    if(tt->n_keys==tt->cap) {
+        size_t cap = tt->cap ? tt->cap*2 : 256;
+        struct snapshot_t* keys = realloc(tt->keys, cap*sizeof(*keys));
+
+        if(keys==NULL)
+            return 1;
+
+        tt->keys = keys;
+        tt->cap = cap;
+    }
+
+    snapshot_take(&tt->keys[tt->n_keys++], m);
+
+    return 0;
+}
+
+/*---------------------------------------------------*/
+/* brief: apply the recorded inputs due by the current cycle */
+/*---------------------------------------*/
+static void tt_replay_inputs(struct timetravel_t* tt, struct machine_t* m) {
+    while(tt->cursor<tt->input.n_events 
+        && tt->input.events[tt->cursor].cycle<=m->cpu.cycles) 
+    {
+        struct input_event_t* ev = &tt->input.events[tt->cursor++];
+        machine_input(m, ev->device, ev->value);
+    }
+}
+
+/*---------------------------------------------------*/
+/* brief: init the history, a keyframe every interval cycles */
+/*---------------------------------------*/
+int tt_init(struct timetravel_t* tt, uint64_t interval) {
+    memset(tt, 0, sizeof(*tt));
+
+    tt->interval = interval ? interval : TT_DEFAULT_INTERVAL;
+    input_log_init(&tt->input);
+
+    return 0;
+}
+
+/*---------------------------------------------------*/
+/* brief: release keyframes and inputs */
+/*---------------------------------------*/
+void tt_dispose(struct timetravel_t* tt) {
+    while(tt->n_keys>0) {
+        snapshot_dispose(&tt->keys[--tt->n_keys]);
+    }
+
+    free(tt->keys);
+    input_log_dispose(&tt->input);
+    memset(tt, 0, sizeof(*tt));
+}
+
+/*---------------------------------------------------*/
+/* brief: restart the history from the current state */
+/*---------------------------------------*/
+int tt_start(struct timetravel_t* tt, struct machine_t* m) {
+    while(tt->n_keys>0) {
+        snapshot_dispose(&tt->keys[--tt->n_keys]);
+    }
+
+    input_log_clear(&tt->input);
+    tt->cursor = 0;
+
+    return tt_keyframe(tt, m);
+}
+
+/*---------------------------------------------------*/
+/* brief: step, dropping a keyframe when one is due */
+/*---------------------------------------*/
+int tt_step(struct timetravel_t* tt, struct machine_t* m) {
+    int rc = machine_step(m);
+
+    uint64_t last = tt->n_keys ? tt->keys[tt->n_keys-1].cpu.cycles : 0;
+
+    // stepping through recorded history finds the keyframes in place
+    if(m->cpu.cycles>=last+tt->interval)
+        tt_keyframe(tt, m);
+
+    tt_replay_inputs(tt, m);
+
+    return rc;
+}
+
+/*---------------------------------------------------*/
+/* brief: machine_run keeping the keyframes and replaying inputs */
+/*---------------------------------------*/
+enum machine_stop_e tt_run(
+    struct timetravel_t* tt, struct machine_t* m, unsigned long steps, 
+    struct breakpoints_t* bp, struct watchpoints_t* wp, unsigned long* executed) 
+{
+    unsigned long n = 0;
+    enum machine_stop_e stop = MACHINE_STOP_STEPS;
+    bool breaks = bp!=NULL && bp->count>0;
+    bool watches = wp!=NULL && wp->n>0;
+
+    for(; n<steps && m->cpu.is_running; n++) {
+        if(breaks && bp_test(bp, m->cpu.PC) 
+            && bp_check(bp, &m->cpu, &m->mem)) 
+        {
+            stop = MACHINE_STOP_BREAKPOINT;
+            break;
+        }
+
+        if(watches)
+            watch_begin(wp, &m->cpu, &m->mem);
+
+        tt_step(tt, m);
+
+        if(watches && watch_end(wp, &m->cpu, &m->mem)) {
+            stop = MACHINE_STOP_WATCHPOINT;
+            n++;
+            break;
+        }
+    }
+
+    if(!m->cpu.is_running && stop==MACHINE_STOP_STEPS)
+        stop = MACHINE_STOP_HALTED;
+
+    *executed = n;
+
+    return stop;
+}
+
+/*---------------------------------------------------*/
+/* brief: apply and record a new input, the recorded future is dropped */
+/*---------------------------------------*/
+void tt_input(
+    struct timetravel_t* tt, struct machine_t* m, 
+    uint8_t device, uint8_t value) 
+{
+    uint64_t cycle = m->cpu.cycles;
+
+    input_log_truncate(&tt->input, tt->cursor);
+    tt_truncate_keys(tt, cycle);
+
+    input_log_append(&tt->input, cycle, device, value);
+    tt->cursor = tt->input.n_events;
+
+    machine_input(m, device, value);
+}
+
+/*---------------------------------------------------*/
+/* brief: take the events of log as the recorded inputs */
+/* those stamped with the current cycle are applied now, the rest */
+/* as the steps reach them */
+/*---------------------------------------*/
+int tt_replay(struct timetravel_t* tt, struct machine_t* m, struct input_log_t* log) {
+    input_log_clear(&tt->input);
+
+    for(size_t i=0; i<log->n_events; i++) {
+        struct input_event_t* ev = &log->events[i];
+
+        if(input_log_append(&tt->input, ev->cycle, ev->device, ev->value)!=0)
+            return 1;
+    }
+
+    tt->cursor = input_log_find(&tt->input, m->cpu.cycles);
+    tt_replay_inputs(tt, m);
+
+    return 0;
+}
+
+/*---------------------------------------------------*/
+/* brief: move to the first instruction boundary at or after cycle */
+/*---------------------------------------*/
+int tt_seek(struct timetravel_t* tt, struct machine_t* m, uint64_t cycle) {
+    if(tt->n_keys==0)
+        return 1;
+
+    // last keyframe at or before cycle
+    size_t lo = 0;
+    size_t hi = tt->n_keys;
+    while(hi-lo>1) {
+        size_t mid = lo+(hi-lo)/2;
+        if(tt->keys[mid].cpu.cycles<=cycle)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    snapshot_restore(&tt->keys[lo], m);
+
+    tt->cursor = input_log_find(&tt->input, m->cpu.cycles);
+    tt_replay_inputs(tt, m);
+
+    while(m->cpu.cycles<cycle && m->cpu.is_running) {
+        tt_step(tt, m);
+    }
+
+    return 0;
+}
+
+/*---------------------------------------------------*/
+/* brief: realign the inputs after the state moved back by other means */
+/* the journal only takes back cpu and memory, so when the display or */
+/* the via changed since the last keyframe they are brought back by a seek */
+/*---------------------------------------*/
+void tt_sync(struct timetravel_t* tt, struct machine_t* m) {
+    struct snapshot_t* key = NULL;
+
+    for(size_t i=tt->n_keys; i-->0;) {
+        if(tt->keys[i].cpu.cycles<=m->cpu.cycles) {
+            key = &tt->keys[i];
+            break;
+        }
+    }
+
+    if(key!=NULL && (key->lcd.edges!=m->lcd.edges 
+        || key->via.changes!=m->via.changes)) 
+    {
+        tt_seek(tt, m, m->cpu.cycles);
+        return;
+    }
+
+    tt->cursor = input_log_find(&tt->input, m->cpu.cycles+1);
+}
@@ -0,0 +1,566 @@
+#include <trace.h>
+#include <lz.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint8_t* trace_put16(uint8_t* p, uint16_t v) {
+    p[0] = v;
+    p[1] = v>>8;
+    return p+2;
+}
+
+static uint8_t* trace_put32(uint8_t* p, uint32_t v) {
+    p = trace_put16(p, v);
+    return trace_put16(p, v>>16);
+}
+
+static uint8_t* trace_put64(uint8_t* p, uint64_t v) {
+    p = trace_put32(p, v);
+    return trace_put32(p, v>>32);
+}
+
+static uint16_t trace_get16(const uint8_t* p) {
+    return p[0] | p[1]<<8;
+}
+
+static uint32_t trace_get32(const uint8_t* p) {
+    return trace_get16(p) | (uint32_t)trace_get16(p+2)<<16;
+}
+
+static uint64_t trace_get64(const uint8_t* p) {
+    return trace_get32(p) | (uint64_t)trace_get32(p+4)<<32;
+}
+
+/*---------------------------------------------------*/
+/* brief: status register as php would push it */
+/*---------------------------------------*/
+uint8_t trace_pack_status(struct processor_t* cpu) {
+    return cpu->neg<<7 | cpu->over<<6 | 1<<5 | cpu->brk<<4 
+        | cpu->dec<<3 | cpu->ids<<2 | cpu->zero<<1 | cpu->carry;
+}
+
+/*---------------------------------------------------*/
+/* brief: copy the registers of cpu */
+/*---------------------------------------*/
+void trace_get_regs(struct processor_t* cpu, struct trace_regs_t* regs) {
+    regs->A = cpu->A;
+    regs->X = cpu->X;
+    regs->Y = cpu->Y;
+    regs->SP = cpu->SP;
+    regs->P = trace_pack_status(cpu);
+    regs->PC = cpu->PC;
+}
+
+/*---------------------------------------------------*/
+/* brief: fnv-1a of data */
+/*---------------------------------------*/
+uint64_t trace_hash(const uint8_t* data, size_t n) {
+    uint64_t h = 0xcbf29ce484222325ull;
+
+    for(size_t i=0; i<n; i++) {
+        h = (h^data[i])*0x100000001b3ull;
+    }
+
+    return h;
+}
+
+/*---------------------------------------------------*/
+/* brief: start an empty block at the current state */
+/*---------------------------------------*/
+static void trace_buf_reset(struct trace_t* t, struct trace_buf_t* buf) {
+    memset(&buf->block, 0, sizeof(buf->block));
+    buf->block.index = t->index;
+    buf->block.cycle = t->cycle;
+    buf->block.regs = t->regs;
+}
+
+/*---------------------------------------------------*/
+/* brief: compress and write a full block, runs on the worker */
+/*---------------------------------------*/
+static int trace_write_block(struct trace_t* t, struct trace_buf_t* buf) {
+    struct trace_block_t* b = &buf->block;
+
+    b->hash = trace_hash(buf->raw, b->raw_len);
+    b->comp_len = lz_compress(buf->raw, b->raw_len, t->comp);
+
+    uint8_t hdr[TRACE_BLOCK_HEADER_SIZE];
+    uint8_t* p = hdr;
+    p = trace_put32(p, b->raw_len);
+    p = trace_put32(p, b->comp_len);
+    p = trace_put32(p, b->n_records);
+    p = trace_put64(p, b->index);
+    p = trace_put64(p, b->cycle);
+    p = trace_put64(p, b->hash);
+    *p++ = b->regs.A;
+    *p++ = b->regs.X;
+    *p++ = b->regs.Y;
+    *p++ = b->regs.SP;
+    *p++ = b->regs.P;
+    trace_put16(p, b->regs.PC);
+
+    if(fwrite(hdr, 1, sizeof(hdr), t->fp)!=sizeof(hdr))
+        return 1;
+    if(fwrite(t->comp, 1, b->comp_len, t->fp)!=b->comp_len)
+        return 1;
+
+    t->file_bytes += sizeof(hdr)+b->comp_len;
+
+    return 0;
+}
+
+static void* trace_worker(void* arg) {
+    struct trace_t* t = arg;
+
+    pthread_mutex_lock(&t->lock);
+    while(true) {
+        while(t->queued==NULL && !t->done) {
+            pthread_cond_wait(&t->cond, &t->lock);
+        }
+
+        if(t->queued==NULL)
+            break;
+
+        struct trace_buf_t* buf = t->queued;
+        pthread_mutex_unlock(&t->lock);
+
+        int rc = trace_write_block(t, buf);
+
+        pthread_mutex_lock(&t->lock);
+        t->error |= rc;
+        t->queued = NULL;
+        pthread_cond_broadcast(&t->cond);
+    }
+    pthread_mutex_unlock(&t->lock);
+
+    return NULL;
+}
+
+/*---------------------------------------------------*/
+/* brief: hand the current block to the worker, fill the other one */
+/*---------------------------------------*/
+static void trace_flush(struct trace_t* t) {
+    struct trace_buf_t* buf = &t->bufs[t->cur];
+
+    if(buf->block.n_records==0)
+        return;
+
+    pthread_mutex_lock(&t->lock);
+    // the other buffer is free once the worker is done with it
+    while(t->queued!=NULL) {
+        pthread_cond_wait(&t->cond, &t->lock);
+    }
+    t->queued = buf;
+    pthread_cond_broadcast(&t->cond);
+    pthread_mutex_unlock(&t->lock);
+
+    t->cur ^= 1;
+    trace_buf_reset(t, &t->bufs[t->cur]);
+}
+
+/*---------------------------------------------------*/
+/* brief: append the pending writes to p */
+/*---------------------------------------*/
+static uint8_t* trace_put_writes(struct trace_t* t, uint8_t* p) {
+    *p++ = t->n_writes;
+
+    for(int i=0; i<t->n_writes; i++) {
+        p = trace_put16(p, t->writes[i].addr);
+        *p++ = t->writes[i].val;
+    }
+
+    t->n_writes = 0;
+
+    return p;
+}
+
+/*---------------------------------------------------*/
+/* brief: close the current record */
+/*---------------------------------------*/
+static void trace_commit(struct trace_t* t, uint8_t* end) {
+    struct trace_buf_t* buf = &t->bufs[t->cur];
+
+    buf->block.raw_len = end-buf->raw;
+    buf->block.n_records++;
+    t->index++;
+
+    if(buf->block.n_records==TRACE_BLOCK_RECORDS 
+        || buf->block.raw_len>TRACE_BLOCK_SIZE-TRACE_MAX_RECORD)
+    {
+        trace_flush(t);
+    }
+}
+
+/*---------------------------------------------------*/
+/* brief: record the stores and the inputs made outside of an instruction */
+/*---------------------------------------*/
+static void trace_external(struct trace_t* t) {
+    struct trace_buf_t* buf = &t->bufs[t->cur];
+    uint8_t* p = buf->raw+buf->block.raw_len;
+
+    *p++ = 0;
+    p = trace_put_writes(t, p);
+
+    *p++ = t->n_inputs;
+    for(int i=0; i<t->n_inputs; i++) {
+        *p++ = t->inputs[i].device;
+        *p++ = t->inputs[i].value;
+    }
+    t->n_inputs = 0;
+
+    trace_commit(t, p);
+}
+
+static void trace_on_write(void* ctx, uint16_t addr, uint8_t old, uint8_t val) {
+    struct trace_t* t = ctx;
+
+    if(t->n_writes==TRACE_MAX_WRITES)
+        trace_external(t);
+
+    t->writes[t->n_writes].addr = addr;
+    t->writes[t->n_writes].val = val;
+    t->n_writes++;
+}
+
+/*---------------------------------------------------*/
+/* brief: note an input applied before the next instruction */
+/* has the signature of the input hook of a machine, ctx is the trace */
+/*---------------------------------------*/
+void trace_input(void* ctx, uint8_t device, uint8_t value) {
+    struct trace_t* t = ctx;
+
+    if(t->n_inputs==TRACE_MAX_INPUTS)
+        trace_external(t);
+
+    t->inputs[t->n_inputs].device = device;
+    t->inputs[t->n_inputs].value = value;
+    t->n_inputs++;
+}
+
+/*---------------------------------------------------*/
+/* brief: start tracing to filename from the current state */
+/*---------------------------------------*/
+int trace_open(
+    struct trace_t* t, char* filename, 
+    struct processor_t* cpu, struct mem* mem) 
+{
+    memset(t, 0, sizeof(*t));
+
+    t->fp = fopen(filename, "wb");
+    if(t->fp==NULL)
+        return 1;
+
+    t->bufs[0].raw = malloc(TRACE_BLOCK_SIZE);
+    t->bufs[1].raw = malloc(TRACE_BLOCK_SIZE);
+    t->comp = malloc(lz_bound(TRACE_BLOCK_SIZE>MEM_SIZE ? TRACE_BLOCK_SIZE : MEM_SIZE));
+    uint8_t* image = malloc(MEM_SIZE);
+
+    if(t->bufs[0].raw==NULL || t->bufs[1].raw==NULL 
+        || t->comp==NULL || image==NULL) 
+    {
+        free(image);
+        goto error;
+    }
+
+    for(int i=0; i<MEM_PAGES; i++) {
+        memcpy(image+i*MEM_PAGE_SIZE, mem->pages[i]->data, MEM_PAGE_SIZE);
+    }
+
+    uint32_t image_len = lz_compress(image, MEM_SIZE, t->comp);
+    free(image);
+
+    uint8_t hdr[TRACE_HEADER_SIZE];
+    memcpy(hdr, TRACE_MAGIC, 4);
+    trace_put16(hdr+4, TRACE_VERSION);
+    trace_put16(hdr+6, 0);
+    trace_put32(hdr+8, image_len);
+
+    if(fwrite(hdr, 1, sizeof(hdr), t->fp)!=sizeof(hdr) 
+        || fwrite(t->comp, 1, image_len, t->fp)!=image_len)
+    {
+        goto error;
+    }
+    t->file_bytes = sizeof(hdr)+image_len;
+
+    trace_get_regs(cpu, &t->regs);
+    t->cycle = cpu->cycles;
+    trace_buf_reset(t, &t->bufs[0]);
+
+    pthread_mutex_init(&t->lock, NULL);
+    pthread_cond_init(&t->cond, NULL);
+
+    if(pthread_create(&t->thread, NULL, trace_worker, t)!=0) {
+        pthread_cond_destroy(&t->cond);
+        pthread_mutex_destroy(&t->lock);
+        goto error;
+    }
+
+    if(mem_add_hook(mem, trace_on_write, t)!=0) {
+        trace_close(t, mem);
+        return 1;
+    }
+
+    return 0;
+
+error:
+    fclose(t->fp);
+    free(t->bufs[0].raw);
+    free(t->bufs[1].raw);
+    free(t->comp);
+    memset(t, 0, sizeof(*t));
+    return 1;
+}
+
+/*---------------------------------------------------*/
+/* brief: write the last block and stop tracing */
+/*---------------------------------------*/
+int trace_close(struct trace_t* t, struct mem* mem) {
+    mem_remove_hook(mem, trace_on_write, t);
+
+    if(t->n_writes>0 || t->n_inputs>0)
+        trace_external(t);
+    trace_flush(t);
+
+    pthread_mutex_lock(&t->lock);
+    t->done = true;
+    pthread_cond_broadcast(&t->cond);
+    pthread_mutex_unlock(&t->lock);
+
+    pthread_join(t->thread, NULL);
+    pthread_cond_destroy(&t->cond);
+    pthread_mutex_destroy(&t->lock);
+
+    int rc = t->error;
+    if(fclose(t->fp)!=0)
+        rc = 1;
+
+    free(t->bufs[0].raw);
+    free(t->bufs[1].raw);
+    free(t->comp);
+
+    return rc;
+}
+
+/*---------------------------------------------------*/
+/* brief: open the record of the instruction about to run */
+/*---------------------------------------*/
+void trace_begin(struct trace_t* t, struct processor_t* cpu, struct mem* mem) {
+    // stores and inputs made since the last instruction
+    if(t->n_writes>0 || t->n_inputs>0)
+        trace_external(t);
+
+    t->pc = cpu->PC;
+    t->op = mem_fetch_byte(mem, cpu->PC);
+}
+
+/*---------------------------------------------------*/
+/* brief: encode the step just run at p against the last record */
+/*---------------------------------------*/
+static void trace_encode(
+    struct trace_t* t, struct processor_t* cpu, struct mem* mem, uint8_t* p) 
+{
+    struct trace_regs_t regs;
+    trace_get_regs(cpu, &regs);
+
+    uint64_t taken = cpu->cycles-t->cycle;
+    if(taken<253) {
+        *p++ = taken+1;
+    } else {
+        *p++ = 255;
+        p = trace_put32(p, taken);
+    }
+
+    *p++ = t->op;
+    uint8_t* flags = p++;
+    *flags = 0;
+
+    if(regs.A!=t->regs.A) { *flags |= TRACE_A; *p++ = regs.A; }
+    if(regs.X!=t->regs.X) { *flags |= TRACE_X; *p++ = regs.X; }
+    if(regs.Y!=t->regs.Y) { *flags |= TRACE_Y; *p++ = regs.Y; }
+    if(regs.SP!=t->regs.SP) { *flags |= TRACE_SP; *p++ = regs.SP; }
+    if(regs.P!=t->regs.P) { *flags |= TRACE_P; *p++ = regs.P; }
+
+    if(regs.PC!=(uint16_t)(t->pc+1+cpu_op_get_n_bytes(t->op))) {
+        *flags |= TRACE_PC;
+        p = trace_put16(p, regs.PC);
+    }
+
+    if(mem->last_selected>=0) {
+        *flags |= TRACE_EA;
+        p = trace_put16(p, mem->last_selected);
+    }
+
+    if(t->n_writes>0) {
+        *flags |= TRACE_W;
+        p = trace_put_writes(t, p);
+    }
+
+    t->regs = regs;
+    t->cycle = cpu->cycles;
+
+    trace_commit(t, p);
+}
+
+/*---------------------------------------------------*/
+/* brief: encode the instruction just run against the last record */
+/*---------------------------------------*/
+void trace_end(struct trace_t* t, struct processor_t* cpu, struct mem* mem) {
+    struct trace_buf_t* buf = &t->bufs[t->cur];
+
+    trace_encode(t, cpu, mem, buf->raw+buf->block.raw_len);
+}
+
+/*---------------------------------------------------*/
+/* brief: encode the interrupt just taken instead of an instruction */
+/*---------------------------------------*/
+void trace_interrupt(struct trace_t* t, struct processor_t* cpu, struct mem* mem) {
+    struct trace_buf_t* buf = &t->bufs[t->cur];
+    uint8_t* p = buf->raw+buf->block.raw_len;
+
+    *p++ = 254;
+    t->op = BRK_IMP;
+    trace_encode(t, cpu, mem, p);
+}
+
+/*---------------------------------------------------*/
+/* brief: check the file header, 0 if valid */
+/*---------------------------------------*/
+int trace_parse_header(const uint8_t* p, size_t n, uint32_t* image_len) {
+    if(n<TRACE_HEADER_SIZE || memcmp(p, TRACE_MAGIC, 4)!=0)
+        return 1;
+
+    if(trace_get16(p+4)!=TRACE_VERSION)
+        return 1;
+
+    *image_len = trace_get32(p+8);
+
+    return n-TRACE_HEADER_SIZE<*image_len;
+}
+
+/*---------------------------------------------------*/
+/* brief: read a block header, 0 if the whole block is in p */
+/*---------------------------------------*/
+int trace_parse_block(const uint8_t* p, size_t n, struct trace_block_t* block) {
+    if(n<TRACE_BLOCK_HEADER_SIZE)
+        return 1;
+
+    block->raw_len = trace_get32(p);
+    block->comp_len = trace_get32(p+4);
+    block->n_records = trace_get32(p+8);
+    block->index = trace_get64(p+12);
+    block->cycle = trace_get64(p+20);
+    block->hash = trace_get64(p+28);
+    block->regs.A = p[36];
+    block->regs.X = p[37];
+    block->regs.Y = p[38];
+    block->regs.SP = p[39];
+    block->regs.P = p[40];
+    block->regs.PC = trace_get16(p+41);
+
+    if(block->raw_len>TRACE_BLOCK_SIZE)
+        return 1;
+
+    return n-TRACE_BLOCK_HEADER_SIZE<block->comp_len;
+}
+
+/*---------------------------------------------------*/
+/* brief: prepare rec to decode the first record of block */
+/*---------------------------------------*/
+void trace_record_init(struct trace_record_t* rec, struct trace_block_t* block) {
+    rec->index = block->index-1;
+    rec->cycle = block->cycle;
+    rec->regs = block->regs;
+}
+
+/*---------------------------------------------------*/
+/* brief: decode the record following rec, return its length or 0 */
+/*---------------------------------------*/
+size_t trace_decode(const uint8_t* p, size_t n, struct trace_record_t* rec) {
+    const uint8_t* start = p;
+    const uint8_t* end = p+n;
+
+// every field is checked against the end of the block
+#define TRACE_NEED(k) if(end-p<(k)) return 0
+
+    TRACE_NEED(1);
+    uint8_t taken = *p++;
+
+    rec->index++;
+    rec->external = taken==0;
+    rec->interrupt = taken==254;
+    rec->pc = rec->regs.PC;
+    rec->flags = 0;
+    rec->ea = -1;
+    rec->n_writes = 0;
+    rec->n_inputs = 0;
+
+    if(rec->interrupt) {
+        TRACE_NEED(1);
+        taken = *p++;
+
+        if(taken==0 || taken==254)
+            return 0;
+    }
+
+    if(!rec->external) {
+        if(taken==255) {
+            TRACE_NEED(4);
+            rec->cycle += trace_get32(p);
+            p += 4;
+        } else {
+            rec->cycle += taken-1;
+        }
+
+        TRACE_NEED(2);
+        rec->op = *p++;
+        rec->flags = *p++;
+
+        struct trace_regs_t* r = &rec->regs;
+        if(rec->flags & TRACE_A) { TRACE_NEED(1); r->A = *p++; }
+        if(rec->flags & TRACE_X) { TRACE_NEED(1); r->X = *p++; }
+        if(rec->flags & TRACE_Y) { TRACE_NEED(1); r->Y = *p++; }
+        if(rec->flags & TRACE_SP) { TRACE_NEED(1); r->SP = *p++; }
+        if(rec->flags & TRACE_P) { TRACE_NEED(1); r->P = *p++; }
+
+        if(rec->flags & TRACE_PC) {
+            TRACE_NEED(2);
+            r->PC = trace_get16(p);
+            p += 2;
+        } else {
+            r->PC = rec->pc+1+cpu_op_get_n_bytes(rec->op);
+        }
+
+        if(rec->flags & TRACE_EA) {
+            TRACE_NEED(2);
+            rec->ea = trace_get16(p);
+            p += 2;
+        }
+    }
+
+    if(rec->external || rec->flags & TRACE_W) {
+        TRACE_NEED(1);
+        rec->n_writes = *p++;
+
+        TRACE_NEED(rec->n_writes*3);
+        for(int i=0; i<rec->n_writes; i++) {
+            rec->writes[i].addr = trace_get16(p);
+            rec->writes[i].val = p[2];
+            p += 3;
+        }
+    }
+
+    if(rec->external) {
+        TRACE_NEED(1);
+        rec->n_inputs = *p++;
+
+        TRACE_NEED(rec->n_inputs*2);
+        for(int i=0; i<rec->n_inputs; i++) {
+            rec->inputs[i].device = p[0];
+            rec->inputs[i].value = p[1];
+            p += 2;
+        }
+    }
+
+#undef TRACE_NEED
+
+    return p-start;
+}
@@ -0,0 +1,401 @@
+#include <tracediff.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* td_device(uint8_t device) {
+    return device<INPUT_DEVICES ? INPUT_DEVICE_NAMES[device] : "?";
+}
+
+/*---------------------------------------------------*/
+/* brief: describe in what the first field where a and b differ */
+/* return 0 if they match */
+/*---------------------------------------*/
+int td_compare(
+    struct trace_record_t* a, struct trace_record_t* b, char* what, size_t n)
+{
+    if(a->external!=b->external) {
+        snprintf(what, n, "%s against %s",
+            a->external ? "input" : "instruction",
+            b->external ? "input" : "instruction");
+        return 1;
+    }
+
+    if(a->interrupt!=b->interrupt) {
+        snprintf(what, n, "%s against %s",
+            a->interrupt ? "interrupt" : "instruction",
+            b->interrupt ? "interrupt" : "instruction");
+        return 1;
+    }
+
+    if(!a->external) {
+        if(a->pc!=b->pc) {
+            snprintf(what, n, "PC %04x != %04x", a->pc, b->pc);
+            return 1;
+        }
+        if(a->op!=b->op) {
+            snprintf(what, n, "opcode %02x != %02x", a->op, b->op);
+            return 1;
+        }
+        if(a->cycle!=b->cycle) {
+            snprintf(what, n, "cycle %llu != %llu",
+                (unsigned long long)a->cycle, (unsigned long long)b->cycle);
+            return 1;
+        }
+
+        struct { const char* name; int a, b; } regs[] = {
+            {"A", a->regs.A, b->regs.A},
+            {"X", a->regs.X, b->regs.X},
+            {"Y", a->regs.Y, b->regs.Y},
+            {"SP", a->regs.SP, b->regs.SP},
+            {"P", a->regs.P, b->regs.P},
+        };
+        for(int i=0; i<sizeof(regs)/sizeof(regs[0]); i++) {
+            if(regs[i].a!=regs[i].b) {
+                snprintf(what, n, "%s %02x != %02x",
+                    regs[i].name, regs[i].a, regs[i].b);
+                return 1;
+            }
+        }
+
+        if(a->regs.PC!=b->regs.PC) {
+            snprintf(what, n, "next PC %04x != %04x", a->regs.PC, b->regs.PC);
+            return 1;
+        }
+        if(a->ea!=b->ea) {
+            snprintf(what, n, "effective address %04x != %04x",
+                a->ea & 0xffff, b->ea & 0xffff);
+            return 1;
+        }
+    }
+
+    int writes = a->n_writes<b->n_writes ? a->n_writes : b->n_writes;
+    for(int i=0; i<writes; i++) {
+        struct trace_write_t* wa = &a->writes[i];
+        struct trace_write_t* wb = &b->writes[i];
+
+        if(wa->addr!=wb->addr || wa->val!=wb->val) {
+            snprintf(what, n, "write [%04x]=%02x != [%04x]=%02x",
+                wa->addr, wa->val, wb->addr, wb->val);
+            return 1;
+        }
+    }
+
+    if(a->n_writes!=b->n_writes) {
+        snprintf(what, n, "%d writes != %d", a->n_writes, b->n_writes);
+        return 1;
+    }
+
+    int inputs = a->n_inputs<b->n_inputs ? a->n_inputs : b->n_inputs;
+    for(int i=0; i<inputs; i++) {
+        struct trace_input_t* ia = &a->inputs[i];
+        struct trace_input_t* ib = &b->inputs[i];
+
+        if(ia->device!=ib->device || ia->value!=ib->value) {
+            snprintf(what, n, "input %s=%02x != %s=%02x",
+                td_device(ia->device), ia->value, td_device(ib->device), ib->value);
+            return 1;
+        }
+    }
+
+    if(a->n_inputs!=b->n_inputs) {
+        snprintf(what, n, "%d inputs != %d", a->n_inputs, b->n_inputs);
+        return 1;
+    }
+
+    return 0;
+}
+
+static int td_context_init(struct td_context_t* ctx, int size) {
+    memset(ctx, 0, sizeof(*ctx));
+
+    if(size<0)
+        size = 0;
+    if(size>TD_MAX_CONTEXT)
+        size = TD_MAX_CONTEXT;
+
+    ctx->size = size;
+    ctx->recs = malloc((size+1)*sizeof(*ctx->recs));
+
+    return ctx->recs==NULL;
+}
+
+static void td_context_dispose(struct td_context_t* ctx) {
+    free(ctx->recs);
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+static void td_context_push(struct td_context_t* ctx, struct trace_record_t* rec) {
+    if(ctx->size==0)
+        return;
+
+    ctx->recs[ctx->head] = *rec;
+    ctx->head = (ctx->head+1)%ctx->size;
+
+    if(ctx->n<ctx->size)
+        ctx->n++;
+}
+
+/*---------------------------------------------------*/
+/* brief: print the divergence, a or b NULL when that run ended */
+/* instructions of b take their operands from image_b */
+/*---------------------------------------*/
+static void td_report(
+    struct td_context_t* ctx, const char* what, 
+    const uint8_t* image, const uint8_t* image_b,
+    const char* name_a, struct trace_record_t* a,
+    const char* name_b, struct trace_record_t* b)
+{
+    struct trace_record_t* first = a!=NULL ? a : b;
+
+    printf("first divergence at record %llu, cycle %llu: %s\n",
+        (unsigned long long)first->index,
+        (unsigned long long)first->cycle, what);
+
+    if(ctx->n>0)
+        printf("context:\n");
+
+    for(int i=0; i<ctx->n; i++) {
+        int k = (ctx->head-ctx->n+i+ctx->size)%ctx->size;
+        tf_print_record(stdout, &ctx->recs[k], image);
+    }
+
+    printf("%s:\n", name_a);
+    if(a!=NULL)
+        tf_print_record(stdout, a, image);
+    else
+        printf("  end of run\n");
+
+    printf("%s:\n", name_b);
+    if(b!=NULL)
+        tf_print_record(stdout, b, image_b);
+    else
+        printf("  end of run\n");
+}
+
+/* blocks starting from the same state with the same bytes are equal */
+static bool td_same_block(struct trace_block_t* a, struct trace_block_t* b) {
+    return a->hash==b->hash && a->raw_len==b->raw_len
+        && a->n_records==b->n_records && a->index==b->index
+        && a->cycle==b->cycle && a->regs.A==b->regs.A
+        && a->regs.X==b->regs.X && a->regs.Y==b->regs.Y
+        && a->regs.SP==b->regs.SP && a->regs.P==b->regs.P
+        && a->regs.PC==b->regs.PC;
+}
+
+static void td_compare_images(const uint8_t* a, const uint8_t* b) {
+    for(int i=0; i<MEM_SIZE; i++) {
+        if(a[i]!=b[i]) {
+            printf("memory at the start differs, first at $%04x\n", i);
+            return;
+        }
+    }
+}
+
+/*---------------------------------------------------*/
+/* brief: find the first record where two traces differ */
+/* blocks with the same hash are skipped without expanding them */
+/*---------------------------------------*/
+int td_diff_files(struct tracefile_t* a, struct tracefile_t* b, int context) {
+    uint8_t* image_a = malloc(MEM_SIZE);
+    uint8_t* image_b = malloc(MEM_SIZE);
+    struct td_context_t ctx;
+    int rc = TD_ERROR;
+
+    if(td_context_init(&ctx, context)!=0 || image_a==NULL || image_b==NULL)
+        goto out;
+
+    if(tf_load_image(a, image_a)!=0 || tf_load_image(b, image_b)!=0) {
+        fprintf(stderr, "corrupted memory image\n");
+        goto out;
+    }
+
+    td_compare_images(image_a, image_b);
+
+    size_t n_blocks = a->n_blocks<b->n_blocks ? a->n_blocks : b->n_blocks;
+    size_t skip = 0;
+    while(skip<n_blocks && td_same_block(&a->blocks[skip].hdr, &b->blocks[skip].hdr)) {
+        skip++;
+    }
+
+    static struct tf_cursor_t ca, cb;
+    int ra, rb;
+
+    // the context of a divergence at the start of a block is in the one before
+    if(skip>0 && ctx.size>0) {
+        tf_cursor_init(&ca, a, skip-1);
+        while(ca.left>0 && tf_next(&ca)==1) {
+            td_context_push(&ctx, &ca.rec);
+        }
+    }
+
+    tf_cursor_init(&ca, a, skip);
+    tf_cursor_init(&cb, b, skip);
+
+    uint64_t compared = 0;
+    char what[64];
+
+    while(true) {
+        ra = tf_next(&ca);
+        rb = tf_next(&cb);
+
+        if(ra<0 || rb<0) {
+            fprintf(stderr, "corrupted block in %s trace\n", ra<0 ? "first" : "second");
+            goto out;
+        }
+
+        if(ra==0 && rb==0) {
+            printf("no divergence, %zu blocks skipped by hash, "
+                "%llu records compared\n", skip, (unsigned long long)compared);
+            rc = TD_SAME;
+            break;
+        }
+
+        if(ra==0 || rb==0) {
+            td_report(&ctx, ra==0 ? "first trace ends" : "second trace ends",
+                image_a, image_b,
+                "first", ra ? &ca.rec : NULL, "second", rb ? &cb.rec : NULL);
+            rc = TD_DIFFERENT;
+            break;
+        }
+
+        if(td_compare(&ca.rec, &cb.rec, what, sizeof(what))!=0) {
+            td_report(&ctx, what, image_a, image_b, 
+                "first", &ca.rec, "second", &cb.rec);
+            rc = TD_DIFFERENT;
+            break;
+        }
+
+        td_context_push(&ctx, &ca.rec);
+        compared++;
+    }
+
+out:
+    td_context_dispose(&ctx);
+    free(image_a);
+    free(image_b);
+
+    return rc;
+}
+
+static void td_on_write(void* ctx, uint16_t addr, uint8_t old, uint8_t val) {
+    struct trace_record_t* rec = ctx;
+
+    if(rec->n_writes<TRACE_MAX_WRITES) {
+        rec->writes[rec->n_writes].addr = addr;
+        rec->writes[rec->n_writes].val = val;
+        rec->n_writes++;
+    }
+}
+
+/*---------------------------------------------------*/
+/* brief: run m against a golden trace until they differ */
+/* inputs in the trace are applied to m at their records */
+/*---------------------------------------*/
+int td_diff_live(
+    struct tracefile_t* golden, struct machine_t* m,
+    unsigned long steps, int context)
+{
+    uint8_t* image = malloc(MEM_SIZE);
+    uint8_t* live_image = malloc(MEM_SIZE);
+    struct td_context_t ctx;
+    int rc = TD_ERROR;
+
+    if(td_context_init(&ctx, context)!=0 || image==NULL || live_image==NULL)
+        goto out;
+
+    if(tf_load_image(golden, image)!=0) {
+        fprintf(stderr, "corrupted memory image\n");
+        goto out;
+    }
+
+    // what was stored, as the trace holds it, not what the pins read
+    for(int i=0; i<MEM_PAGES; i++) {
+        memcpy(live_image+i*MEM_PAGE_SIZE, m->mem.pages[i]->data, MEM_PAGE_SIZE);
+    }
+    td_compare_images(image, live_image);
+
+    static struct tf_cursor_t cg;
+    static struct trace_record_t live;
+    char what[64];
+
+    if(mem_add_hook(&m->mem, td_on_write, &live)!=0)
+        goto out;
+
+    tf_cursor_init(&cg, golden, 0);
+
+    for(unsigned long n=0; ; n++) {
+        int rg = tf_next(&cg);
+
+        if(rg<0) {
+            fprintf(stderr, "corrupted block in the golden trace\n");
+            break;
+        }
+
+        if(rg==0 || n==steps) {
+            printf("no divergence in %lu records%s\n", n,
+                rg==0 ? ", end of the golden trace" : "");
+            rc = TD_SAME;
+            break;
+        }
+
+        struct trace_record_t* g = &cg.rec;
+
+        live.index = g->index;
+        live.n_writes = 0;
+
+        if(!m->cpu.is_running) {
+            td_report(&ctx, "live run stopped", image, live_image,
+                "golden", g, "live", NULL);
+            rc = TD_DIFFERENT;
+            break;
+        }
+
+        if(g->external) {
+            live.external = true;
+            live.interrupt = false;
+            live.cycle = m->cpu.cycles;
+
+            for(int w=0; w<g->n_writes; w++) {
+                mem_set_data_byte(&m->mem, g->writes[w].addr, g->writes[w].val);
+            }
+            for(int i=0; i<g->n_inputs; i++) {
+                machine_input(m, g->inputs[i].device, g->inputs[i].value);
+            }
+            live.n_inputs = g->n_inputs;
+            memcpy(live.inputs, g->inputs, g->n_inputs*sizeof(g->inputs[0]));
+        } else {
+            live.external = false;
+            live.n_inputs = 0;
+            live.pc = m->cpu.PC;
+            live.op = mem_fetch_byte(&m->mem, m->cpu.PC);
+
+            machine_step(m);
+
+            // the 65C02 takes an interrupt as a forced brk
+            live.interrupt = m->interrupted;
+            if(live.interrupt)
+                live.op = BRK_IMP;
+            live.cycle = m->cpu.cycles;
+            live.ea = m->mem.last_selected;
+            trace_get_regs(&m->cpu, &live.regs);
+        }
+
+        if(td_compare(g, &live, what, sizeof(what))!=0) {
+            td_report(&ctx, what, image, live_image, "golden", g, "live", &live);
+            rc = TD_DIFFERENT;
+            break;
+        }
+
+        td_context_push(&ctx, g);
+    }
+
+    mem_remove_hook(&m->mem, td_on_write, &live);
+
+out:
+    td_context_dispose(&ctx);
+    free(image);
+    free(live_image);
+
+    return rc;
+}
@@ -0,0 +1,239 @@
+#include <tracefile.h>
+#include <lz.h>
+#include <disasm.h>
+#include <input.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*---------------------------------------------------*/
+/* brief: map a trace, the block table is left to tf_scan */
+/*---------------------------------------*/
+int tf_open(struct tracefile_t* tf, const char* filename) {
+    memset(tf, 0, sizeof(*tf));
+    tf->raw_block = -1;
+
+    int fd = open(filename, O_RDONLY);
+    if(fd<0)
+        return 1;
+
+    struct stat st;
+    if(fstat(fd, &st)!=0 || st.st_size==0) {
+        close(fd);
+        return 1;
+    }
+
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if(map==MAP_FAILED)
+        return 1;
+
+    tf->map = map;
+    tf->size = st.st_size;
+
+    tf->raw = malloc(TRACE_BLOCK_SIZE);
+
+    if(tf->raw==NULL 
+        || trace_parse_header(tf->map, tf->size, &tf->image_len)!=0) 
+    {
+        tf_close(tf);
+        return 1;
+    }
+
+    return 0;
+}
+
+/*---------------------------------------------------*/
+/* brief: walk the block headers to fill the block table */
+/*---------------------------------------*/
+int tf_scan(struct tracefile_t* tf) {
+    free(tf->blocks);
+    tf->blocks = NULL;
+    tf->n_blocks = 0;
+
+    size_t cap = 0;
+    size_t pos = TRACE_HEADER_SIZE+tf->image_len;
+
+    // a truncated last block is ignored, the ones before it are still good
+    while(pos<tf->size) {
+        struct trace_block_t hdr;
+        if(trace_parse_block(tf->map+pos, tf->size-pos, &hdr)!=0)
+            break;
+
+        if(tf->n_blocks==cap) {
+            cap = cap ? cap*2 : 256;
+            struct tf_block_t* blocks = realloc(tf->blocks, cap*sizeof(*blocks));
+
+            if(blocks==NULL)
+                return 1;
+            tf->blocks = blocks;
+        }
+
+        tf->blocks[tf->n_blocks].hdr = hdr;
+        tf->blocks[tf->n_blocks].offset = pos+TRACE_BLOCK_HEADER_SIZE;
+        tf->n_blocks++;
+
+        pos += TRACE_BLOCK_HEADER_SIZE+hdr.comp_len;
+    }
+
+    return 0;
+}
+
+/*---------------------------------------------------*/
+/* brief: unmap the trace */
+/*---------------------------------------*/
+void tf_close(struct tracefile_t* tf) {
+    if(tf->map!=NULL)
+        munmap((void*)tf->map, tf->size);
+
+    free(tf->blocks);
+    free(tf->raw);
+    memset(tf, 0, sizeof(*tf));
+}
+
+/*---------------------------------------------------*/
+/* brief: expand the memory at the start of the trace, MEM_SIZE bytes */
+/*---------------------------------------*/
+int tf_load_image(struct tracefile_t* tf, uint8_t* image) {
+    size_t n;
+
+    if(lz_decompress(tf->map+TRACE_HEADER_SIZE, tf->image_len, 
+            image, MEM_SIZE, &n)!=0)
+    {
+        return 1;
+    }
+
+    return n!=MEM_SIZE;
+}
+
+/*---------------------------------------------------*/
+/* brief: return the raw records of a block, NULL if corrupted */
+/* valid until the next call */
+/*---------------------------------------*/
+const uint8_t* tf_expand(struct tracefile_t* tf, size_t block) {
+    if(tf->raw_block==(long)block)
+        return tf->raw;
+
+    struct tf_block_t* b = &tf->blocks[block];
+    size_t n;
+
+    tf->raw_block = -1;
+
+    if(lz_decompress(tf->map+b->offset, b->hdr.comp_len, 
+            tf->raw, TRACE_BLOCK_SIZE, &n)!=0)
+    {
+        return NULL;
+    }
+
+    if(n!=b->hdr.raw_len || trace_hash(tf->raw, n)!=b->hdr.hash)
+        return NULL;
+
+    tf->raw_block = block;
+
+    return tf->raw;
+}
+
+/*---------------------------------------------------*/
+/* brief: index of the last block starting at or before cycle */
+/*---------------------------------------*/
+size_t tf_find_cycle(struct tracefile_t* tf, uint64_t cycle) {
+    size_t lo = 0;
+    size_t hi = tf->n_blocks;
+
+    while(hi-lo>1) {
+        size_t mid = lo+(hi-lo)/2;
+        if(tf->blocks[mid].hdr.cycle<=cycle)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+/*---------------------------------------------------*/
+/* brief: place the cursor before the first record of block */
+/*---------------------------------------*/
+void tf_cursor_init(struct tf_cursor_t* c, struct tracefile_t* tf, size_t block) {
+    c->tf = tf;
+    c->block = block;
+    c->left = 0;
+    c->pos = 0;
+
+    if(block<tf->n_blocks) {
+        c->left = tf->blocks[block].hdr.n_records;
+        trace_record_init(&c->rec, &tf->blocks[block].hdr);
+    }
+}
+
+/*---------------------------------------------------*/
+/* brief: decode the next record in c->rec */
+/* return 1 for a record, 0 at the end, -1 if corrupted */
+/*---------------------------------------*/
+int tf_next(struct tf_cursor_t* c) {
+    struct tracefile_t* tf = c->tf;
+
+    while(c->left==0) {
+        if(c->block+1>=tf->n_blocks)
+            return 0;
+
+        tf_cursor_init(c, tf, c->block+1);
+    }
+
+    struct trace_block_t* hdr = &tf->blocks[c->block].hdr;
+    const uint8_t* raw = tf_expand(tf, c->block);
+
+    if(raw==NULL)
+        return -1;
+
+    size_t len = trace_decode(raw+c->pos, hdr->raw_len-c->pos, &c->rec);
+
+    if(len==0)
+        return -1;
+
+    c->pos += len;
+    c->left--;
+
+    return 1;
+}
+
+/*---------------------------------------------------*/
+/* brief: print a record as cycle, index, pc and instruction */
+/* operands are taken from image */
+/*---------------------------------------*/
+void tf_print_record(FILE* fp, struct trace_record_t* rec, const uint8_t* image) {
+    if(rec->external) {
+        fprintf(fp, "%12llu %10llu        input",
+            (unsigned long long)rec->cycle, (unsigned long long)rec->index);
+    } else {
+        uint8_t ins[3] = {
+            rec->op, image[(uint16_t)(rec->pc+1)], image[(uint16_t)(rec->pc+2)]
+        };
+        char text[DISASM_MAX_TEXT] = "irq";
+
+        // an interrupt is shown at the instruction it came before
+        if(!rec->interrupt)
+            disasm(ins, text, sizeof(text));
+
+        fprintf(fp, 
+            "%12llu %10llu  %04x  %-16s A=%02x X=%02x Y=%02x SP=%02x P=%02x",
+            (unsigned long long)rec->cycle, (unsigned long long)rec->index,
+            rec->pc, text, rec->regs.A, rec->regs.X, rec->regs.Y,
+            rec->regs.SP, rec->regs.P);
+    }
+
+    for(int w=0; w<rec->n_writes; w++) {
+        fprintf(fp, " [%04x]=%02x", rec->writes[w].addr, rec->writes[w].val);
+    }
+    for(int i=0; i<rec->n_inputs; i++) {
+        struct trace_input_t* in = &rec->inputs[i];
+
+        fprintf(fp, " %s=%02x", 
+            in->device<INPUT_DEVICES ? INPUT_DEVICE_NAMES[in->device] : "?", in->value);
+    }
+    fprintf(fp, "\n");
+}
@@ -0,0 +1,405 @@
+#include <via.h>
+#include <string.h>
+
+#define VIA_ACR_T1_FREE     (1<<6)
+#define VIA_ACR_T2_PULSES   (1<<5)
+
+/* shift register modes, bits 4-2 of the acr */
+enum via_sr_mode_e {
+    VIA_SR_OFF,
+    VIA_SR_IN_T2,
+    VIA_SR_IN_PHI2,
+    VIA_SR_IN_CB1,
+    VIA_SR_OUT_FREE,
+    VIA_SR_OUT_T2,
+    VIA_SR_OUT_PHI2,
+    VIA_SR_OUT_CB1,
+};
+
+static enum via_sr_mode_e via_sr_mode(struct via_t* via) {
+    return via->acr>>2 & 7;
+}
+
+/*---------------------------------------------------*/
+/* brief: power on, every register cleared and no timer running */
+/*---------------------------------------*/
+void via_init(struct via_t* via) {
+    memset(via, 0, sizeof(*via));
+
+    via->t1_due = VIA_NEVER;
+    via->t2_due = VIA_NEVER;
+    via->sr_due = VIA_NEVER;
+    via->due = VIA_NEVER;
+}
+
+/* the earliest event and the irq line after a change */
+static void via_schedule(struct via_t* via) {
+    uint64_t due = via->t1_due;
+
+    if(via->t2_due<due)
+        due = via->t2_due;
+    if(via->sr_due<due)
+        due = via->sr_due;
+
+    via->due = due;
+    via->irq = (via->ifr & via->ier & 0x7f)!=0;
+    via->changes++;
+}
+
+/*---------------------------------------------------*/
+/* brief: timer 1 at now, 0xffff the cycle after it reached 0 */
+/* one shot it rolls on down, free running it reloads from the latch */
+/*---------------------------------------*/
+static uint16_t via_t1_value(struct via_t* via, uint64_t now) {
+    if(now<via->t1_start)
+        return 0xffff;
+
+    uint64_t e = now-via->t1_start;
+
+    if(e<=via->t1_count)
+        return via->t1_count-e;
+    if(!(via->acr & VIA_ACR_T1_FREE))
+        return (via->t1_count-e) & 0xffff;
+
+    // reloads not yet seen by via_update
+    uint64_t phase = (e-via->t1_count-1)%(via->t1_latch+2);
+
+    return phase==0 ? 0xffff : via->t1_latch-(phase-1);
+}
+
+/* timer 2 at now, it stands still counting the pulses of PB6 */
+static uint16_t via_t2_value(struct via_t* via, uint64_t now) {
+    if(via->acr & VIA_ACR_T2_PULSES)
+        return via->t2_count;
+
+    return (via->t2_count-(now-via->t2_start)) & 0xffff;
+}
+
+/* cycles between two shifts, 0 for a mode that never shifts here */
+static uint64_t via_sr_period(struct via_t* via) {
+    switch(via_sr_mode(via)) {
+        case VIA_SR_IN_T2:
+        case VIA_SR_OUT_FREE:
+        case VIA_SR_OUT_T2:
+            return 2*((uint64_t)via->t2_latch+2);
+        case VIA_SR_IN_PHI2:
+        case VIA_SR_OUT_PHI2:
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+/*---------------------------------------------------*/
+/* brief: the shift register at now */
+/* in, the bits come from CB2 which reads high; out, they come round */
+/*---------------------------------------*/
+static uint8_t via_sr_value(struct via_t* via, uint64_t now) {
+    if(via->sr_period==0)
+        return via->sr;
+
+    uint64_t k = (now-via->sr_start)/via->sr_period;
+
+    if(via_sr_mode(via)==VIA_SR_OUT_FREE)
+        k %= 8;
+    else if(k>8)
+        k = 8;
+
+    if(via_sr_mode(via)<VIA_SR_OUT_FREE)
+        return via->sr<<k | ((1<<k)-1);
+
+    return (via->sr<<k | via->sr>>(8-k)%8) & 0xff;
+}
+
+/* keep the value at now and stop shifting */
+static void via_sr_stop(struct via_t* via, uint64_t now) {
+    via->sr = via_sr_value(via, now);
+    via->sr_period = 0;
+    via->sr_due = VIA_NEVER;
+}
+
+/* an access to the shift register starts 8 shifts */
+static void via_sr_start(struct via_t* via, uint64_t now) {
+    via->ifr &= ~VIA_IRQ_SR;
+    via->sr_start = now;
+    via->sr_period = via_sr_period(via);
+
+    // the free running mode never raises the flag
+    via->sr_due = via->sr_period!=0 && via_sr_mode(via)!=VIA_SR_OUT_FREE
+        ? now+8*via->sr_period : VIA_NEVER;
+}
+
+/*---------------------------------------------------*/
+/* brief: raise the flags of the events due by now */
+/* a free running timer 1 is reloaded, the others stop at their flag */
+/*---------------------------------------*/
+void via_update(struct via_t* via, uint64_t now) {
+    if(via->t1_due<=now) {
+        via->ifr |= VIA_IRQ_T1;
+
+        if(via->acr & VIA_ACR_T1_FREE) {
+            uint64_t period = (uint64_t)via->t1_latch+2;
+            uint64_t k = (now-via->t1_due)/period;
+
+            via->t1_start = via->t1_due+1+k*period;
+            via->t1_count = via->t1_latch;
+            via->t1_due = via->t1_start+via->t1_latch+1;
+        } else {
+            via->t1_due = VIA_NEVER;
+        }
+    }
+
+    if(via->t2_due<=now) {
+        via->ifr |= VIA_IRQ_T2;
+        via->t2_due = VIA_NEVER;
+        via->t2_armed = false;
+    }
+
+    if(via->sr_due<=now) {
+        via->ifr |= VIA_IRQ_SR;
+        via_sr_stop(via, now);
+    }
+
+    via_schedule(via);
+}
+
+/*---------------------------------------------------*/
+/* brief: what a read of reg returns at now, without its side effects */
+/*---------------------------------------*/
+uint8_t via_peek(struct via_t* via, uint64_t now, uint8_t reg) {
+    switch(reg & 0x0f) {
+        case VIA_ORB:
+            return (via->orb & via->ddrb) | ~via->ddrb;
+        case VIA_ORA:
+        case VIA_ORA_NH:
+            return (via->ora & via->ddra) | ~via->ddra;
+        case VIA_DDRB:
+            return via->ddrb;
+        case VIA_DDRA:
+            return via->ddra;
+        case VIA_T1CL:
+            return via_t1_value(via, now) & 0xff;
+        case VIA_T1CH:
+            return via_t1_value(via, now)>>8;
+        case VIA_T1LL:
+            return via->t1_latch & 0xff;
+        case VIA_T1LH:
+            return via->t1_latch>>8;
+        case VIA_T2CL:
+            return via_t2_value(via, now) & 0xff;
+        case VIA_T2CH:
+            return via_t2_value(via, now)>>8;
+        case VIA_SR:
+            return via_sr_value(via, now);
+        case VIA_ACR:
+            return via->acr;
+        case VIA_PCR:
+            return via->pcr;
+        case VIA_IFR:
+            return via->ifr | (via->irq ? VIA_IRQ_ANY : 0);
+        default:
+            return via->ier | 0x80;
+    }
+}
+
+/*---------------------------------------------------*/
+/* brief: the side effects of a read of reg by the cpu */
+/*---------------------------------------*/
+void via_read(struct via_t* via, uint64_t now, uint8_t reg) {
+    switch(reg & 0x0f) {
+        case VIA_ORB:
+            via->ifr &= ~(VIA_IRQ_CB1 | VIA_IRQ_CB2);
+            break;
+        case VIA_ORA:
+            via->ifr &= ~(VIA_IRQ_CA1 | VIA_IRQ_CA2);
+            break;
+        case VIA_T1CL:
+            via->ifr &= ~VIA_IRQ_T1;
+            break;
+        case VIA_T2CL:
+            via->ifr &= ~VIA_IRQ_T2;
+            break;
+        case VIA_SR:
+            via_sr_stop(via, now);
+            via_sr_start(via, now);
+            break;
+        default:
+            return;
+    }
+
+    via_schedule(via);
+}
+
+/*---------------------------------------------------*/
+/* brief: a store of val to reg at now */
+/* loading a timer works out the cycle it will raise its flag */
+/*---------------------------------------*/
+void via_write(struct via_t* via, uint64_t now, uint8_t reg, uint8_t val) {
+    switch(reg & 0x0f) {
+        case VIA_ORB:
+            via->orb = val;
+            via->ifr &= ~(VIA_IRQ_CB1 | VIA_IRQ_CB2);
+            break;
+        case VIA_ORA:
+            via->ora = val;
+            via->ifr &= ~(VIA_IRQ_CA1 | VIA_IRQ_CA2);
+            break;
+        case VIA_ORA_NH:
+            via->ora = val;
+            break;
+        case VIA_DDRB:
+            via->ddrb = val;
+            break;
+        case VIA_DDRA:
+            via->ddra = val;
+            break;
+        case VIA_T1CL:
+        case VIA_T1LL:
+            via->t1_latch = (via->t1_latch & 0xff00) | val;
+            break;
+        case VIA_T1CH:
+            via->t1_latch = (via->t1_latch & 0x00ff) | val<<8;
+            via->t1_count = via->t1_latch;
+            via->t1_start = now;
+            via->t1_due = now+via->t1_latch+1;
+            via->ifr &= ~VIA_IRQ_T1;
+            break;
+        case VIA_T1LH:
+            via->t1_latch = (via->t1_latch & 0x00ff) | val<<8;
+            via->ifr &= ~VIA_IRQ_T1;
+            break;
+        case VIA_T2CL:
+            via->t2_latch = val;
+            break;
+        case VIA_T2CH:
+            via->t2_count = val<<8 | via->t2_latch;
+            via->t2_start = now;
+            via->t2_due = via->acr & VIA_ACR_T2_PULSES
+                ? VIA_NEVER : now+via->t2_count+1;
+            via->t2_armed = true;
+            via->ifr &= ~VIA_IRQ_T2;
+            break;
+        case VIA_SR:
+            via_sr_stop(via, now);
+            via->sr = val;
+            via_sr_start(via, now);
+            break;
+        case VIA_ACR: {
+            // the counts go on from where they are in the new mode
+            uint16_t t1 = via_t1_value(via, now);
+            uint16_t t2 = via_t2_value(via, now);
+
+            via_sr_stop(via, now);
+            via->acr = val;
+
+            if(via->acr & VIA_ACR_T1_FREE) {
+                via->t1_start = now;
+                via->t1_count = t1;
+                via->t1_due = now+t1+1;
+            }
+
+            // counting time again, a load not yet run down goes on to its flag
+            via->t2_start = now;
+            via->t2_count = t2;
+            if(via->acr & VIA_ACR_T2_PULSES)
+                via->t2_due = VIA_NEVER;
+            else if(via->t2_armed)
+                via->t2_due = now+t2+1;
+            break;
+        }
+        case VIA_PCR:
+            via->pcr = val;
+            break;
+        case VIA_IFR:
+            via->ifr &= ~val;
+            break;
+        default:
+            if(val & 0x80)
+                via->ier |= val & 0x7f;
+            else
+                via->ier &= ~val;
+            break;
+    }
+
+    via_schedule(via);
+}
+
+static void via_put64(uint8_t* p, uint64_t v) {
+    for(int i=0; i<8; i++) {
+        p[i] = v>>(8*i);
+    }
+}
+
+static uint64_t via_get64(const uint8_t* p) {
+    uint64_t v = 0;
+
+    for(int i=0; i<8; i++) {
+        v |= (uint64_t)p[i]<<(8*i);
+    }
+
+    return v;
+}
+
+/*---------------------------------------------------*/
+/* brief: write the state to p, VIA_STATE_SIZE bytes, little endian */
+/* orb ora ddrb ddra acr pcr ifr ier t1_latch:16 t1_count:16 t2_latch */
+/* t2_count:16 sr, then t1_start t1_due t2_start t2_due sr_start */
+/* sr_period sr_due, 64 bits each, then flags:8 */
+/*---------------------------------------*/
+void via_save_state(struct via_t* via, uint8_t* p) {
+    p[0] = via->orb;
+    p[1] = via->ora;
+    p[2] = via->ddrb;
+    p[3] = via->ddra;
+    p[4] = via->acr;
+    p[5] = via->pcr;
+    p[6] = via->ifr;
+    p[7] = via->ier;
+    p[8] = via->t1_latch & 0xff;
+    p[9] = via->t1_latch>>8;
+    p[10] = via->t1_count & 0xff;
+    p[11] = via->t1_count>>8;
+    p[12] = via->t2_latch;
+    p[13] = via->t2_count & 0xff;
+    p[14] = via->t2_count>>8;
+    p[15] = via->sr;
+
+    via_put64(p+16, via->t1_start);
+    via_put64(p+24, via->t1_due);
+    via_put64(p+32, via->t2_start);
+    via_put64(p+40, via->t2_due);
+    via_put64(p+48, via->sr_start);
+    via_put64(p+56, via->sr_period);
+    via_put64(p+64, via->sr_due);
+    p[72] = via->t2_armed;
+}
+
+/*---------------------------------------------------*/
+/* brief: read a state written by via_save_state */
+/*---------------------------------------*/
+void via_load_state(struct via_t* via, const uint8_t* p) {
+    via->orb = p[0];
+    via->ora = p[1];
+    via->ddrb = p[2];
+    via->ddra = p[3];
+    via->acr = p[4];
+    via->pcr = p[5];
+    via->ifr = p[6] & 0x7f;
+    via->ier = p[7] & 0x7f;
+    via->t1_latch = p[8] | p[9]<<8;
+    via->t1_count = p[10] | p[11]<<8;
+    via->t2_latch = p[12];
+    via->t2_count = p[13] | p[14]<<8;
+    via->sr = p[15];
+
+    via->t1_start = via_get64(p+16);
+    via->t1_due = via_get64(p+24);
+    via->t2_start = via_get64(p+32);
+    via->t2_due = via_get64(p+40);
+    via->sr_start = via_get64(p+48);
+    via->sr_period = via_get64(p+56);
+    via->sr_due = via_get64(p+64);
+    via->t2_armed = p[72] & 1;
+
+    via_schedule(via);
+}
@@ -0,0 +1,265 @@
+#include <watch.h>
+#include <stdio.h>
+#include <string.h>
+#include <symbols.h>
+#include <disasm.h>
+
+/*---------------------------------------------------*/
+/* brief: init with no watchpoint */
+/*---------------------------------------*/
+void watch_init(struct watchpoints_t* wp) {
+    memset(wp, 0, sizeof(*wp));
+}
+
+static void watch_hit(
+    struct watchpoints_t* wp, uint8_t kind, 
+    uint16_t addr, uint8_t old, uint8_t val) 
+{
+    if(wp->hit)
+        return;
+
+    wp->hit = true;
+    wp->last.kind = kind;
+    wp->last.addr = addr;
+    wp->last.old = old;
+    wp->last.val = val;
+    wp->last.pc = wp->pc;
+    wp->last.op = wp->op;
+    wp->last.cycle = wp->cycle;
+}
+
+static bool watch_holds(struct watchpoints_t* wp, struct watch_t* w) {
+    return !w->has_cond || cond_eval(&w->cond, wp->cpu, wp->mem);
+}
+
+static void watch_on_write(void* ctx, uint16_t addr, uint8_t old, uint8_t val) {
+    struct watchpoints_t* wp = ctx;
+
+    for(int i=0; i<wp->n; i++) {
+        struct watch_t* w = &wp->w[i];
+
+        if(addr<w->lo || addr>w->hi || !watch_holds(wp, w))
+            continue;
+
+        if(w->kind & WATCH_WRITE)
+            watch_hit(wp, WATCH_WRITE, addr, old, val);
+        else if((w->kind & WATCH_CHANGE) && old!=val)
+            watch_hit(wp, WATCH_CHANGE, addr, old, val);
+    }
+}
+
+/* hook the pages covered by a store watchpoint, unhook the others */
+static void watch_update_pages(struct watchpoints_t* wp, struct mem* mem) {
+    mem_set_watch(mem, watch_on_write, wp);
+    memset(wp->pages, 0, sizeof(wp->pages));
+
+    for(int i=0; i<wp->n; i++) {
+        for(int p=wp->w[i].lo>>8; p<=wp->w[i].hi>>8; p++) {
+            wp->pages[p] |= wp->w[i].kind;
+        }
+    }
+
+    for(int p=0; p<MEM_PAGES; p++) {
+        bool on = (wp->pages[p] & (WATCH_WRITE|WATCH_CHANGE))!=0;
+
+        if(wp->shadow!=NULL)
+            shadow_protect(wp->shadow, p, on);
+        else if(mem->watched[p]!=on)
+            mem_watch_page(mem, p, on);
+    }
+}
+
+/* match the stores of the instruction that faulted on shadow pages */
+static void watch_collect_faults(struct watchpoints_t* wp, struct mem* mem) {
+    int n = shadow_collect(wp->shadow);
+
+    for(int f=0; f<n; f++) {
+        struct shadow_fault_t* fault = &wp->shadow->faults[f];
+        uint8_t* data = mem->pages[fault->page]->data;
+        int first = fault->page<<8;
+
+        for(int i=0; i<wp->n; i++) {
+            struct watch_t* w = &wp->w[i];
+            int lo = w->lo>first ? w->lo : first;
+            int hi = w->hi<first+0xff ? w->hi : first+0xff;
+
+            if(lo>hi || !watch_holds(wp, w))
+                continue;
+
+            uint8_t kind = w->kind & WATCH_WRITE ? WATCH_WRITE : WATCH_CHANGE;
+            uint16_t a = fault->addr;
+            uint8_t* old = fault->old;
+
+            if(a>=lo && a<=hi && (kind==WATCH_WRITE || old[a&0xff]!=data[a&0xff])) {
+                watch_hit(wp, kind, a, old[a&0xff], data[a&0xff]);
+                continue;
+            }
+
+            // the next stores did not fault, they show only if they changed
+            // a byte: a store of the same value after the first is missed
+            for(a=lo; a<=hi; a++) {
+                if(old[a&0xff]!=data[a&0xff]) {
+                    watch_hit(wp, kind, a, old[a&0xff], data[a&0xff]);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+/*---------------------------------------------------*/
+/* brief: start watching the stores to mem */
+/*---------------------------------------*/
+void watch_attach(struct watchpoints_t* wp, struct mem* mem) {
+    watch_update_pages(wp, mem);
+}
+
+/*---------------------------------------------------*/
+/* brief: give every page its fast path back */
+/*---------------------------------------*/
+void watch_detach(struct watchpoints_t* wp, struct mem* mem) {
+    for(int p=0; p<MEM_PAGES; p++) {
+        if(wp->shadow!=NULL)
+            shadow_protect(wp->shadow, p, false);
+        if(mem->watched[p])
+            mem_watch_page(mem, p, false);
+    }
+    mem_set_watch(mem, NULL, NULL);
+}
+
+/*---------------------------------------------------*/
+/* brief: parse [r][w][c]:addr[-addr] [if cond], w if no kind is given */
+/*---------------------------------------*/
+int watch_parse(const char* spec, struct watch_t* w, char* err, size_t n) {
+    char buf[32];
+    const char* colon = strchr(spec, ':');
+    const char* range = spec;
+    const char* cond = strstr(spec, " if ");
+
+    memset(w, 0, sizeof(*w));
+    w->kind = WATCH_WRITE;
+    snprintf(err, n, "expected [r][w][c]:addr[-addr]");
+
+    if(cond!=NULL) {
+        if(cond_compile(&w->cond, cond+4, err, n)!=0)
+            return 1;
+        w->has_cond = true;
+    } else {
+        cond = spec+strlen(spec);
+    }
+
+    if(colon>cond)
+        colon = NULL;
+
+    if(colon!=NULL) {
+        w->kind = 0;
+        for(const char* c=spec; c<colon; c++) {
+            switch(*c) {
+                case 'r': w->kind |= WATCH_READ; break;
+                case 'w': w->kind |= WATCH_WRITE; break;
+                case 'c': w->kind |= WATCH_CHANGE; break;
+                default: return 1;
+            }
+        }
+        range = colon+1;
+    }
+
+    if(w->kind==0 || cond-range>=sizeof(buf))
+        return 1;
+
+    memcpy(buf, range, cond-range);
+    buf[cond-range] = '\0';
+    char* dash = strchr(buf, '-');
+    if(dash!=NULL)
+        *dash = '\0';
+
+    if(sym_parse_addr(buf, &w->lo)!=0)
+        return 1;
+
+    w->hi = w->lo;
+    if(dash!=NULL && (sym_parse_addr(dash+1, &w->hi)!=0 || w->hi<w->lo))
+        return 1;
+
+    return 0;
+}
+
+/*---------------------------------------------------*/
+/* brief: add a watchpoint, hooking the pages it covers */
+/*---------------------------------------*/
+int watch_add(struct watchpoints_t* wp, struct mem* mem, struct watch_t* w) {
+    if(wp->n==WATCH_MAX)
+        return 1;
+
+    wp->w[wp->n++] = *w;
+    watch_update_pages(wp, mem);
+
+    return 0;
+}
+
+/*---------------------------------------------------*/
+/* brief: remove a watchpoint equal to w, 1 if there is none */
+/*---------------------------------------*/
+int watch_remove(struct watchpoints_t* wp, struct mem* mem, struct watch_t* w) {
+    for(int i=0; i<wp->n; i++) {
+        if(wp->w[i].lo==w->lo && wp->w[i].hi==w->hi && wp->w[i].kind==w->kind
+            && wp->w[i].has_cond==w->has_cond 
+            && (!w->has_cond || strcmp(wp->w[i].cond.text, w->cond.text)==0)) 
+        {
+            wp->w[i] = wp->w[--wp->n];
+            watch_update_pages(wp, mem);
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*---------------------------------------------------*/
+/* brief: match the read of the instruction run, true on a hit */
+/*---------------------------------------*/
+bool watch_end(struct watchpoints_t* wp, struct processor_t* cpu, struct mem* mem) {
+    int ea = mem->last_selected;
+
+    if(wp->shadow!=NULL)
+        watch_collect_faults(wp, mem);
+
+    if(!wp->hit && ea>=0 && (wp->pages[ea>>8] & WATCH_READ) 
+        && cpu_op_reads_ea(wp->op)) 
+    {
+        for(int i=0; i<wp->n; i++) {
+            struct watch_t* w = &wp->w[i];
+
+            if((w->kind & WATCH_READ) && ea>=w->lo && ea<=w->hi && watch_holds(wp, w)) {
+                uint8_t val = mem_get_data_byte(mem, ea);
+                watch_hit(wp, WATCH_READ, ea, val, val);
+                break;
+            }
+        }
+    }
+
+    return wp->hit;
+}
+
+/*---------------------------------------------------*/
+/* brief: describe a hit, access first then the instruction */
+/*---------------------------------------*/
+int watch_format(struct watch_hit_t* hit, struct mem* mem, char* buf, size_t n) {
+    char text[DISASM_MAX_TEXT];
+    disasm_mem(mem, hit->pc, text, sizeof(text));
+
+    // the disassembly ends with a space
+    size_t len = strlen(text);
+    while(len>0 && text[len-1]==' ') {
+        text[--len] = '\0';
+    }
+
+    switch(hit->kind) {
+        case WATCH_READ:
+            return snprintf(buf, n, "read $%04x=%02x by %04x %s", 
+                hit->addr, hit->val, hit->pc, text);
+        default:
+            return snprintf(buf, n, "%s $%04x %02x>%02x by %04x %s", 
+                hit->kind==WATCH_WRITE ? "write" : "change", 
+                hit->addr, hit->old, hit->val, hit->pc, text);
+    }
+}
@@ -0,0 +1,105 @@
+; 65c02 HD44780 display test, 8 bit bus, polls the busy flag
+
+DDRA    = $4002
+DDRB    = $4003
+PTA     = $4000
+PTB     = $4001
+
+RS      = $20
+RW      = $40
+E       = $80
+
+    .org $8000
+
+main:
+    LDX #$ff
+    TXS
+
+    LDA #$ff
+    STA DDRA
+    LDA #$e0
+    STA DDRB
+
+    LDA #$38            ; 8 bit, 2 lines, 5x8
+    JSR lcd_cmd
+    LDA #$0e            ; display on, cursor on
+    JSR lcd_cmd
+    LDA #$06            ; increment, no shift
+    JSR lcd_cmd
+    LDA #$01            ; clear
+    JSR lcd_cmd
+
+    LDX #0
+print:
+    LDA message,X
+    BEQ line2
+    JSR lcd_char
+    INX
+    JMP print
+
+line2:
+    LDA #$c0            ; ddram $40
+    JSR lcd_cmd
+
+    LDX #0
+print2:
+    LDA message2,X
+    BEQ end
+    JSR lcd_char
+    INX
+    JMP print2
+
+end: jmp end
+
+; wait for the busy flag to clear, A is kept
+lcd_wait:
+    PHA
+    LDA #0
+    STA DDRA
+busy:
+    LDA #RW
+    STA PTB
+    LDA #(RW|E)
+    STA PTB
+    LDY PTA
+    LDA #RW
+    STA PTB
+    TYA
+    AND #$80
+    BNE busy
+
+    LDA #$ff
+    STA DDRA
+    PLA
+    RTS
+
+lcd_cmd:
+    JSR lcd_wait
+    STA PTA
+    LDA #0
+    STA PTB
+    LDA #E
+    STA PTB
+    LDA #0
+    STA PTB
+    RTS
+
+lcd_char:
+    JSR lcd_wait
+    STA PTA
+    LDA #RS
+    STA PTB
+    LDA #(RS|E)
+    STA PTB
+    LDA #RS
+    STA PTB
+    RTS
+
+message:
+    .byte "hello, world", 0
+message2:
+    .byte "65c02 + hd44780", 0
+
+    .org $fffc
+    .word main
+    .word $0000
@@ -0,0 +1,47 @@
+; 65c02 VIA test, timer 1 free running interrupts count on the leds
+
+DDRB    = $4003
+PTB     = $4001
+
+T1CL    = $6004
+T1CH    = $6005
+ACR     = $600b
+IER     = $600e
+
+COUNT   = $10
+PERIOD  = 1000
+
+    .org $8000
+
+main:
+    SEI
+    LDX #$ff
+    TXS
+
+    LDA #$0f
+    STA DDRB
+    LDA #0
+    STA COUNT
+
+    LDA #$40            ; timer 1 free running
+    STA ACR
+    LDA #<PERIOD
+    STA T1CL
+    LDA #>PERIOD
+    STA T1CH
+    LDA #$c0            ; enable the timer 1 interrupt
+    STA IER
+    CLI
+
+loop: jmp loop
+
+irq:
+    LDA T1CL            ; clears the flag
+    INC COUNT
+    LDA COUNT
+    STA PTB
+    RTI
+
+    .org $fffc
+    .word main
+    .word irq
@@ -0,0 +1,727 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <common.h>
+#include <processor.h>
+#include <disasm.h>
+#include <trace.h>
+#include <tracefile.h>
+#include <tracediff.h>
+#include <symbols.h>
+
+/*
+ * sidecar index, <trace>.idx, rebuilt when the trace changes:
+ * header, block table, per block the last value written to each
+ * address, per address the blocks reading and writing it
+ * its magic is its own, an input log starts with INPUT_MAGIC
+ */
+#define IDX_MAGIC "E65X"
+#define IDX_VERSION 1
+
+struct idx_header_t {
+    char magic[4];
+    uint32_t version;
+    uint64_t trace_size;
+    int64_t trace_mtime;
+
+    uint64_t n_blocks;
+    uint64_t n_finals;
+    uint64_t n_addrs;
+    uint64_t n_postings;
+};
+
+struct idx_block_t {
+    uint64_t finals;
+    uint64_t n_finals;
+};
+
+/* value of addr at the end of a block */
+struct idx_final_t {
+    uint16_t addr;
+    uint8_t val;
+    uint8_t pad;
+};
+
+struct idx_addr_t {
+    uint32_t addr;
+    uint32_t n_reads;
+    uint32_t n_writes;
+    uint32_t pad;
+    uint64_t reads;
+    uint64_t writes;
+};
+
+struct index_t {
+    void* map;
+    size_t size;
+
+    struct idx_header_t* hdr;
+    struct tf_block_t* blocks;
+    struct idx_block_t* finals_of;
+    struct idx_final_t* finals;
+    struct idx_addr_t* addrs;
+    uint32_t* postings;
+};
+
+/* growable list of block numbers */
+struct idx_list_t {
+    uint32_t* v;
+    uint32_t n;
+    uint32_t cap;
+};
+
+#define IDX_ALIGN(n) (((n)+7) & ~(size_t)7)
+
+static void usage(char* name) {
+    fprintf(stderr, "usage: %s <trace> <command>\n", name);
+    fprintf(stderr, "  info               blocks, records and size\n");
+    fprintf(stderr, "  writes <addr>      every write to addr\n");
+    fprintf(stderr, "  reads <addr>       every instruction reading addr\n");
+    fprintf(stderr, "  state <cycle>      registers and memory at cycle\n");
+    fprintf(stderr, "  list <inst> [n]    n records from instruction inst\n");
+    fprintf(stderr, "  diff <trace> [n]   first divergence, with n records of context\n");
+}
+
+static int idx_list_add(struct idx_list_t* l, uint32_t val) {
+    if(l->n==l->cap) {
+        uint32_t cap = l->cap ? l->cap*2 : 16;
+        uint32_t* v = realloc(l->v, cap*sizeof(*v));
+
+        if(v==NULL)
+            return 1;
+
+        l->v = v;
+        l->cap = cap;
+    }
+
+    l->v[l->n++] = val;
+
+    return 0;
+}
+
+static int idx_write(FILE* fp, const void* data, size_t n) {
+    static const uint8_t zero[8];
+
+    if(fwrite(data, 1, n, fp)!=n)
+        return 1;
+
+    return fwrite(zero, 1, IDX_ALIGN(n)-n, fp)!=IDX_ALIGN(n)-n;
+}
+
+/*---------------------------------------------------*/
+/* brief: decode the whole trace once and write the index */
+/*---------------------------------------*/
+static int idx_build(struct tracefile_t* tf, struct stat* st, char* path) {
+    if(tf_scan(tf)!=0)
+        return 1;
+
+    struct idx_list_t* reads = calloc(MEM_SIZE, sizeof(*reads));
+    struct idx_list_t* writes = calloc(MEM_SIZE, sizeof(*writes));
+    uint32_t* rstamp = calloc(MEM_SIZE, sizeof(*rstamp));
+    uint32_t* wstamp = calloc(MEM_SIZE, sizeof(*wstamp));
+    uint8_t* wval = calloc(MEM_SIZE, 1);
+
+    struct idx_block_t* finals_of = calloc(tf->n_blocks+1, sizeof(*finals_of));
+    struct idx_final_t* finals = NULL;
+    size_t n_finals = 0;
+    size_t cap_finals = 0;
+
+    static struct trace_record_t rec;
+    int rc = 1;
+
+    if(reads==NULL || writes==NULL || rstamp==NULL || wstamp==NULL
+        || wval==NULL || finals_of==NULL)
+    {
+        goto out;
+    }
+
+    for(size_t b=0; b<tf->n_blocks; b++) {
+        struct trace_block_t* hdr = &tf->blocks[b].hdr;
+        const uint8_t* raw = tf_expand(tf, b);
+
+        if(raw==NULL) {
+            fprintf(stderr, "block %zu is corrupted\n", b);
+            goto out;
+        }
+
+        // stamps are block+1, 0 is never seen
+        uint32_t stamp = b+1;
+        size_t first = n_finals;
+
+        trace_record_init(&rec, hdr);
+        size_t pos = 0;
+
+        for(uint32_t r=0; r<hdr->n_records; r++) {
+            size_t len = trace_decode(raw+pos, hdr->raw_len-pos, &rec);
+
+            if(len==0) {
+                fprintf(stderr, "block %zu record %u is corrupted\n", b, r);
+                goto out;
+            }
+            pos += len;
+
+            if(rec.ea>=0 && cpu_op_reads_ea(rec.op) && rstamp[rec.ea]!=stamp) {
+                rstamp[rec.ea] = stamp;
+                if(idx_list_add(&reads[rec.ea], b)!=0)
+                    goto out;
+            }
+
+            for(int w=0; w<rec.n_writes; w++) {
+                uint16_t addr = rec.writes[w].addr;
+
+                wval[addr] = rec.writes[w].val;
+
+                if(wstamp[addr]==stamp)
+                    continue;
+                wstamp[addr] = stamp;
+
+                if(idx_list_add(&writes[addr], b)!=0)
+                    goto out;
+
+                if(n_finals==cap_finals) {
+                    cap_finals = cap_finals ? cap_finals*2 : 1024;
+                    struct idx_final_t* f =
+                        realloc(finals, cap_finals*sizeof(*f));
+
+                    if(f==NULL)
+                        goto out;
+                    finals = f;
+                }
+
+                finals[n_finals].addr = addr;
+                finals[n_finals].pad = 0;
+                n_finals++;
+            }
+        }
+
+        for(size_t f=first; f<n_finals; f++) {
+            finals[f].val = wval[finals[f].addr];
+        }
+
+        finals_of[b].finals = first;
+        finals_of[b].n_finals = n_finals-first;
+    }
+
+    struct idx_header_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, IDX_MAGIC, 4);
+    hdr.version = IDX_VERSION;
+    hdr.trace_size = st->st_size;
+    hdr.trace_mtime = st->st_mtime;
+    hdr.n_blocks = tf->n_blocks;
+    hdr.n_finals = n_finals;
+
+    for(int a=0; a<MEM_SIZE; a++) {
+        if(reads[a].n>0 || writes[a].n>0) {
+            hdr.n_addrs++;
+            hdr.n_postings += reads[a].n+writes[a].n;
+        }
+    }
+
+    FILE* fp = fopen(path, "wb");
+    if(fp==NULL)
+        goto out;
+
+    int err = idx_write(fp, &hdr, sizeof(hdr));
+    err |= idx_write(fp, tf->blocks, tf->n_blocks*sizeof(*tf->blocks));
+    err |= idx_write(fp, finals_of, tf->n_blocks*sizeof(*finals_of));
+    err |= idx_write(fp, finals, n_finals*sizeof(*finals));
+
+    uint64_t next = 0;
+    for(int a=0; a<MEM_SIZE && !err; a++) {
+        if(reads[a].n==0 && writes[a].n==0)
+            continue;
+
+        struct idx_addr_t entry = {
+            a, reads[a].n, writes[a].n, 0, next, next+reads[a].n
+        };
+        next += reads[a].n+writes[a].n;
+
+        err |= fwrite(&entry, sizeof(entry), 1, fp)!=1;
+    }
+
+    for(int a=0; a<MEM_SIZE && !err; a++) {
+        err |= fwrite(reads[a].v, sizeof(uint32_t), reads[a].n, fp)!=reads[a].n;
+        err |= fwrite(writes[a].v, sizeof(uint32_t), writes[a].n, fp)!=writes[a].n;
+    }
+
+    if(fclose(fp)!=0 || err) {
+        unlink(path);
+        goto out;
+    }
+
+    rc = 0;
+
+out:
+    for(int a=0; reads!=NULL && a<MEM_SIZE; a++) {
+        free(reads[a].v);
+    }
+    for(int a=0; writes!=NULL && a<MEM_SIZE; a++) {
+        free(writes[a].v);
+    }
+    free(reads);
+    free(writes);
+    free(rstamp);
+    free(wstamp);
+    free(wval);
+    free(finals_of);
+    free(finals);
+
+    return rc;
+}
+
+/*---------------------------------------------------*/
+/* brief: map the index, 0 if it matches the trace */
+/*---------------------------------------*/
+static int idx_map(struct index_t* idx, struct stat* st, char* path) {
+    memset(idx, 0, sizeof(*idx));
+
+    int fd = open(path, O_RDONLY);
+    if(fd<0)
+        return 1;
+
+    struct stat ist;
+    if(fstat(fd, &ist)!=0 || (size_t)ist.st_size<sizeof(struct idx_header_t)) {
+        close(fd);
+        return 1;
+    }
+
+    idx->size = ist.st_size;
+    idx->map = mmap(NULL, idx->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if(idx->map==MAP_FAILED) {
+        idx->map = NULL;
+        return 1;
+    }
+
+    struct idx_header_t* hdr = idx->map;
+    idx->hdr = hdr;
+
+    if(memcmp(hdr->magic, IDX_MAGIC, 4)!=0 || hdr->version!=IDX_VERSION
+        || hdr->trace_size!=(uint64_t)st->st_size
+        || hdr->trace_mtime!=st->st_mtime)
+    {
+        return 1;
+    }
+
+    uint8_t* p = (uint8_t*)idx->map+IDX_ALIGN(sizeof(*hdr));
+
+    idx->blocks = (struct tf_block_t*)p;
+    p += IDX_ALIGN(hdr->n_blocks*sizeof(struct tf_block_t));
+    idx->finals_of = (struct idx_block_t*)p;
+    p += IDX_ALIGN(hdr->n_blocks*sizeof(struct idx_block_t));
+    idx->finals = (struct idx_final_t*)p;
+    p += IDX_ALIGN(hdr->n_finals*sizeof(struct idx_final_t));
+    idx->addrs = (struct idx_addr_t*)p;
+    p += hdr->n_addrs*sizeof(struct idx_addr_t);
+    idx->postings = (uint32_t*)p;
+    p += hdr->n_postings*sizeof(uint32_t);
+
+    return p!=(uint8_t*)idx->map+idx->size;
+}
+
+static void idx_unmap(struct index_t* idx) {
+    if(idx->map!=NULL)
+        munmap(idx->map, idx->size);
+    memset(idx, 0, sizeof(*idx));
+}
+
+/*---------------------------------------------------*/
+/* brief: open the index of the trace, building it if stale */
+/*---------------------------------------*/
+static int idx_open(struct index_t* idx, struct tracefile_t* tf, char* trace) {
+    struct stat st;
+    if(stat(trace, &st)!=0)
+        return 1;
+
+    char path[4096];
+    snprintf(path, sizeof(path), "%s.idx", trace);
+
+    if(idx_map(idx, &st, path)!=0) {
+        idx_unmap(idx);
+
+        fprintf(stderr, "indexing %s\n", trace);
+        if(idx_build(tf, &st, path)!=0 || idx_map(idx, &st, path)!=0) {
+            fprintf(stderr, "cannot write %s\n", path);
+            idx_unmap(idx);
+            return 1;
+        }
+    }
+
+    // the block table comes from the index, no need to walk the file
+    free(tf->blocks);
+    tf->n_blocks = idx->hdr->n_blocks;
+    tf->blocks = malloc((tf->n_blocks+1)*sizeof(*tf->blocks));
+
+    if(tf->blocks==NULL)
+        return 1;
+
+    memcpy(tf->blocks, idx->blocks, tf->n_blocks*sizeof(*tf->blocks));
+
+    return 0;
+}
+
+static struct idx_addr_t* idx_find_addr(struct index_t* idx, uint16_t addr) {
+    size_t lo = 0;
+    size_t hi = idx->hdr->n_addrs;
+
+    while(lo<hi) {
+        size_t mid = lo+(hi-lo)/2;
+        if(idx->addrs[mid].addr<addr)
+            lo = mid+1;
+        else
+            hi = mid;
+    }
+
+    if(lo<idx->hdr->n_addrs && idx->addrs[lo].addr==addr)
+        return &idx->addrs[lo];
+
+    return NULL;
+}
+
+/* calls fn on every record of block, stops early when fn returns nonzero */
+typedef int (*record_fn)(struct trace_record_t* rec, void* ctx);
+
+static int walk_block(struct tracefile_t* tf, size_t b, record_fn fn, void* ctx) {
+    static struct trace_record_t rec;
+    struct trace_block_t* hdr = &tf->blocks[b].hdr;
+    const uint8_t* raw = tf_expand(tf, b);
+
+    if(raw==NULL) {
+        fprintf(stderr, "block %zu is corrupted\n", b);
+        return -1;
+    }
+
+    trace_record_init(&rec, hdr);
+    size_t pos = 0;
+
+    for(uint32_t r=0; r<hdr->n_records; r++) {
+        size_t len = trace_decode(raw+pos, hdr->raw_len-pos, &rec);
+
+        if(len==0) {
+            fprintf(stderr, "block %zu record %u is corrupted\n", b, r);
+            return -1;
+        }
+        pos += len;
+
+        int rc = fn(&rec, ctx);
+        if(rc!=0)
+            return rc;
+    }
+
+    return 0;
+}
+
+struct query_t {
+    uint16_t addr;
+    uint8_t* image;
+    unsigned long hits;
+};
+
+static int match_write(struct trace_record_t* rec, void* ctx) {
+    struct query_t* q = ctx;
+
+    for(int w=0; w<rec->n_writes; w++) {
+        if(rec->writes[w].addr==q->addr) {
+            tf_print_record(stdout, rec, q->image);
+            q->hits++;
+            break;
+        }
+    }
+
+    return 0;
+}
+
+static int match_read(struct trace_record_t* rec, void* ctx) {
+    struct query_t* q = ctx;
+
+    if(rec->ea==q->addr && cpu_op_reads_ea(rec->op)) {
+        tf_print_record(stdout, rec, q->image);
+        q->hits++;
+    }
+
+    return 0;
+}
+
+/*---------------------------------------------------*/
+/* brief: print the records touching addr, expanding only their blocks */
+/*---------------------------------------*/
+static int cmd_access(
+    struct tracefile_t* tf, struct index_t* idx, uint8_t* image,
+    uint16_t addr, bool write)
+{
+    struct query_t q = { addr, image, 0 };
+    struct idx_addr_t* entry = idx_find_addr(idx, addr);
+
+    if(entry!=NULL) {
+        uint32_t* blocks = idx->postings+(write ? entry->writes : entry->reads);
+        uint32_t n = write ? entry->n_writes : entry->n_reads;
+
+        for(uint32_t i=0; i<n; i++) {
+            if(walk_block(tf, blocks[i], write ? match_write : match_read, &q)<0)
+                return 1;
+        }
+    }
+
+    printf("%lu %s of $%04x\n", q.hits, write ? "writes" : "reads", addr);
+
+    return 0;
+}
+
+struct state_t {
+    uint64_t cycle;
+    uint8_t* mem;
+    struct trace_record_t last;
+    bool found;
+};
+
+static int apply_until(struct trace_record_t* rec, void* ctx) {
+    struct state_t* s = ctx;
+
+    if(rec->cycle>s->cycle)
+        return 1;
+
+    for(int w=0; w<rec->n_writes; w++) {
+        s->mem[rec->writes[w].addr] = rec->writes[w].val;
+    }
+
+    s->last = *rec;
+    s->found = true;
+
+    return 0;
+}
+
+/*---------------------------------------------------*/
+/* brief: print the machine after the last instruction ending by cycle */
+/*---------------------------------------*/
+static int cmd_state(
+    struct tracefile_t* tf, struct index_t* idx, uint8_t* image, uint64_t cycle)
+{
+    if(tf->n_blocks==0) {
+        fprintf(stderr, "empty trace\n");
+        return 1;
+    }
+
+    static uint8_t mem[MEM_SIZE];
+    memcpy(mem, image, MEM_SIZE);
+
+    size_t b = tf_find_cycle(tf, cycle);
+
+    // memory at the start of b from the index alone
+    for(size_t i=0; i<b; i++) {
+        struct idx_block_t* fb = &idx->finals_of[i];
+        for(uint64_t f=0; f<fb->n_finals; f++) {
+            struct idx_final_t* final = &idx->finals[fb->finals+f];
+            mem[final->addr] = final->val;
+        }
+    }
+
+    static struct state_t s;
+    s.cycle = cycle;
+    s.mem = mem;
+    s.found = false;
+    trace_record_init(&s.last, &tf->blocks[b].hdr);
+
+    if(walk_block(tf, b, apply_until, &s)<0)
+        return 1;
+
+    struct trace_regs_t* r = &s.last.regs;
+    uint8_t ins[3] = {
+        mem[r->PC], mem[(uint16_t)(r->PC+1)], mem[(uint16_t)(r->PC+2)]
+    };
+    char text[DISASM_MAX_TEXT];
+    disasm(ins, text, sizeof(text));
+
+    printf("cycle....... : %llu\n", (unsigned long long)s.last.cycle);
+    if(s.found)
+        printf("instruction. : %llu\n", (unsigned long long)s.last.index);
+    printf("A........... : %02x\n", r->A);
+    printf("X........... : %02x\n", r->X);
+    printf("Y........... : %02x\n", r->Y);
+    printf("SP.......... : %02x\n", r->SP);
+    printf("P........... : %02x\n", r->P);
+    printf("PC.......... : %04x  %s\n", r->PC, text);
+    printf("memory changed since the start:\n");
+
+    for(int row=0; row<MEM_SIZE; row+=16) {
+        if(memcmp(mem+row, image+row, 16)==0)
+            continue;
+
+        printf("%04x ", row);
+        for(int i=0; i<16; i++) {
+            printf(" %02x", mem[row+i]);
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
+
+struct list_t {
+    uint64_t from;
+    unsigned long left;
+    uint8_t* image;
+};
+
+static int list_record(struct trace_record_t* rec, void* ctx) {
+    struct list_t* l = ctx;
+
+    if(rec->index<l->from)
+        return 0;
+    if(l->left==0)
+        return 1;
+
+    tf_print_record(stdout, rec, l->image);
+    l->left--;
+
+    return 0;
+}
+
+/*---------------------------------------------------*/
+/* brief: print n records from record index from */
+/*---------------------------------------*/
+static int cmd_list(
+    struct tracefile_t* tf, uint8_t* image, uint64_t from, unsigned long n)
+{
+    size_t lo = 0;
+    size_t hi = tf->n_blocks;
+    while(hi-lo>1) {
+        size_t mid = lo+(hi-lo)/2;
+        if(tf->blocks[mid].hdr.index<=from)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    struct list_t l = { from, n, image };
+
+    for(size_t b=lo; b<tf->n_blocks && l.left>0; b++) {
+        if(walk_block(tf, b, list_record, &l)<0)
+            return 1;
+    }
+
+    return 0;
+}
+
+static int cmd_info(struct tracefile_t* tf, struct index_t* idx) {
+    uint64_t records = 0;
+    uint64_t raw = 0;
+
+    for(size_t b=0; b<tf->n_blocks; b++) {
+        records += tf->blocks[b].hdr.n_records;
+        raw += tf->blocks[b].hdr.raw_len;
+    }
+
+    uint64_t first = tf->n_blocks ? tf->blocks[0].hdr.cycle : 0;
+
+    printf("blocks...... : %zu\n", tf->n_blocks);
+    printf("records..... : %llu\n", (unsigned long long)records);
+    printf("first cycle. : %llu\n", (unsigned long long)first);
+    printf("file........ : %zu bytes, %.2f bytes/record\n",
+        tf->size, records ? (double)tf->size/records : 0);
+    printf("raw......... : %llu bytes, compression x%.1f\n",
+        (unsigned long long)raw, raw ? (double)raw/tf->size : 0);
+    printf("addresses... : %llu read or written\n",
+        (unsigned long long)idx->hdr->n_addrs);
+
+    return 0;
+}
+
+/*---------------------------------------------------*/
+/* brief: compare with another trace, exit status as diff(1) */
+/*---------------------------------------*/
+static int cmd_diff(struct tracefile_t* tf, char* other, int context) {
+    struct tracefile_t tf_b;
+
+    if(tf_open(&tf_b, other)!=0) {
+        fprintf(stderr, "cannot read trace %s\n", other);
+        return TD_ERROR;
+    }
+
+    int rc = TD_ERROR;
+    if(tf_scan(tf)==0 && tf_scan(&tf_b)==0)
+        rc = td_diff_files(tf, &tf_b, context);
+
+    tf_close(&tf_b);
+
+    return rc;
+}
+
+/* an address is hex as with -b and -w, with or without $ or 0x */
+static uint16_t parse_addr(char* s) {
+    uint16_t addr;
+
+    if(sym_parse_addr(s, &addr)!=0) {
+        fprintf(stderr, "bad address %s\n", s);
+        exit(1);
+    }
+
+    return addr;
+}
+
+/* a cycle or a count is decimal, hex with $ or 0x */
+static unsigned long long parse_num(char* s) {
+    char* digits = s[0]=='$' ? s+1 : s;
+    char* end;
+    unsigned long long n = strtoull(digits, &end, s[0]=='$' ? 16 : 0);
+
+    if(end==digits || *end!='\0' || !isxdigit((unsigned char)digits[0])) {
+        fprintf(stderr, "bad number %s\n", s);
+        exit(1);
+    }
+
+    return n;
+}
+
+int main(int argc, char* argv[]) {
+
+    if(argc<3) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    char* cmd = argv[2];
+
+    struct tracefile_t tf;
+    if(tf_open(&tf, argv[1])!=0) {
+        fprintf(stderr, "cannot read trace %s\n", argv[1]);
+        return 1;
+    }
+
+    static uint8_t image[MEM_SIZE];
+    struct index_t idx;
+    int rc = 1;
+
+    if(strcmp(cmd, "diff")==0 && (argc==4 || argc==5)) {
+        rc = cmd_diff(&tf, argv[3], argc==5 ? parse_num(argv[4]) : TD_DEFAULT_CONTEXT);
+    } else if(tf_load_image(&tf, image)!=0) {
+        fprintf(stderr, "corrupted memory image in %s\n", argv[1]);
+    } else if(idx_open(&idx, &tf, argv[1])==0) {
+        if(strcmp(cmd, "info")==0) {
+            rc = cmd_info(&tf, &idx);
+        } else if(strcmp(cmd, "writes")==0 && argc==4) {
+            rc = cmd_access(&tf, &idx, image, parse_addr(argv[3]), true);
+        } else if(strcmp(cmd, "reads")==0 && argc==4) {
+            rc = cmd_access(&tf, &idx, image, parse_addr(argv[3]), false);
+        } else if(strcmp(cmd, "state")==0 && argc==4) {
+            rc = cmd_state(&tf, &idx, image, parse_num(argv[3]));
+        } else if(strcmp(cmd, "list")==0 && (argc==4 || argc==5)) {
+            rc = cmd_list(&tf, image, parse_num(argv[3]),
+                argc==5 ? parse_num(argv[4]) : 20);
+        } else {
+            usage(argv[0]);
+        }
+
+        idx_unmap(&idx);
+    }
+
+    tf_close(&tf);
+
+    return rc;
+}